@@ -0,0 +1,351 @@
+///////////////////////////////////////////////////////////////////////////////
+// boundingvolumetree.cpp
+// ============
+// find the scene draws inside the view frustum
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "BoundingVolumeTree.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 1))
+#define BOUNDING_VOLUME_TREE_SSE
+#include <xmmintrin.h>
+#endif
+
+// declarations for the global variables and defines
+namespace
+{
+	// most items kept in a leaf node
+	const uint32_t LEAF_ITEMS = 4;
+}
+
+/***********************************************************
+ *  Build()
+ *
+ *  This method is used for building the tree over the
+ *  bounds of the items, replacing the previous tree.
+ ***********************************************************/
+void BoundingVolumeTree::Build(const std::vector<BOUNDS>& items)
+{
+	m_nodes.clear();
+	m_itemBounds = items;
+	m_itemOrder.resize(items.size());
+	for (uint32_t i = 0; i < (uint32_t)items.size(); i++)
+	{
+		m_itemOrder[i] = i;
+	}
+
+	if (items.size() > 0)
+	{
+		m_nodes.reserve((items.size() / LEAF_ITEMS + 1) * 2);
+		BuildNode(items, 0, (uint32_t)items.size());
+	}
+}
+
+/***********************************************************
+ *  BuildNode()
+ *
+ *  This method is used for adding the node over a range of
+ *  the item order, and the nodes of the two halves of the
+ *  range split at the median of the longest axis.
+ ***********************************************************/
+void BoundingVolumeTree::BuildNode(const std::vector<BOUNDS>& items, uint32_t first, uint32_t count)
+{
+	int index = (int)m_nodes.size();
+	BVH_NODE node;
+	glm::vec3 centerMin = items[m_itemOrder[first]].center;
+	glm::vec3 centerMax = centerMin;
+
+	node.bounds = items[m_itemOrder[first]];
+	for (uint32_t i = first + 1; i < first + count; i++)
+	{
+		const BOUNDS& bounds = items[m_itemOrder[i]];
+		node.bounds = MergeBounds(node.bounds, bounds);
+		centerMin = glm::min(centerMin, bounds.center);
+		centerMax = glm::max(centerMax, bounds.center);
+	}
+	node.firstItem = first;
+	node.itemCount = count;
+	node.subtreeEnd = index + 1;
+	m_nodes.push_back(node);
+
+	if (count <= LEAF_ITEMS)
+	{
+		return;
+	}
+
+	// split across the axis where the item centers spread most
+	glm::vec3 spread = centerMax - centerMin;
+	int axis = 0;
+	if (spread.y > spread[axis])
+	{
+		axis = 1;
+	}
+	if (spread.z > spread[axis])
+	{
+		axis = 2;
+	}
+
+	uint32_t half = count / 2;
+	std::nth_element(
+		m_itemOrder.begin() + first,
+		m_itemOrder.begin() + first + half,
+		m_itemOrder.begin() + first + count,
+		[&items, axis](uint32_t a, uint32_t b)
+		{
+			return(items[a].center[axis] < items[b].center[axis]);
+		});
+
+	BuildNode(items, first, half);
+	BuildNode(items, first + half, count - half);
+	m_nodes[index].subtreeEnd = (int)m_nodes.size();
+}
+
+/***********************************************************
+ *  Refit()
+ *
+ *  This method is used for fitting the boxes of the nodes
+ *  to the moved bounds of the items.  The nodes are walked
+ *  backwards, so the children of a node are always fitted
+ *  before the node itself.
+ ***********************************************************/
+void BoundingVolumeTree::Refit(const std::vector<BOUNDS>& items)
+{
+	m_itemBounds = items;
+
+	for (int i = (int)m_nodes.size() - 1; i >= 0; i--)
+	{
+		BVH_NODE& node = m_nodes[i];
+
+		if (node.subtreeEnd == i + 1)
+		{
+			node.bounds = items[m_itemOrder[node.firstItem]];
+			for (uint32_t j = node.firstItem + 1; j < node.firstItem + node.itemCount; j++)
+			{
+				node.bounds = MergeBounds(node.bounds, items[m_itemOrder[j]]);
+			}
+		}
+		else
+		{
+			// the first child follows the node, and the second
+			// child follows the subtree of the first
+			const BVH_NODE& left = m_nodes[i + 1];
+			node.bounds = MergeBounds(left.bounds, m_nodes[left.subtreeEnd].bounds);
+		}
+	}
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for removing every node and item.
+ ***********************************************************/
+void BoundingVolumeTree::Clear()
+{
+	m_nodes.clear();
+	m_itemOrder.clear();
+	m_itemBounds.clear();
+}
+
+/***********************************************************
+ *  CullFrustum()
+ *
+ *  This method is used for finding the items inside the
+ *  frustum of a view projection matrix.  The frustum planes
+ *  are taken from the rows of the matrix, and point into
+ *  the frustum.
+ ***********************************************************/
+void BoundingVolumeTree::CullFrustum(const glm::mat4& viewProjection, std::vector<uint32_t>& visible) const
+{
+	FRUSTUM_PLANES planes;
+	glm::vec4 rows[4];
+
+	for (int i = 0; i < 4; i++)
+	{
+		rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+	}
+
+	const glm::vec4 frustum[6] =
+	{
+		rows[3] + rows[0],
+		rows[3] - rows[0],
+		rows[3] + rows[1],
+		rows[3] - rows[1],
+		rows[3] + rows[2],
+		rows[3] - rows[2]
+	};
+	for (int i = 0; i < 8; i++)
+	{
+		glm::vec4 plane = (i < 6) ? frustum[i] : glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+		planes.normalX[i] = plane.x;
+		planes.normalY[i] = plane.y;
+		planes.normalZ[i] = plane.z;
+		planes.distance[i] = plane.w;
+	}
+
+	visible.clear();
+
+	int index = 0;
+	while (index < (int)m_nodes.size())
+	{
+		const BVH_NODE& node = m_nodes[index];
+		int result = TestBounds(planes, node.bounds);
+
+		if (result < 0)
+		{
+			index = node.subtreeEnd;
+			continue;
+		}
+
+		if (result > 0)
+		{
+			// everything below a node inside the frustum is visible
+			visible.insert(
+				visible.end(),
+				m_itemOrder.begin() + node.firstItem,
+				m_itemOrder.begin() + node.firstItem + node.itemCount);
+			index = node.subtreeEnd;
+			continue;
+		}
+
+		if (node.subtreeEnd == index + 1)
+		{
+			for (uint32_t i = node.firstItem; i < node.firstItem + node.itemCount; i++)
+			{
+				if (TestBounds(planes, m_itemBounds[m_itemOrder[i]]) >= 0)
+				{
+					visible.push_back(m_itemOrder[i]);
+				}
+			}
+		}
+		index++;
+	}
+}
+
+/***********************************************************
+ *  TestBounds()
+ *
+ *  This method is used for testing a box against the
+ *  frustum planes.  The box is outside when its center lies
+ *  further behind a plane than the box reaches towards it,
+ *  and fully inside when it lies in front of every plane by
+ *  more than that.
+ ***********************************************************/
+int BoundingVolumeTree::TestBounds(const FRUSTUM_PLANES& planes, const BOUNDS& bounds)
+{
+	bool bInside = true;
+
+#ifdef BOUNDING_VOLUME_TREE_SSE
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 signBits = _mm_set1_ps(-0.0f);
+	const __m128 centerX = _mm_set1_ps(bounds.center.x);
+	const __m128 centerY = _mm_set1_ps(bounds.center.y);
+	const __m128 centerZ = _mm_set1_ps(bounds.center.z);
+	const __m128 extentX = _mm_set1_ps(bounds.extent.x);
+	const __m128 extentY = _mm_set1_ps(bounds.extent.y);
+	const __m128 extentZ = _mm_set1_ps(bounds.extent.z);
+
+	for (int i = 0; i < 8; i += 4)
+	{
+		__m128 normalX = _mm_load_ps(&planes.normalX[i]);
+		__m128 normalY = _mm_load_ps(&planes.normalY[i]);
+		__m128 normalZ = _mm_load_ps(&planes.normalZ[i]);
+
+		__m128 distance = _mm_add_ps(
+			_mm_add_ps(_mm_mul_ps(normalX, centerX), _mm_mul_ps(normalY, centerY)),
+			_mm_add_ps(_mm_mul_ps(normalZ, centerZ), _mm_load_ps(&planes.distance[i])));
+		__m128 radius = _mm_add_ps(
+			_mm_add_ps(
+				_mm_mul_ps(_mm_andnot_ps(signBits, normalX), extentX),
+				_mm_mul_ps(_mm_andnot_ps(signBits, normalY), extentY)),
+			_mm_mul_ps(_mm_andnot_ps(signBits, normalZ), extentZ));
+
+		if (_mm_movemask_ps(_mm_cmplt_ps(_mm_add_ps(distance, radius), zero)) != 0)
+		{
+			return(-1);
+		}
+		if (_mm_movemask_ps(_mm_cmplt_ps(_mm_sub_ps(distance, radius), zero)) != 0)
+		{
+			bInside = false;
+		}
+	}
+#else
+	for (int i = 0; i < 6; i++)
+	{
+		float distance =
+			planes.normalX[i] * bounds.center.x +
+			planes.normalY[i] * bounds.center.y +
+			planes.normalZ[i] * bounds.center.z +
+			planes.distance[i];
+		float radius =
+			fabsf(planes.normalX[i]) * bounds.extent.x +
+			fabsf(planes.normalY[i]) * bounds.extent.y +
+			fabsf(planes.normalZ[i]) * bounds.extent.z;
+
+		if (distance + radius < 0.0f)
+		{
+			return(-1);
+		}
+		if (distance - radius < 0.0f)
+		{
+			bInside = false;
+		}
+	}
+#endif
+
+	return(bInside ? 1 : 0);
+}
+
+/***********************************************************
+ *  MergeBounds()
+ *
+ *  This method is used for getting the box around two boxes.
+ ***********************************************************/
+BoundingVolumeTree::BOUNDS BoundingVolumeTree::MergeBounds(const BOUNDS& first, const BOUNDS& second)
+{
+	glm::vec3 boundsMin = glm::min(first.center - first.extent, second.center - second.extent);
+	glm::vec3 boundsMax = glm::max(first.center + first.extent, second.center + second.extent);
+	BOUNDS bounds;
+
+	bounds.center = (boundsMin + boundsMax) * 0.5f;
+	bounds.extent = (boundsMax - boundsMin) * 0.5f;
+
+	return(bounds);
+}
+
+/***********************************************************
+ *  TransformBounds()
+ *
+ *  This method is used for getting the axis aligned box
+ *  around a box moved by a model matrix.  Each axis of the
+ *  new box reaches as far as the absolute values of the
+ *  matrix row take the half sizes of the box.
+ ***********************************************************/
+BoundingVolumeTree::BOUNDS BoundingVolumeTree::TransformBounds(const BOUNDS& bounds, const glm::mat4& matrix)
+{
+	BOUNDS result;
+
+	result.center = glm::vec3(matrix * glm::vec4(bounds.center, 1.0f));
+	for (int i = 0; i < 3; i++)
+	{
+		result.extent[i] =
+			fabsf(matrix[0][i]) * bounds.extent.x +
+			fabsf(matrix[1][i]) * bounds.extent.y +
+			fabsf(matrix[2][i]) * bounds.extent.z;
+	}
+
+	return(result);
+}
+
+/***********************************************************
+ *  GetNodeCount()
+ *
+ *  This method is used for getting the number of nodes.
+ ***********************************************************/
+int BoundingVolumeTree::GetNodeCount() const
+{
+	return((int)m_nodes.size());
+}
@@ -0,0 +1,92 @@
+///////////////////////////////////////////////////////////////////////////////
+// boundingvolumetree.h
+// ============
+// find the scene draws inside the view frustum
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  BoundingVolumeTree
+ *
+ *  This class holds a tree of axis aligned bounding boxes
+ *  over a list of items, built by splitting the items at
+ *  the median of the longest axis.  The nodes are kept in a
+ *  flat array in preorder, where each node knows the end of
+ *  its subtree and the range of the items below it, so the
+ *  tree is walked without a stack.  A node outside the view
+ *  frustum skips its subtree, and a node fully inside adds
+ *  all of its items without any more tests.  Each box is
+ *  tested against four frustum planes at a time with SSE.
+ *  Moved items only refit the boxes, so the tree is only
+ *  built once.
+ ***********************************************************/
+class BoundingVolumeTree
+{
+public:
+	// a box as its center and its half size along each axis
+	struct BOUNDS
+	{
+		glm::vec3 center;
+		glm::vec3 extent;
+	};
+
+	// build the tree over the bounds of the items
+	void Build(const std::vector<BOUNDS>& items);
+	// fit the boxes of the tree to the moved bounds of the items,
+	// which have to be the items that the tree was built over
+	void Refit(const std::vector<BOUNDS>& items);
+	// remove every node and item
+	void Clear();
+
+	// replace the passed in list with the indices of the items
+	// inside the frustum of a view projection matrix
+	void CullFrustum(const glm::mat4& viewProjection, std::vector<uint32_t>& visible) const;
+
+	int GetNodeCount() const;
+
+	// get the box around a box moved by a model matrix
+	static BOUNDS TransformBounds(const BOUNDS& bounds, const glm::mat4& matrix);
+
+private:
+	struct BVH_NODE
+	{
+		BOUNDS bounds;
+		// the items below the node, in the item order
+		uint32_t firstItem;
+		uint32_t itemCount;
+		// the node after the last node of the subtree - the node
+		// is a leaf when this is the next node
+		int subtreeEnd;
+	};
+
+	// the frustum planes as structure of arrays, padded to eight
+	// planes with planes that hold everything
+	struct FRUSTUM_PLANES
+	{
+		alignas(16) float normalX[8];
+		alignas(16) float normalY[8];
+		alignas(16) float normalZ[8];
+		alignas(16) float distance[8];
+	};
+
+	// add the nodes for a range of the item order
+	void BuildNode(const std::vector<BOUNDS>& items, uint32_t first, uint32_t count);
+	// test a box against the planes, and return -1 when it is
+	// outside, 1 when it is fully inside, and 0 otherwise
+	static int TestBounds(const FRUSTUM_PLANES& planes, const BOUNDS& bounds);
+	// get the box around two boxes
+	static BOUNDS MergeBounds(const BOUNDS& first, const BOUNDS& second);
+
+	std::vector<BVH_NODE> m_nodes;
+	// the item indices ordered so that every node covers a range
+	std::vector<uint32_t> m_itemOrder;
+	// the bounds of the items at the last build or refit
+	std::vector<BOUNDS> m_itemBounds;
+};
@@ -0,0 +1,192 @@
+///////////////////////////////////////////////////////////////////////////////
+// drawsortkeys.cpp
+// ============
+// pack the state of every draw into a key and sort the keys
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "DrawSortKeys.h"
+
+#include <cstring>
+#include <iostream>
+
+// declarations for the global variables and defines
+namespace
+{
+	// width of each field of a key, in bits
+	const int PASS_BITS = 2;
+	const int TRANSPARENT_BITS = 1;
+	const int MESH_BITS = 6;
+	const int TEXTURE_BITS = 12;
+	const int MATERIAL_BITS = 10;
+	const int DEPTH_BITS = 17;
+	const int DRAW_BITS = 16;
+
+	// whether a value too large for the mesh, texture and material
+	// fields was already reported
+	bool g_bMeshOverflow = false;
+	bool g_bTextureOverflow = false;
+	bool g_bMaterialOverflow = false;
+
+	/***********************************************************
+	 *  PackField()
+	 *
+	 *  Clamp a value to the width of a key field.
+	 ***********************************************************/
+	uint64_t PackField(int64_t value, int bits)
+	{
+		int64_t maxValue = ((int64_t)1 << bits) - 1;
+
+		if (value < 0)
+		{
+			return(0);
+		}
+		if (value > maxValue)
+		{
+			return((uint64_t)maxValue);
+		}
+		return((uint64_t)value);
+	}
+
+	/***********************************************************
+	 *  PackStateField()
+	 *
+	 *  Clamp a state value to the width of a key field, and
+	 *  report the first value of the field that does not fit.
+	 ***********************************************************/
+	uint64_t PackStateField(int64_t value, int bits, const char* name, bool& bReported)
+	{
+		int64_t maxValue = ((int64_t)1 << bits) - 1;
+
+		if ((value > maxValue) && (bReported == false))
+		{
+			std::cout << "Draw sort keys have " << bits << " bits for the " << name
+				<< ", which is too few for this scene - draws of different "
+				<< name << " values now share their keys" << std::endl;
+			bReported = true;
+		}
+
+		return(PackField(value, bits));
+	}
+}
+
+/***********************************************************
+ *  MakeKey()
+ *
+ *  This method is used for packing the state of a draw into
+ *  a sort key.  The texture and material move up by one so
+ *  that draws without them sort first.
+ ***********************************************************/
+uint64_t DrawSortKeys::MakeKey(
+	int pass,
+	bool bTransparent,
+	int mesh,
+	int texture,
+	int material,
+	float depth,
+	uint32_t drawIndex)
+{
+	uint64_t depthValue = PackField((int64_t)(depth * (float)((1 << DEPTH_BITS) - 1)), DEPTH_BITS);
+	uint64_t state = PackStateField(mesh, MESH_BITS, "mesh", g_bMeshOverflow);
+	state = (state << TEXTURE_BITS) | PackStateField((int64_t)texture + 1, TEXTURE_BITS, "texture", g_bTextureOverflow);
+	state = (state << MATERIAL_BITS) | PackStateField((int64_t)material + 1, MATERIAL_BITS, "material", g_bMaterialOverflow);
+
+	uint64_t key = PackField(pass, PASS_BITS);
+	key = (key << TRANSPARENT_BITS) | (bTransparent ? 1 : 0);
+	if (bTransparent == false)
+	{
+		key = (key << (MESH_BITS + TEXTURE_BITS + MATERIAL_BITS)) | state;
+		key = (key << DEPTH_BITS) | depthValue;
+	}
+	else
+	{
+		// far draws first, then grouped by state at the same depth
+		key = (key << DEPTH_BITS) | (((1 << DEPTH_BITS) - 1) - depthValue);
+		key = (key << (MESH_BITS + TEXTURE_BITS + MATERIAL_BITS)) | state;
+	}
+	key = (key << DRAW_BITS) | PackField(drawIndex, DRAW_BITS);
+
+	return(key);
+}
+
+/***********************************************************
+ *  GetDrawIndex()
+ *
+ *  This method is used for getting the index of the draw
+ *  that a key was made for.
+ ***********************************************************/
+uint32_t DrawSortKeys::GetDrawIndex(uint64_t key)
+{
+	return((uint32_t)(key & MAX_DRAW_INDEX));
+}
+
+/***********************************************************
+ *  Sort()
+ *
+ *  This method is used for sorting keys with a least
+ *  significant byte first radix sort.  Each of the eight
+ *  passes counts the keys per byte value and scatters them
+ *  in a stable order.  A pass where all of the keys share
+ *  the byte value would not move anything and is skipped,
+ *  which drops most passes for the mostly equal high bytes
+ *  of a small scene.
+ ***********************************************************/
+void DrawSortKeys::Sort(std::vector<uint64_t>& keys)
+{
+	size_t count = keys.size();
+	size_t histograms[8][256];
+
+	if (count < 2)
+	{
+		return;
+	}
+
+	// count every byte position in one pass over the keys
+	memset(histograms, 0, sizeof(histograms));
+	for (size_t i = 0; i < count; i++)
+	{
+		uint64_t key = keys[i];
+		for (int byte = 0; byte < 8; byte++)
+		{
+			histograms[byte][(key >> (byte * 8)) & 0xFF]++;
+		}
+	}
+
+	m_scratch.resize(count);
+	uint64_t* source = keys.data();
+	uint64_t* target = m_scratch.data();
+
+	for (int byte = 0; byte < 8; byte++)
+	{
+		size_t* histogram = histograms[byte];
+		int shift = byte * 8;
+
+		if (histogram[(source[0] >> shift) & 0xFF] == count)
+		{
+			continue;
+		}
+
+		size_t offset = 0;
+		for (int value = 0; value < 256; value++)
+		{
+			size_t valueCount = histogram[value];
+			histogram[value] = offset;
+			offset += valueCount;
+		}
+
+		for (size_t i = 0; i < count; i++)
+		{
+			uint64_t key = source[i];
+			target[histogram[(key >> shift) & 0xFF]++] = key;
+		}
+
+		uint64_t* swap = source;
+		source = target;
+		target = swap;
+	}
+
+	if (source != keys.data())
+	{
+		memcpy(keys.data(), source, count * sizeof(uint64_t));
+	}
+}
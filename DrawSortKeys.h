@@ -0,0 +1,61 @@
+///////////////////////////////////////////////////////////////////////////////
+// drawsortkeys.h
+// ============
+// pack the state of every draw into a key and sort the keys
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  DrawSortKeys
+ *
+ *  This class packs the render state of a draw into one
+ *  64-bit key, so that sorting the keys groups draws that
+ *  share a mesh, texture and material.  From the top bit
+ *  down, an opaque key holds
+ *
+ *    pass:2 | transparent:1 | mesh:6 | texture:12 |
+ *    material:10 | depth:17 | draw:16
+ *
+ *  and draws of the same state are ordered front to back,
+ *  which lets the depth test reject hidden fragments early.
+ *  Transparent keys sort after the opaque keys of a pass,
+ *  and hold the depth first, inverted, so that they are
+ *  drawn back to front for blending.  The draw index in the
+ *  low bits leads back to the draw after sorting.  A state
+ *  value too large for its field is reported once, since
+ *  the draws past the limit then share their keys.
+ ***********************************************************/
+class DrawSortKeys
+{
+public:
+	// the largest draw index that fits into a key
+	static const uint32_t MAX_DRAW_INDEX = 0xFFFF;
+
+	// pack the state of a draw into a key - the texture and material
+	// are -1 for none, and the depth runs from 0 at the camera to 1
+	// at the far end of the sorted range
+	static uint64_t MakeKey(
+		int pass,
+		bool bTransparent,
+		int mesh,
+		int texture,
+		int material,
+		float depth,
+		uint32_t drawIndex);
+	// get the index of the draw that a key was made for
+	static uint32_t GetDrawIndex(uint64_t key);
+
+	// sort keys in ascending order with a radix sort, skipping the
+	// byte positions where every key holds the same value
+	void Sort(std::vector<uint64_t>& keys);
+
+private:
+	// keys are moved back and forth between the sorted list and this
+	// list, which keeps its memory from frame to frame
+	std::vector<uint64_t> m_scratch;
+};
@@ -20,6 +20,9 @@ namespace
 	// Macro for window title
 	const char* const WINDOW_TITLE = "Burak Tutkavul"; 
 
+	// scene file loaded when no scene file is given on the command line
+	const char* const DEFAULT_SCENE_FILE = "Scenes/desk.scene";
+
 	// Main GLFW window
 	GLFWwindow* g_Window = nullptr;
 
@@ -74,7 +77,10 @@ int main(int argc, char* argv[])
 
 	// try to create a new scene manager object and prepare the 3D scene
 	g_SceneManager = new SceneManager(g_ShaderManager);
-	g_SceneManager->PrepareScene();
+	if (g_SceneManager->PrepareScene((argc > 1) ? argv[1] : DEFAULT_SCENE_FILE) == false)
+	{
+		return(EXIT_FAILURE);
+	}
 
 	// loop will keep running until the application is closed 
 	// or until an error has occurred
@@ -89,6 +95,9 @@ int main(int argc, char* argv[])
 
 		// convert from 3D object space to 2D view
 		g_ViewManager->PrepareSceneView();
+		g_SceneManager->SetViewTransform(
+			g_ViewManager->GetViewMatrix(),
+			g_ViewManager->GetProjectionMatrix());
 
 		// refresh the 3D scene
 		g_SceneManager->RenderScene();
@@ -0,0 +1,459 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshbuffer.cpp
+// ============
+// hold the basic meshes together in shared vertex and index buffers
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "MeshBuffer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+
+namespace
+{
+	// the largest values of the 16 bit fractions
+	const float UNORM16_MAX = 65535.0f;
+	const float SNORM16_MAX = 32767.0f;
+
+	/***********************************************************
+	 *  FloatToHalf()
+	 *
+	 *  This function is used for converting a float into a
+	 *  half float, rounding the mantissa to the nearest value.
+	 *  Values too large for a half float become infinite.
+	 ***********************************************************/
+	uint16_t FloatToHalf(float value)
+	{
+		uint32_t bits = 0;
+		memcpy(&bits, &value, sizeof(bits));
+
+		uint16_t sign = (uint16_t)((bits >> 16) & 0x8000);
+		int32_t exponent = (int32_t)((bits >> 23) & 0xff) - 127 + 15;
+		uint32_t mantissa = bits & 0x7fffff;
+
+		if (exponent >= 31)
+		{
+			return((uint16_t)(sign | 0x7c00));
+		}
+		if (exponent <= 0)
+		{
+			// denormal halves keep the implicit bit in the mantissa
+			if (exponent < -10)
+			{
+				return(sign);
+			}
+			mantissa |= 0x800000;
+			return((uint16_t)(sign | (mantissa >> (14 - exponent))));
+		}
+
+		// a carry out of the mantissa correctly moves to the exponent
+		uint32_t half = ((uint32_t)exponent << 10) | (mantissa >> 13);
+		if ((mantissa & 0x1000) != 0)
+		{
+			half++;
+		}
+		return((uint16_t)(sign | half));
+	}
+
+	/***********************************************************
+	 *  FloatToSnorm16()
+	 *
+	 *  This function is used for converting a value between -1
+	 *  and 1 into a 16 bit signed fraction.
+	 ***********************************************************/
+	int16_t FloatToSnorm16(float value)
+	{
+		value = std::min(std::max(value, -1.0f), 1.0f);
+		return((int16_t)std::lround(value * SNORM16_MAX));
+	}
+}
+
+/***********************************************************
+ *  MeshBuffer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+MeshBuffer::MeshBuffer()
+{
+	m_vertexArray = 0;
+	m_vertexBuffer = 0;
+	m_indexBuffer = 0;
+	m_vertexFormat = VERTEX_FORMAT_FLOAT;
+	m_positionOffset = glm::vec3(0.0f);
+	m_positionScale = glm::vec3(1.0f);
+}
+
+/***********************************************************
+ *  ~MeshBuffer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+MeshBuffer::~MeshBuffer()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  AddMesh()
+ *
+ *  This method is used for appending a mesh to the shared
+ *  vertices and indices.  The indices stay relative to the
+ *  mesh, and the base vertex moves them to its vertices.
+ ***********************************************************/
+int MeshBuffer::AddMesh(const MeshGeometry::MESH_DATA& mesh)
+{
+	MESH_RANGE range;
+	uint32_t firstIndex = (uint32_t)m_indices.size();
+
+	range.baseVertex = (int32_t)m_vertices.size();
+	for (int i = 0; i < MeshGeometry::MESH_PART_COUNT; i++)
+	{
+		range.partFirst[i] = firstIndex + mesh.partFirst[i];
+		range.partCount[i] = mesh.partCount[i];
+	}
+
+	m_vertices.insert(m_vertices.end(), mesh.vertices.begin(), mesh.vertices.end());
+	m_indices.insert(m_indices.end(), mesh.indices.begin(), mesh.indices.end());
+	m_ranges.push_back(range);
+
+	return((int)m_ranges.size() - 1);
+}
+
+/***********************************************************
+ *  Upload()
+ *
+ *  This method is used for creating the vertex array and
+ *  the buffers with every added mesh.
+ ***********************************************************/
+bool MeshBuffer::Upload(VERTEX_FORMAT format)
+{
+	if ((m_vertices.size() == 0) || (m_indices.size() == 0))
+	{
+		return(false);
+	}
+
+	if (m_vertexArray == 0)
+	{
+		glGenVertexArrays(1, &m_vertexArray);
+		glGenBuffers(1, &m_vertexBuffer);
+		glGenBuffers(1, &m_indexBuffer);
+	}
+
+	m_vertexFormat = format;
+	m_positionOffset = glm::vec3(0.0f);
+	m_positionScale = glm::vec3(1.0f);
+
+	glBindVertexArray(m_vertexArray);
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_indices.size() * sizeof(uint32_t), m_indices.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+
+	if (format == VERTEX_FORMAT_PACKED)
+	{
+		UploadPackedVertices();
+	}
+	else
+	{
+		glBufferData(GL_ARRAY_BUFFER, m_vertices.size() * sizeof(MeshGeometry::VERTEX), m_vertices.data(), GL_STATIC_DRAW);
+
+		GLsizei stride = sizeof(MeshGeometry::VERTEX);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(MeshGeometry::VERTEX, position));
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(MeshGeometry::VERTEX, normal));
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(MeshGeometry::VERTEX, uv));
+		glEnableVertexAttribArray(2);
+	}
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	return(true);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for freeing the OpenGL buffers and
+ *  forgetting the added meshes.
+ ***********************************************************/
+void MeshBuffer::Destroy()
+{
+	if (m_vertexArray != 0)
+	{
+		glDeleteVertexArrays(1, &m_vertexArray);
+		glDeleteBuffers(1, &m_vertexBuffer);
+		glDeleteBuffers(1, &m_indexBuffer);
+		m_vertexArray = 0;
+		m_vertexBuffer = 0;
+		m_indexBuffer = 0;
+	}
+
+	m_vertices.clear();
+	m_indices.clear();
+	m_ranges.clear();
+}
+
+/***********************************************************
+ *  Bind()
+ *
+ *  This method is used for binding the shared vertex array
+ *  before drawing the meshes.
+ ***********************************************************/
+void MeshBuffer::Bind() const
+{
+	glBindVertexArray(m_vertexArray);
+}
+
+/***********************************************************
+ *  Unbind()
+ *
+ *  This method is used for unbinding the shared vertex array
+ *  after drawing the meshes.
+ ***********************************************************/
+void MeshBuffer::Unbind() const
+{
+	glBindVertexArray(0);
+}
+
+/***********************************************************
+ *  DrawInstanced()
+ *
+ *  This method is used for drawing the chosen parts of a
+ *  mesh for a run of instances.  The shader finds the data
+ *  of each instance at gl_BaseInstance + gl_InstanceID.
+ ***********************************************************/
+void MeshBuffer::DrawInstanced(
+	int mesh,
+	bool bDrawTop,
+	bool bDrawBottom,
+	bool bDrawSides,
+	int instanceCount,
+	int baseInstance) const
+{
+	const MESH_RANGE& range = m_ranges[mesh];
+	const bool bDrawPart[MeshGeometry::MESH_PART_COUNT] = { bDrawSides, bDrawTop, bDrawBottom };
+
+	for (int i = 0; i < MeshGeometry::MESH_PART_COUNT; i++)
+	{
+		if ((bDrawPart[i] == false) || (range.partCount[i] == 0))
+		{
+			continue;
+		}
+
+		glDrawElementsInstancedBaseVertexBaseInstance(
+			GL_TRIANGLES,
+			range.partCount[i],
+			GL_UNSIGNED_INT,
+			(void*)(range.partFirst[i] * sizeof(uint32_t)),
+			instanceCount,
+			range.baseVertex,
+			baseInstance);
+	}
+}
+
+/***********************************************************
+ *  AddDrawCommands()
+ *
+ *  This method is used for appending one indirect draw
+ *  command for each chosen part of a mesh that holds any
+ *  triangles.
+ ***********************************************************/
+void MeshBuffer::AddDrawCommands(
+	int mesh,
+	bool bDrawTop,
+	bool bDrawBottom,
+	bool bDrawSides,
+	int instanceCount,
+	int baseInstance,
+	std::vector<DRAW_ELEMENTS_COMMAND>& commands) const
+{
+	const MESH_RANGE& range = m_ranges[mesh];
+	const bool bDrawPart[MeshGeometry::MESH_PART_COUNT] = { bDrawSides, bDrawTop, bDrawBottom };
+
+	for (int i = 0; i < MeshGeometry::MESH_PART_COUNT; i++)
+	{
+		if ((bDrawPart[i] == false) || (range.partCount[i] == 0))
+		{
+			continue;
+		}
+
+		DRAW_ELEMENTS_COMMAND command;
+		command.count = range.partCount[i];
+		command.instanceCount = (uint32_t)instanceCount;
+		command.firstIndex = range.partFirst[i];
+		command.baseVertex = range.baseVertex;
+		command.baseInstance = (uint32_t)baseInstance;
+		commands.push_back(command);
+	}
+}
+
+/***********************************************************
+ *  DrawIndirect()
+ *
+ *  This method is used for drawing a range of the commands
+ *  in the indirect buffer bound by the caller, with a single
+ *  multi draw.
+ ***********************************************************/
+void MeshBuffer::DrawIndirect(size_t firstCommand, int commandCount) const
+{
+	if (commandCount <= 0)
+	{
+		return;
+	}
+
+	glMultiDrawElementsIndirect(
+		GL_TRIANGLES,
+		GL_UNSIGNED_INT,
+		(void*)(firstCommand * sizeof(DRAW_ELEMENTS_COMMAND)),
+		commandCount,
+		sizeof(DRAW_ELEMENTS_COMMAND));
+}
+
+/***********************************************************
+ *  GetRange()
+ *
+ *  This method is used for getting where a mesh lies in the
+ *  shared buffers.
+ ***********************************************************/
+const MeshBuffer::MESH_RANGE& MeshBuffer::GetRange(int mesh) const
+{
+	return(m_ranges[mesh]);
+}
+
+/***********************************************************
+ *  GetMeshCount()
+ *
+ *  This method is used for getting the number of meshes.
+ ***********************************************************/
+int MeshBuffer::GetMeshCount() const
+{
+	return((int)m_ranges.size());
+}
+
+/***********************************************************
+ *  GetVertexFormat()
+ *
+ *  This method is used for getting the layout that the
+ *  vertices were uploaded in.
+ ***********************************************************/
+MeshBuffer::VERTEX_FORMAT MeshBuffer::GetVertexFormat() const
+{
+	return(m_vertexFormat);
+}
+
+/***********************************************************
+ *  GetPositionOffset()
+ *
+ *  This method is used for getting the lowest corner of the
+ *  bounds around the packed positions.
+ ***********************************************************/
+const glm::vec3& MeshBuffer::GetPositionOffset() const
+{
+	return(m_positionOffset);
+}
+
+/***********************************************************
+ *  GetPositionScale()
+ *
+ *  This method is used for getting the size of the bounds
+ *  around the packed positions.
+ ***********************************************************/
+const glm::vec3& MeshBuffer::GetPositionScale() const
+{
+	return(m_positionScale);
+}
+
+/***********************************************************
+ *  PackVertex()
+ *
+ *  This method is used for packing a vertex.  The position
+ *  becomes three fractions of the bounds.  The normal is
+ *  projected onto the octahedron with its corners on the
+ *  axes, and the lower half of the octahedron is folded out
+ *  over the corners of the square, which leaves the two
+ *  coordinates of a point in the square.
+ ***********************************************************/
+MeshBuffer::PACKED_VERTEX MeshBuffer::PackVertex(
+	const MeshGeometry::VERTEX& vertex,
+	const glm::vec3& positionOffset,
+	const glm::vec3& positionScale)
+{
+	PACKED_VERTEX packed;
+
+	for (int i = 0; i < 3; i++)
+	{
+		float fraction = (vertex.position[i] - positionOffset[i]) / positionScale[i];
+		fraction = std::min(std::max(fraction, 0.0f), 1.0f);
+		packed.position[i] = (uint16_t)std::lround(fraction * UNORM16_MAX);
+	}
+	packed.position[3] = 0;
+
+	const glm::vec3& normal = vertex.normal;
+	float length = std::fabs(normal.x) + std::fabs(normal.y) + std::fabs(normal.z);
+	float x = (length > 0.0f) ? normal.x / length : 0.0f;
+	float y = (length > 0.0f) ? normal.y / length : 0.0f;
+	if (normal.z < 0.0f)
+	{
+		float foldedX = (1.0f - std::fabs(y)) * ((x >= 0.0f) ? 1.0f : -1.0f);
+		float foldedY = (1.0f - std::fabs(x)) * ((y >= 0.0f) ? 1.0f : -1.0f);
+		x = foldedX;
+		y = foldedY;
+	}
+	packed.normal[0] = FloatToSnorm16(x);
+	packed.normal[1] = FloatToSnorm16(y);
+
+	packed.uv[0] = FloatToHalf(vertex.uv.x);
+	packed.uv[1] = FloatToHalf(vertex.uv.y);
+
+	return(packed);
+}
+
+/***********************************************************
+ *  UploadPackedVertices()
+ *
+ *  This method is used for packing every added vertex into
+ *  the bound vertex buffer.  The positions are packed into
+ *  the bounds of all of the meshes, so that one pair of
+ *  values moves every packed position back for the shader.
+ ***********************************************************/
+void MeshBuffer::UploadPackedVertices()
+{
+	glm::vec3 lowest = m_vertices[0].position;
+	glm::vec3 highest = m_vertices[0].position;
+	for (size_t i = 1; i < m_vertices.size(); i++)
+	{
+		lowest = glm::min(lowest, m_vertices[i].position);
+		highest = glm::max(highest, m_vertices[i].position);
+	}
+
+	m_positionOffset = lowest;
+	m_positionScale = highest - lowest;
+	for (int i = 0; i < 3; i++)
+	{
+		if (m_positionScale[i] <= 0.0f)
+		{
+			m_positionScale[i] = 1.0f;
+		}
+	}
+
+	std::vector<PACKED_VERTEX> packed(m_vertices.size());
+	for (size_t i = 0; i < m_vertices.size(); i++)
+	{
+		packed[i] = PackVertex(m_vertices[i], m_positionOffset, m_positionScale);
+	}
+
+	glBufferData(GL_ARRAY_BUFFER, packed.size() * sizeof(PACKED_VERTEX), packed.data(), GL_STATIC_DRAW);
+
+	GLsizei stride = sizeof(PACKED_VERTEX);
+	glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, stride, (void*)offsetof(PACKED_VERTEX, position));
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, stride, (void*)offsetof(PACKED_VERTEX, normal));
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, stride, (void*)offsetof(PACKED_VERTEX, uv));
+	glEnableVertexAttribArray(2);
+}
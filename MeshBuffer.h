@@ -0,0 +1,144 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshbuffer.h
+// ============
+// hold the basic meshes together in shared vertex and index buffers
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "MeshGeometry.h"
+
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  MeshBuffer
+ *
+ *  This class packs the vertices and indices of several
+ *  meshes into one vertex buffer and one index buffer under
+ *  a single vertex array.  Every mesh keeps its base vertex
+ *  and the index ranges of its parts, so any of the meshes
+ *  can be drawn without switching buffers, and many copies
+ *  of a mesh can be drawn with one instanced draw.  The
+ *  draws can also be written as indirect draw commands, so
+ *  that many meshes are drawn with one multi draw.
+ *
+ *  The vertices can be uploaded packed into 16 bytes each:
+ *  positions as 16 bit fractions of the bounds of every
+ *  mesh in the buffer, normals in the octahedral encoding as
+ *  two 16 bit signed fractions, and texture coordinates as
+ *  half floats.  The shader then moves the positions back
+ *  into the bounds and decodes the normals.
+ ***********************************************************/
+class MeshBuffer
+{
+public:
+	// the layouts that the vertices are uploaded in
+	enum VERTEX_FORMAT
+	{
+		VERTEX_FORMAT_FLOAT,
+		VERTEX_FORMAT_PACKED
+	};
+
+	// the vertex layout of the packed format, with the same
+	// attribute locations as the float vertices
+	struct PACKED_VERTEX
+	{
+		uint16_t position[4];
+		int16_t normal[2];
+		uint16_t uv[2];
+	};
+
+	// where a mesh lies in the shared buffers
+	struct MESH_RANGE
+	{
+		int32_t baseVertex;
+		uint32_t partFirst[MeshGeometry::MESH_PART_COUNT];
+		uint32_t partCount[MeshGeometry::MESH_PART_COUNT];
+	};
+
+	// the DrawElementsIndirectCommand layout read by OpenGL
+	struct DRAW_ELEMENTS_COMMAND
+	{
+		uint32_t count;
+		uint32_t instanceCount;
+		uint32_t firstIndex;
+		int32_t baseVertex;
+		uint32_t baseInstance;
+	};
+
+	// constructor
+	MeshBuffer();
+	// destructor
+	~MeshBuffer();
+
+	// add a mesh to the buffers and return its index - meshes
+	// added after the upload are only drawn after the next upload
+	int AddMesh(const MeshGeometry::MESH_DATA& mesh);
+	// create the OpenGL buffers holding every added mesh, with
+	// the vertices in the chosen layout
+	bool Upload(VERTEX_FORMAT format = VERTEX_FORMAT_FLOAT);
+	// free the OpenGL buffers and forget the added meshes
+	void Destroy();
+
+	// bind and unbind the vertex array around the draws
+	void Bind() const;
+	void Unbind() const;
+
+	// draw the chosen parts of a mesh once for every instance,
+	// starting at the passed in instance
+	void DrawInstanced(
+		int mesh,
+		bool bDrawTop,
+		bool bDrawBottom,
+		bool bDrawSides,
+		int instanceCount,
+		int baseInstance) const;
+
+	// append the indirect draw commands for the chosen parts of
+	// a mesh, which are drawn once for every instance
+	void AddDrawCommands(
+		int mesh,
+		bool bDrawTop,
+		bool bDrawBottom,
+		bool bDrawSides,
+		int instanceCount,
+		int baseInstance,
+		std::vector<DRAW_ELEMENTS_COMMAND>& commands) const;
+	// draw a range of the commands in the bound indirect buffer
+	void DrawIndirect(size_t firstCommand, int commandCount) const;
+
+	const MESH_RANGE& GetRange(int mesh) const;
+	int GetMeshCount() const;
+
+	// the layout of the uploaded vertices, and the corner and
+	// size of the bounds that the packed positions are inside
+	VERTEX_FORMAT GetVertexFormat() const;
+	const glm::vec3& GetPositionOffset() const;
+	const glm::vec3& GetPositionScale() const;
+
+	// pack a vertex into the bounds with the passed in corner
+	// and size
+	static PACKED_VERTEX PackVertex(
+		const MeshGeometry::VERTEX& vertex,
+		const glm::vec3& positionOffset,
+		const glm::vec3& positionScale);
+
+private:
+	// write the packed vertices and set up their attributes
+	void UploadPackedVertices();
+
+
+	std::vector<MeshGeometry::VERTEX> m_vertices;
+	std::vector<uint32_t> m_indices;
+	std::vector<MESH_RANGE> m_ranges;
+	GLuint m_vertexArray;
+	GLuint m_vertexBuffer;
+	GLuint m_indexBuffer;
+	VERTEX_FORMAT m_vertexFormat;
+	glm::vec3 m_positionOffset;
+	glm::vec3 m_positionScale;
+};
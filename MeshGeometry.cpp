@@ -0,0 +1,451 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshgeometry.cpp
+// ============
+// build the vertices and indices of the basic meshes
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "MeshGeometry.h"
+
+#include <algorithm>
+#include <cmath>
+
+// declarations for the global variables and defines
+namespace
+{
+	const float PI = 3.14159265358979f;
+
+	// number of segments around the round meshes
+	const int ROUND_SLICES = 36;
+	// number of segments from pole to pole of the sphere
+	const int SPHERE_STACKS = 18;
+	// number of segments around the tube of the torus
+	const int TORUS_SIDES = 18;
+	// radius of the ring of the torus, from its center to the
+	// middle of the tube
+	const float TORUS_RADIUS = 1.0f;
+	// fewest segments that a round mesh is built with at any
+	// level of detail
+	const int MIN_SEGMENTS = 4;
+
+	/***********************************************************
+	 *  GetSegments()
+	 *
+	 *  Get the number of segments for a level of detail, which
+	 *  halves the number of segments at each level.
+	 ***********************************************************/
+	int GetSegments(int segments, int level)
+	{
+		return(std::max(segments >> level, MIN_SEGMENTS));
+	}
+}
+
+/***********************************************************
+ *  BeginMesh()
+ *
+ *  This method is used for starting a new empty mesh.
+ ***********************************************************/
+void MeshGeometry::BeginMesh(MESH_DATA& mesh)
+{
+	mesh.vertices.clear();
+	mesh.indices.clear();
+	for (int i = 0; i < MESH_PART_COUNT; i++)
+	{
+		mesh.partFirst[i] = 0;
+		mesh.partCount[i] = 0;
+	}
+}
+
+/***********************************************************
+ *  BeginPart()
+ *
+ *  This method is used for starting the indices of a part.
+ ***********************************************************/
+void MeshGeometry::BeginPart(MESH_DATA& mesh, MESH_PART part)
+{
+	mesh.partFirst[part] = (uint32_t)mesh.indices.size();
+}
+
+/***********************************************************
+ *  EndPart()
+ *
+ *  This method is used for ending the indices of a part.
+ ***********************************************************/
+void MeshGeometry::EndPart(MESH_DATA& mesh, MESH_PART part)
+{
+	mesh.partCount[part] = (uint32_t)mesh.indices.size() - mesh.partFirst[part];
+}
+
+/***********************************************************
+ *  AddPolygon()
+ *
+ *  This method is used for adding a flat convex polygon.
+ *  The corners are given counterclockwise as seen from the
+ *  front, and the normal is calculated from the first three.
+ ***********************************************************/
+void MeshGeometry::AddPolygon(
+	MESH_DATA& mesh,
+	const glm::vec3* positions,
+	const glm::vec2* uvs,
+	int count)
+{
+	glm::vec3 normal = glm::normalize(glm::cross(
+		positions[1] - positions[0],
+		positions[2] - positions[0]));
+	uint32_t first = (uint32_t)mesh.vertices.size();
+
+	for (int i = 0; i < count; i++)
+	{
+		VERTEX vertex;
+		vertex.position = positions[i];
+		vertex.normal = normal;
+		vertex.uv = uvs[i];
+		mesh.vertices.push_back(vertex);
+	}
+	for (int i = 1; i + 1 < count; i++)
+	{
+		mesh.indices.push_back(first);
+		mesh.indices.push_back(first + i);
+		mesh.indices.push_back(first + i + 1);
+	}
+}
+
+/***********************************************************
+ *  BuildBox()
+ *
+ *  This method is used for building a box with a side of 1.
+ ***********************************************************/
+void MeshGeometry::BuildBox(MESH_DATA& mesh)
+{
+	const glm::vec3 faces[6][4] =
+	{
+		{ { -0.5f, -0.5f, 0.5f }, { 0.5f, -0.5f, 0.5f }, { 0.5f, 0.5f, 0.5f }, { -0.5f, 0.5f, 0.5f } },
+		{ { 0.5f, -0.5f, -0.5f }, { -0.5f, -0.5f, -0.5f }, { -0.5f, 0.5f, -0.5f }, { 0.5f, 0.5f, -0.5f } },
+		{ { 0.5f, -0.5f, 0.5f }, { 0.5f, -0.5f, -0.5f }, { 0.5f, 0.5f, -0.5f }, { 0.5f, 0.5f, 0.5f } },
+		{ { -0.5f, -0.5f, -0.5f }, { -0.5f, -0.5f, 0.5f }, { -0.5f, 0.5f, 0.5f }, { -0.5f, 0.5f, -0.5f } },
+		{ { -0.5f, 0.5f, 0.5f }, { 0.5f, 0.5f, 0.5f }, { 0.5f, 0.5f, -0.5f }, { -0.5f, 0.5f, -0.5f } },
+		{ { -0.5f, -0.5f, -0.5f }, { 0.5f, -0.5f, -0.5f }, { 0.5f, -0.5f, 0.5f }, { -0.5f, -0.5f, 0.5f } }
+	};
+	const glm::vec2 uvs[4] = { { 0.0f, 0.0f }, { 1.0f, 0.0f }, { 1.0f, 1.0f }, { 0.0f, 1.0f } };
+
+	BeginMesh(mesh);
+	BeginPart(mesh, MESH_PART_SIDES);
+	for (int i = 0; i < 6; i++)
+	{
+		AddPolygon(mesh, faces[i], uvs, 4);
+	}
+	EndPart(mesh, MESH_PART_SIDES);
+}
+
+/***********************************************************
+ *  BuildPlane()
+ *
+ *  This method is used for building a plane facing up.
+ ***********************************************************/
+void MeshGeometry::BuildPlane(MESH_DATA& mesh)
+{
+	const glm::vec3 corners[4] =
+	{
+		{ -1.0f, 0.0f, 1.0f }, { 1.0f, 0.0f, 1.0f }, { 1.0f, 0.0f, -1.0f }, { -1.0f, 0.0f, -1.0f }
+	};
+	const glm::vec2 uvs[4] = { { 0.0f, 0.0f }, { 1.0f, 0.0f }, { 1.0f, 1.0f }, { 0.0f, 1.0f } };
+
+	BeginMesh(mesh);
+	BeginPart(mesh, MESH_PART_SIDES);
+	AddPolygon(mesh, corners, uvs, 4);
+	EndPart(mesh, MESH_PART_SIDES);
+}
+
+/***********************************************************
+ *  BuildFrustum()
+ *
+ *  This method is used for building the sides and caps of a
+ *  round mesh that narrows from the bottom radius at a
+ *  height of 0 to the top radius at a height of 1.  A top
+ *  radius of 0 leaves out the top cap.  The number of slices
+ *  around the mesh follows the level of detail.
+ ***********************************************************/
+void MeshGeometry::BuildFrustum(MESH_DATA& mesh, float bottomRadius, float topRadius, int level)
+{
+	int slices = GetSegments(ROUND_SLICES, level);
+
+	BeginMesh(mesh);
+
+	// the sides, with normals that lean with the slope
+	BeginPart(mesh, MESH_PART_SIDES);
+	uint32_t first = (uint32_t)mesh.vertices.size();
+	for (int i = 0; i <= slices; i++)
+	{
+		float angle = 2.0f * PI * (float)i / (float)slices;
+		float s = sinf(angle);
+		float c = cosf(angle);
+		glm::vec3 normal = glm::normalize(glm::vec3(s, bottomRadius - topRadius, c));
+
+		VERTEX bottom;
+		bottom.position = glm::vec3(bottomRadius * s, 0.0f, bottomRadius * c);
+		bottom.normal = normal;
+		bottom.uv = glm::vec2((float)i / (float)slices, 0.0f);
+		VERTEX top;
+		top.position = glm::vec3(topRadius * s, 1.0f, topRadius * c);
+		top.normal = normal;
+		top.uv = glm::vec2((float)i / (float)slices, 1.0f);
+
+		mesh.vertices.push_back(bottom);
+		mesh.vertices.push_back(top);
+	}
+	for (int i = 0; i < slices; i++)
+	{
+		uint32_t bottom = first + 2 * i;
+		mesh.indices.push_back(bottom);
+		mesh.indices.push_back(bottom + 2);
+		mesh.indices.push_back(bottom + 1);
+		mesh.indices.push_back(bottom + 1);
+		mesh.indices.push_back(bottom + 2);
+		mesh.indices.push_back(bottom + 3);
+	}
+	EndPart(mesh, MESH_PART_SIDES);
+
+	// the caps, as fans around their centers
+	for (int cap = 0; cap < 2; cap++)
+	{
+		MESH_PART part = (cap == 0) ? MESH_PART_TOP : MESH_PART_BOTTOM;
+		float radius = (cap == 0) ? topRadius : bottomRadius;
+		float height = (cap == 0) ? 1.0f : 0.0f;
+		glm::vec3 normal = glm::vec3(0.0f, (cap == 0) ? 1.0f : -1.0f, 0.0f);
+
+		BeginPart(mesh, part);
+		if (radius > 0.0f)
+		{
+			uint32_t center = (uint32_t)mesh.vertices.size();
+			VERTEX vertex;
+			vertex.position = glm::vec3(0.0f, height, 0.0f);
+			vertex.normal = normal;
+			vertex.uv = glm::vec2(0.5f, 0.5f);
+			mesh.vertices.push_back(vertex);
+
+			for (int i = 0; i <= slices; i++)
+			{
+				float angle = 2.0f * PI * (float)i / (float)slices;
+				vertex.position = glm::vec3(radius * sinf(angle), height, radius * cosf(angle));
+				vertex.uv = glm::vec2(0.5f + 0.5f * sinf(angle), 0.5f + 0.5f * cosf(angle));
+				mesh.vertices.push_back(vertex);
+			}
+			for (int i = 0; i < slices; i++)
+			{
+				// the bottom cap faces down, so it turns the other way
+				mesh.indices.push_back(center);
+				mesh.indices.push_back(center + 1 + ((cap == 0) ? i : i + 1));
+				mesh.indices.push_back(center + 1 + ((cap == 0) ? i + 1 : i));
+			}
+		}
+		EndPart(mesh, part);
+	}
+}
+
+/***********************************************************
+ *  BuildCylinder()
+ *
+ *  This method is used for building a cylinder.
+ ***********************************************************/
+void MeshGeometry::BuildCylinder(MESH_DATA& mesh, int level)
+{
+	BuildFrustum(mesh, 1.0f, 1.0f, level);
+}
+
+/***********************************************************
+ *  BuildCone()
+ *
+ *  This method is used for building a cone.
+ ***********************************************************/
+void MeshGeometry::BuildCone(MESH_DATA& mesh, int level)
+{
+	BuildFrustum(mesh, 1.0f, 0.0f, level);
+}
+
+/***********************************************************
+ *  BuildTaperedCylinder()
+ *
+ *  This method is used for building a cylinder that narrows
+ *  to half of its radius at the top.
+ ***********************************************************/
+void MeshGeometry::BuildTaperedCylinder(MESH_DATA& mesh, int level)
+{
+	BuildFrustum(mesh, 1.0f, 0.5f, level);
+}
+
+/***********************************************************
+ *  BuildPrism()
+ *
+ *  This method is used for building a prism with triangles
+ *  at the front and back.
+ ***********************************************************/
+void MeshGeometry::BuildPrism(MESH_DATA& mesh)
+{
+	const glm::vec3 front[3] = { { -0.5f, -0.5f, 0.5f }, { 0.5f, -0.5f, 0.5f }, { 0.0f, 0.5f, 0.5f } };
+	const glm::vec3 back[3] = { { 0.5f, -0.5f, -0.5f }, { -0.5f, -0.5f, -0.5f }, { 0.0f, 0.5f, -0.5f } };
+	const glm::vec3 faces[3][4] =
+	{
+		{ { -0.5f, -0.5f, -0.5f }, { 0.5f, -0.5f, -0.5f }, { 0.5f, -0.5f, 0.5f }, { -0.5f, -0.5f, 0.5f } },
+		{ { -0.5f, -0.5f, -0.5f }, { -0.5f, -0.5f, 0.5f }, { 0.0f, 0.5f, 0.5f }, { 0.0f, 0.5f, -0.5f } },
+		{ { 0.5f, -0.5f, 0.5f }, { 0.5f, -0.5f, -0.5f }, { 0.0f, 0.5f, -0.5f }, { 0.0f, 0.5f, 0.5f } }
+	};
+	const glm::vec2 triangleUVs[3] = { { 0.0f, 0.0f }, { 1.0f, 0.0f }, { 0.5f, 1.0f } };
+	const glm::vec2 uvs[4] = { { 0.0f, 0.0f }, { 1.0f, 0.0f }, { 1.0f, 1.0f }, { 0.0f, 1.0f } };
+
+	BeginMesh(mesh);
+	BeginPart(mesh, MESH_PART_SIDES);
+	AddPolygon(mesh, front, triangleUVs, 3);
+	AddPolygon(mesh, back, triangleUVs, 3);
+	for (int i = 0; i < 3; i++)
+	{
+		AddPolygon(mesh, faces[i], uvs, 4);
+	}
+	EndPart(mesh, MESH_PART_SIDES);
+}
+
+/***********************************************************
+ *  BuildPyramid4()
+ *
+ *  This method is used for building a pyramid with a square
+ *  base.
+ ***********************************************************/
+void MeshGeometry::BuildPyramid4(MESH_DATA& mesh)
+{
+	const glm::vec3 apex = glm::vec3(0.0f, 0.5f, 0.0f);
+	const glm::vec3 corners[4] =
+	{
+		{ -0.5f, -0.5f, 0.5f }, { 0.5f, -0.5f, 0.5f }, { 0.5f, -0.5f, -0.5f }, { -0.5f, -0.5f, -0.5f }
+	};
+	const glm::vec3 base[4] = { corners[3], corners[2], corners[1], corners[0] };
+	const glm::vec2 triangleUVs[3] = { { 0.0f, 0.0f }, { 1.0f, 0.0f }, { 0.5f, 1.0f } };
+	const glm::vec2 uvs[4] = { { 0.0f, 0.0f }, { 1.0f, 0.0f }, { 1.0f, 1.0f }, { 0.0f, 1.0f } };
+
+	BeginMesh(mesh);
+	BeginPart(mesh, MESH_PART_SIDES);
+	for (int i = 0; i < 4; i++)
+	{
+		const glm::vec3 side[3] = { corners[i], corners[(i + 1) % 4], apex };
+		AddPolygon(mesh, side, triangleUVs, 3);
+	}
+	EndPart(mesh, MESH_PART_SIDES);
+
+	BeginPart(mesh, MESH_PART_BOTTOM);
+	AddPolygon(mesh, base, uvs, 4);
+	EndPart(mesh, MESH_PART_BOTTOM);
+}
+
+/***********************************************************
+ *  BuildSphere()
+ *
+ *  This method is used for building a sphere from stacks of
+ *  rings between the poles.
+ ***********************************************************/
+void MeshGeometry::BuildSphere(MESH_DATA& mesh, int level)
+{
+	int slices = GetSegments(ROUND_SLICES, level);
+	int stacks = GetSegments(SPHERE_STACKS, level);
+
+	BeginMesh(mesh);
+	BeginPart(mesh, MESH_PART_SIDES);
+
+	for (int stack = 0; stack <= stacks; stack++)
+	{
+		float polar = PI * (float)stack / (float)stacks;
+		for (int slice = 0; slice <= slices; slice++)
+		{
+			float azimuth = 2.0f * PI * (float)slice / (float)slices;
+
+			VERTEX vertex;
+			vertex.normal = glm::vec3(
+				sinf(polar) * sinf(azimuth),
+				cosf(polar),
+				sinf(polar) * cosf(azimuth));
+			vertex.position = vertex.normal;
+			vertex.uv = glm::vec2(
+				(float)slice / (float)slices,
+				1.0f - (float)stack / (float)stacks);
+			mesh.vertices.push_back(vertex);
+		}
+	}
+
+	for (int stack = 0; stack < stacks; stack++)
+	{
+		for (int slice = 0; slice < slices; slice++)
+		{
+			uint32_t upper = stack * (slices + 1) + slice;
+			uint32_t lower = upper + slices + 1;
+
+			// the rings at the poles shrink to a point, which leaves
+			// one triangle of each quad there without any area
+			if (stack > 0)
+			{
+				mesh.indices.push_back(upper);
+				mesh.indices.push_back(lower);
+				mesh.indices.push_back(upper + 1);
+			}
+			if (stack < stacks - 1)
+			{
+				mesh.indices.push_back(upper + 1);
+				mesh.indices.push_back(lower);
+				mesh.indices.push_back(lower + 1);
+			}
+		}
+	}
+
+	EndPart(mesh, MESH_PART_SIDES);
+}
+
+/***********************************************************
+ *  BuildTorus()
+ *
+ *  This method is used for building a torus lying in the XY
+ *  plane, with a tube of the passed in thickness.
+ ***********************************************************/
+void MeshGeometry::BuildTorus(MESH_DATA& mesh, float thickness, int level)
+{
+	int rings = GetSegments(ROUND_SLICES, level);
+	int sides = GetSegments(TORUS_SIDES, level);
+
+	BeginMesh(mesh);
+	BeginPart(mesh, MESH_PART_SIDES);
+
+	for (int ring = 0; ring <= rings; ring++)
+	{
+		float ringAngle = 2.0f * PI * (float)ring / (float)rings;
+		for (int side = 0; side <= sides; side++)
+		{
+			float sideAngle = 2.0f * PI * (float)side / (float)sides;
+
+			VERTEX vertex;
+			vertex.normal = glm::vec3(
+				cosf(sideAngle) * cosf(ringAngle),
+				cosf(sideAngle) * sinf(ringAngle),
+				sinf(sideAngle));
+			vertex.position = glm::vec3(
+				TORUS_RADIUS * cosf(ringAngle),
+				TORUS_RADIUS * sinf(ringAngle),
+				0.0f) + thickness * vertex.normal;
+			vertex.uv = glm::vec2(
+				(float)ring / (float)rings,
+				(float)side / (float)sides);
+			mesh.vertices.push_back(vertex);
+		}
+	}
+
+	for (int ring = 0; ring < rings; ring++)
+	{
+		for (int side = 0; side < sides; side++)
+		{
+			uint32_t current = ring * (sides + 1) + side;
+			uint32_t next = current + sides + 1;
+			mesh.indices.push_back(current);
+			mesh.indices.push_back(next);
+			mesh.indices.push_back(current + 1);
+			mesh.indices.push_back(current + 1);
+			mesh.indices.push_back(next);
+			mesh.indices.push_back(next + 1);
+		}
+	}
+
+	EndPart(mesh, MESH_PART_SIDES);
+}
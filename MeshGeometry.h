@@ -0,0 +1,88 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshgeometry.h
+// ============
+// build the vertices and indices of the basic meshes
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  MeshGeometry
+ *
+ *  This class builds the basic meshes as indexed triangle
+ *  lists, with the same extents as the meshes of the shape
+ *  meshes object: the box, prism and pyramid fill the unit
+ *  cube around the origin, the plane spans -1 to 1 on X and
+ *  Z, the sphere has a radius of 1, and the cylinders and
+ *  cone stand on the origin with a radius of 1 and a height
+ *  of 1.  The indices of the sides, top and bottom of every
+ *  mesh are kept in separate ranges, so that a cylinder can
+ *  be drawn without its caps.  The round meshes can be built
+ *  at several levels of detail, where each level has half
+ *  of the segments of the level before it.
+ ***********************************************************/
+class MeshGeometry
+{
+public:
+	// the index ranges that a mesh is split into
+	enum MESH_PART
+	{
+		MESH_PART_SIDES,
+		MESH_PART_TOP,
+		MESH_PART_BOTTOM,
+		MESH_PART_COUNT
+	};
+
+	// the vertex layout of the shader - position at location 0,
+	// normal at location 1 and texture coordinate at location 2
+	struct VERTEX
+	{
+		glm::vec3 position;
+		glm::vec3 normal;
+		glm::vec2 uv;
+	};
+
+	struct MESH_DATA
+	{
+		std::vector<VERTEX> vertices;
+		std::vector<uint32_t> indices;
+		// the range of the indices of every part
+		uint32_t partFirst[MESH_PART_COUNT];
+		uint32_t partCount[MESH_PART_COUNT];
+	};
+
+	// number of levels of detail that the round meshes have,
+	// from level 0 with the most segments
+	static const int DETAIL_LEVELS = 3;
+
+	static void BuildBox(MESH_DATA& mesh);
+	static void BuildPlane(MESH_DATA& mesh);
+	static void BuildCylinder(MESH_DATA& mesh, int level = 0);
+	static void BuildCone(MESH_DATA& mesh, int level = 0);
+	static void BuildPrism(MESH_DATA& mesh);
+	static void BuildPyramid4(MESH_DATA& mesh);
+	static void BuildSphere(MESH_DATA& mesh, int level = 0);
+	static void BuildTaperedCylinder(MESH_DATA& mesh, int level = 0);
+	static void BuildTorus(MESH_DATA& mesh, float thickness = 0.1f, int level = 0);
+
+private:
+	// start a new mesh, or a new part of the mesh being built
+	static void BeginMesh(MESH_DATA& mesh);
+	static void BeginPart(MESH_DATA& mesh, MESH_PART part);
+	static void EndPart(MESH_DATA& mesh, MESH_PART part);
+	// add a flat polygon with one normal, as a triangle fan
+	static void AddPolygon(
+		MESH_DATA& mesh,
+		const glm::vec3* positions,
+		const glm::vec2* uvs,
+		int count);
+	// add the sides and caps of a cylinder with different radii
+	// at the bottom and at the top
+	static void BuildFrustum(MESH_DATA& mesh, float bottomRadius, float topRadius, int level);
+};
@@ -0,0 +1,317 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshoptimizer.cpp
+// ============
+// reorder the triangles and vertices of the basic meshes for the GPU
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// declarations for the global variables and defines
+namespace
+{
+	// number of vertices in the modelled least recently used cache
+	const int CACHE_SIZE = 32;
+	// scores of the vertices in the cache - the three vertices of
+	// the last triangle get a fixed score, so that the next
+	// triangle does not just turn around the same edge
+	const float CACHE_DECAY_POWER = 1.5f;
+	const float LAST_TRIANGLE_SCORE = 0.75f;
+	// scores for vertices with few triangles left, so that lone
+	// triangles are not left behind to miss the cache later
+	const float VALENCE_BOOST_SCALE = 2.0f;
+	const float VALENCE_BOOST_POWER = 0.5f;
+
+	// number of vertices in the first in first out cache that the
+	// cache misses are counted with
+	const size_t MEASURE_CACHE_SIZE = 16;
+	const size_t NOT_CACHED = (size_t)-1;
+	const uint32_t NOT_REMAPPED = (uint32_t)-1;
+}
+
+/***********************************************************
+ *  Optimize()
+ *
+ *  This method is used for reordering a built mesh.  The
+ *  triangles are reordered inside the index range of each
+ *  part, so that the parts can still be drawn on their own.
+ ***********************************************************/
+void MeshOptimizer::Optimize(MeshGeometry::MESH_DATA& mesh)
+{
+	for (int part = 0; part < MeshGeometry::MESH_PART_COUNT; part++)
+	{
+		if (mesh.partCount[part] == 0)
+		{
+			continue;
+		}
+
+		OptimizeVertexCache(
+			mesh.indices.data() + mesh.partFirst[part],
+			mesh.partCount[part],
+			mesh.vertices.size());
+	}
+
+	OptimizeVertexFetch(mesh);
+}
+
+/***********************************************************
+ *  OptimizeVertexCache()
+ *
+ *  This method is used for reordering a list of triangles.
+ *  Each step draws the best scoring triangle, moves its
+ *  vertices to the front of the modelled cache, and scores
+ *  the triangles around the vertices in the cache again.
+ *  The next triangle is the best of those, or the next
+ *  triangle not drawn yet when none of them is left.
+ ***********************************************************/
+void MeshOptimizer::OptimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount)
+{
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	// the triangles not drawn yet around every vertex, which are
+	// the first of the triangles listed for the vertex
+	std::vector<uint32_t> remaining(vertexCount, 0);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+	{
+		remaining[indices[i]]++;
+	}
+
+	std::vector<uint32_t> adjacencyFirst(vertexCount + 1, 0);
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		adjacencyFirst[i + 1] = adjacencyFirst[i] + remaining[i];
+	}
+
+	std::vector<uint32_t> adjacency(triangleCount * 3);
+	std::vector<uint32_t> adjacencyEnd(adjacencyFirst.begin(), adjacencyFirst.end() - 1);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+	{
+		adjacency[adjacencyEnd[indices[i]]++] = (uint32_t)(i / 3);
+	}
+
+	std::vector<int> cachePosition(vertexCount, -1);
+	std::vector<float> vertexScore(vertexCount);
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		vertexScore[i] = ScoreVertex(-1, remaining[i]);
+	}
+
+	std::vector<float> triangleScore(triangleCount);
+	std::vector<bool> bDrawn(triangleCount, false);
+	int bestTriangle = 0;
+	for (size_t i = 0; i < triangleCount; i++)
+	{
+		triangleScore[i] =
+			vertexScore[indices[i * 3]] +
+			vertexScore[indices[i * 3 + 1]] +
+			vertexScore[indices[i * 3 + 2]];
+
+		if (triangleScore[i] > triangleScore[bestTriangle])
+		{
+			bestTriangle = (int)i;
+		}
+	}
+
+	std::vector<uint32_t> output;
+	output.reserve(triangleCount * 3);
+
+	uint32_t cache[CACHE_SIZE + 3];
+	int cacheCount = 0;
+	size_t nextTriangle = 0;
+
+	while (output.size() < triangleCount * 3)
+	{
+		if (bestTriangle < 0)
+		{
+			while (bDrawn[nextTriangle] == true)
+			{
+				nextTriangle++;
+			}
+			bestTriangle = (int)nextTriangle;
+		}
+
+		const uint32_t* triangle = indices + (size_t)bestTriangle * 3;
+		output.insert(output.end(), triangle, triangle + 3);
+		bDrawn[bestTriangle] = true;
+
+		// the drawn triangle leaves the lists of its vertices
+		for (int k = 0; k < 3; k++)
+		{
+			uint32_t vertex = triangle[k];
+			uint32_t* first = adjacency.data() + adjacencyFirst[vertex];
+			uint32_t* last = first + remaining[vertex] - 1;
+			uint32_t* found = std::find(first, last, (uint32_t)bestTriangle);
+
+			std::swap(*found, *last);
+			remaining[vertex]--;
+		}
+
+		// the vertices of the triangle move to the front of the
+		// cache, and the vertices pushed past its end drop out
+		uint32_t newCache[CACHE_SIZE + 3];
+		int newCount = 0;
+		for (int k = 0; k < 3; k++)
+		{
+			if (std::find(newCache, newCache + newCount, triangle[k]) == newCache + newCount)
+			{
+				newCache[newCount++] = triangle[k];
+			}
+		}
+		int triangleVertices = newCount;
+		for (int i = 0; i < cacheCount; i++)
+		{
+			if (std::find(newCache, newCache + triangleVertices, cache[i]) == newCache + triangleVertices)
+			{
+				newCache[newCount++] = cache[i];
+			}
+		}
+
+		for (int i = 0; i < newCount; i++)
+		{
+			cachePosition[newCache[i]] = (i < CACHE_SIZE) ? i : -1;
+		}
+
+		// score the touched vertices again, and pass the change on
+		// to their triangles
+		bestTriangle = -1;
+		float bestScore = -1.0f;
+		for (int i = 0; i < newCount; i++)
+		{
+			uint32_t vertex = newCache[i];
+			float score = ScoreVertex(cachePosition[vertex], remaining[vertex]);
+			float change = score - vertexScore[vertex];
+			vertexScore[vertex] = score;
+
+			for (uint32_t j = 0; j < remaining[vertex]; j++)
+			{
+				uint32_t around = adjacency[adjacencyFirst[vertex] + j];
+				triangleScore[around] += change;
+			}
+		}
+
+		// the triangles around the cached vertices have their new
+		// scores only once every vertex has been scored again
+		cacheCount = std::min(newCount, CACHE_SIZE);
+		for (int i = 0; i < cacheCount; i++)
+		{
+			uint32_t vertex = newCache[i];
+			cache[i] = vertex;
+
+			for (uint32_t j = 0; j < remaining[vertex]; j++)
+			{
+				uint32_t around = adjacency[adjacencyFirst[vertex] + j];
+				if (triangleScore[around] > bestScore)
+				{
+					bestScore = triangleScore[around];
+					bestTriangle = (int)around;
+				}
+			}
+		}
+	}
+
+	std::copy(output.begin(), output.end(), indices);
+}
+
+/***********************************************************
+ *  OptimizeVertexFetch()
+ *
+ *  This method is used for storing the vertices in the
+ *  order that the indices first use them, and moving the
+ *  indices to the new places of their vertices.  Vertices
+ *  that no index uses are kept at the end.
+ ***********************************************************/
+void MeshOptimizer::OptimizeVertexFetch(MeshGeometry::MESH_DATA& mesh)
+{
+	std::vector<uint32_t> remap(mesh.vertices.size(), NOT_REMAPPED);
+	std::vector<MeshGeometry::VERTEX> vertices;
+	vertices.reserve(mesh.vertices.size());
+
+	for (size_t i = 0; i < mesh.indices.size(); i++)
+	{
+		uint32_t& index = mesh.indices[i];
+		if (remap[index] == NOT_REMAPPED)
+		{
+			remap[index] = (uint32_t)vertices.size();
+			vertices.push_back(mesh.vertices[index]);
+		}
+		index = remap[index];
+	}
+
+	for (size_t i = 0; i < mesh.vertices.size(); i++)
+	{
+		if (remap[i] == NOT_REMAPPED)
+		{
+			vertices.push_back(mesh.vertices[i]);
+		}
+	}
+
+	mesh.vertices.swap(vertices);
+}
+
+/***********************************************************
+ *  CountCacheMisses()
+ *
+ *  This method is used for counting the vertices that would
+ *  run the vertex shader while drawing the whole mesh.  A
+ *  vertex is still in the cache while fewer than the size
+ *  of the cache other vertices have missed after it.
+ ***********************************************************/
+size_t MeshOptimizer::CountCacheMisses(const MeshGeometry::MESH_DATA& mesh)
+{
+	std::vector<size_t> missedAt(mesh.vertices.size(), NOT_CACHED);
+	size_t misses = 0;
+
+	for (size_t i = 0; i < mesh.indices.size(); i++)
+	{
+		uint32_t index = mesh.indices[i];
+		if ((missedAt[index] == NOT_CACHED) || (misses - missedAt[index] >= MEASURE_CACHE_SIZE))
+		{
+			missedAt[index] = misses;
+			misses++;
+		}
+	}
+
+	return(misses);
+}
+
+/***********************************************************
+ *  ScoreVertex()
+ *
+ *  This method is used for scoring a vertex.  Vertices near
+ *  the front of the cache score highest, and vertices with
+ *  few triangles left get a boost.  Vertices without any
+ *  triangles left never have to be drawn again.
+ ***********************************************************/
+float MeshOptimizer::ScoreVertex(int cachePosition, uint32_t remainingTriangles)
+{
+	if (remainingTriangles == 0)
+	{
+		return(-1.0f);
+	}
+
+	float score = 0.0f;
+	if (cachePosition >= 0)
+	{
+		if (cachePosition < 3)
+		{
+			score = LAST_TRIANGLE_SCORE;
+		}
+		else
+		{
+			float fraction = 1.0f - (float)(cachePosition - 3) / (float)(CACHE_SIZE - 3);
+			score = std::pow(fraction, CACHE_DECAY_POWER);
+		}
+	}
+
+	score += VALENCE_BOOST_SCALE * std::pow((float)remainingTriangles, -VALENCE_BOOST_POWER);
+
+	return(score);
+}
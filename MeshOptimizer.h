@@ -0,0 +1,49 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshoptimizer.h
+// ============
+// reorder the triangles and vertices of the basic meshes for the GPU
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "MeshGeometry.h"
+
+#include <cstddef>
+#include <cstdint>
+
+/***********************************************************
+ *  MeshOptimizer
+ *
+ *  This class reorders the built meshes so that they draw
+ *  with fewer vertex shader runs.  The triangles of every
+ *  part are reordered with Tom Forsyth's linear speed vertex
+ *  cache optimization, which greedily takes the triangle
+ *  whose vertices score best from their place in a modelled
+ *  cache and from how few triangles still use them.  The
+ *  vertices are then stored in the order that the triangles
+ *  first use them, so that the vertex fetches move forward
+ *  through memory.  Only the order changes, so the meshes
+ *  look exactly the same.
+ ***********************************************************/
+class MeshOptimizer
+{
+public:
+	// reorder the triangles of every part of a mesh, and then its
+	// vertices
+	static void Optimize(MeshGeometry::MESH_DATA& mesh);
+	// reorder a list of triangles for the vertex cache
+	static void OptimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount);
+	// store the vertices of a mesh in the order of their first use
+	static void OptimizeVertexFetch(MeshGeometry::MESH_DATA& mesh);
+
+	// count the vertices that miss a first in first out cache
+	// while drawing a mesh - the average cache miss ratio (ACMR)
+	// is the count over the number of triangles
+	static size_t CountCacheMisses(const MeshGeometry::MESH_DATA& mesh);
+
+private:
+	// score a vertex from its place in the cache and the number of
+	// triangles that still use it
+	static float ScoreVertex(int cachePosition, uint32_t remainingTriangles);
+};
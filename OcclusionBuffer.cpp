@@ -0,0 +1,507 @@
+///////////////////////////////////////////////////////////////////////////////
+// occlusionbuffer.cpp
+// ============
+// rasterize large occluders on the CPU and test boxes against them
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "OcclusionBuffer.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 1))
+#define OCCLUSION_BUFFER_SSE
+#include <xmmintrin.h>
+#endif
+
+// declarations for the global variables and defines
+namespace
+{
+	// fewer triangles than this are rasterized on the calling
+	// thread, where waking the workers would cost more than
+	// the rasterizing
+	const size_t MIN_PARALLEL_TRIANGLES = 256;
+}
+
+/***********************************************************
+ *  OcclusionBuffer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+OcclusionBuffer::OcclusionBuffer(int threadCount)
+{
+	m_threadCount = (threadCount > 0) ? (size_t)threadCount : std::thread::hardware_concurrency();
+	m_viewProjection = glm::mat4(1.0f);
+	m_depth.assign(WIDTH * HEIGHT, 1.0f);
+	m_blockDepth.assign(BLOCKS_X * BLOCKS_Y, 1.0f);
+	m_nextTile = 0;
+	m_workFrame = 0;
+	m_busyWorkers = 0;
+	m_bStopping = false;
+}
+
+/***********************************************************
+ *  ~OcclusionBuffer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+OcclusionBuffer::~OcclusionBuffer()
+{
+	StopWorkers();
+}
+
+/***********************************************************
+ *  Begin()
+ *
+ *  This method is used for clearing the depth buffer to the
+ *  far plane and removing the occluders of the last frame.
+ ***********************************************************/
+void OcclusionBuffer::Begin(const glm::mat4& viewProjection)
+{
+	m_viewProjection = viewProjection;
+	std::fill(m_depth.begin(), m_depth.end(), 1.0f);
+	std::fill(m_blockDepth.begin(), m_blockDepth.end(), 1.0f);
+	m_triangles.clear();
+	for (int i = 0; i < TILE_COUNT; i++)
+	{
+		m_tileTriangles[i].clear();
+	}
+}
+
+/***********************************************************
+ *  AddOccluder()
+ *
+ *  This method is used for adding every triangle of a mesh
+ *  as an occluder.  Both sides of the triangles are drawn,
+ *  since only the nearest depth is kept.
+ ***********************************************************/
+void OcclusionBuffer::AddOccluder(const MeshGeometry::MESH_DATA& mesh, const glm::mat4& model)
+{
+	glm::mat4 modelViewProjection = m_viewProjection * model;
+
+	for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+	{
+		glm::vec4 clip[3];
+
+		for (int j = 0; j < 3; j++)
+		{
+			clip[j] = modelViewProjection * glm::vec4(mesh.vertices[mesh.indices[i + j]].position, 1.0f);
+		}
+		AddClipTriangle(clip);
+	}
+}
+
+/***********************************************************
+ *  AddClipTriangle()
+ *
+ *  This method is used for clipping a triangle in clip space
+ *  at the near plane, where z + w is 0, and adding what is
+ *  left as one or two triangles in pixels.
+ ***********************************************************/
+void OcclusionBuffer::AddClipTriangle(const glm::vec4* clip)
+{
+	glm::vec4 polygon[4];
+	int count = 0;
+
+	for (int i = 0; i < 3; i++)
+	{
+		const glm::vec4& current = clip[i];
+		const glm::vec4& next = clip[(i + 1) % 3];
+		float currentDistance = current.z + current.w;
+		float nextDistance = next.z + next.w;
+
+		if (currentDistance >= 0.0f)
+		{
+			polygon[count++] = current;
+		}
+		if ((currentDistance >= 0.0f) != (nextDistance >= 0.0f))
+		{
+			float t = currentDistance / (currentDistance - nextDistance);
+			polygon[count++] = current + (next - current) * t;
+		}
+	}
+
+	if (count < 3)
+	{
+		return;
+	}
+
+	glm::vec3 screen[4];
+	for (int i = 0; i < count; i++)
+	{
+		float inverseW = 1.0f / polygon[i].w;
+		screen[i] = glm::vec3(
+			(polygon[i].x * inverseW * 0.5f + 0.5f) * WIDTH,
+			(polygon[i].y * inverseW * 0.5f + 0.5f) * HEIGHT,
+			polygon[i].z * inverseW * 0.5f + 0.5f);
+	}
+
+	AddScreenTriangle(screen);
+	if (count == 4)
+	{
+		const glm::vec3 second[3] = { screen[0], screen[2], screen[3] };
+		AddScreenTriangle(second);
+	}
+}
+
+/***********************************************************
+ *  AddScreenTriangle()
+ *
+ *  This method is used for keeping a triangle in pixels and
+ *  adding it to the list of every tile that its bounding
+ *  rectangle touches.  Triangles without any area or off
+ *  the screen are dropped.
+ ***********************************************************/
+void OcclusionBuffer::AddScreenTriangle(const glm::vec3* screen)
+{
+	float area =
+		(screen[1].x - screen[0].x) * (screen[2].y - screen[0].y) -
+		(screen[1].y - screen[0].y) * (screen[2].x - screen[0].x);
+	if (area == 0.0f)
+	{
+		return;
+	}
+
+	float minX = std::min(screen[0].x, std::min(screen[1].x, screen[2].x));
+	float maxX = std::max(screen[0].x, std::max(screen[1].x, screen[2].x));
+	float minY = std::min(screen[0].y, std::min(screen[1].y, screen[2].y));
+	float maxY = std::max(screen[0].y, std::max(screen[1].y, screen[2].y));
+	if ((maxX < 0.0f) || (maxY < 0.0f) || (minX >= WIDTH) || (minY >= HEIGHT))
+	{
+		return;
+	}
+
+	// the triangles are kept counter clockwise, so the inside of
+	// every edge is on its left
+	SCREEN_TRIANGLE triangle;
+	triangle.vertices[0] = screen[0];
+	triangle.vertices[1] = (area > 0.0f) ? screen[1] : screen[2];
+	triangle.vertices[2] = (area > 0.0f) ? screen[2] : screen[1];
+
+	uint32_t index = (uint32_t)m_triangles.size();
+	m_triangles.push_back(triangle);
+
+	int tileX0 = std::max((int)minX, 0) / TILE_WIDTH;
+	int tileX1 = std::min((int)maxX, WIDTH - 1) / TILE_WIDTH;
+	int tileY0 = std::max((int)minY, 0) / TILE_HEIGHT;
+	int tileY1 = std::min((int)maxY, HEIGHT - 1) / TILE_HEIGHT;
+	for (int tileY = tileY0; tileY <= tileY1; tileY++)
+	{
+		for (int tileX = tileX0; tileX <= tileX1; tileX++)
+		{
+			m_tileTriangles[tileY * TILES_X + tileX].push_back(index);
+		}
+	}
+}
+
+/***********************************************************
+ *  Rasterize()
+ *
+ *  This method is used for rasterizing the triangles of
+ *  every tile.  The tiles do not share any pixels, so the
+ *  workers rasterize them without any locking, picking up
+ *  the next tile until every tile is done.  The calling
+ *  thread rasterizes tiles too, and then waits until every
+ *  worker has finished its last tile.
+ ***********************************************************/
+void OcclusionBuffer::Rasterize()
+{
+	m_nextTile = 0;
+
+	size_t workerCount = m_threadCount;
+	if ((m_triangles.size() < MIN_PARALLEL_TRIANGLES) || (workerCount <= 1))
+	{
+		RasterizeTiles();
+		return;
+	}
+
+	// the workers are started once, and the calling thread is
+	// one of the threads working through the tiles
+	if (m_workers.size() == 0)
+	{
+		workerCount = std::min(workerCount, (size_t)TILE_COUNT);
+		for (size_t i = 1; i < workerCount; i++)
+		{
+			m_workers.push_back(std::thread(&OcclusionBuffer::WorkerLoop, this));
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_workMutex);
+		m_busyWorkers = m_workers.size();
+		m_workFrame++;
+	}
+	m_workSignal.notify_all();
+
+	RasterizeTiles();
+
+	std::unique_lock<std::mutex> lock(m_workMutex);
+	m_doneSignal.wait(lock, [this] { return(m_busyWorkers == 0); });
+}
+
+/***********************************************************
+ *  WorkerLoop()
+ *
+ *  This method is run by each worker thread.  It sleeps
+ *  until a new frame is rasterized, takes tiles until none
+ *  are left, and tells the calling thread when it is done.
+ ***********************************************************/
+void OcclusionBuffer::WorkerLoop()
+{
+	uint64_t frame = 0;
+
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_workMutex);
+			m_workSignal.wait(lock, [this, frame] { return((m_bStopping == true) || (m_workFrame != frame)); });
+			if (m_bStopping == true)
+			{
+				return;
+			}
+			frame = m_workFrame;
+		}
+
+		RasterizeTiles();
+
+		std::lock_guard<std::mutex> lock(m_workMutex);
+		m_busyWorkers--;
+		if (m_busyWorkers == 0)
+		{
+			m_doneSignal.notify_one();
+		}
+	}
+}
+
+/***********************************************************
+ *  StopWorkers()
+ *
+ *  This method is used for waking the worker threads to
+ *  exit, and waiting for them.
+ ***********************************************************/
+void OcclusionBuffer::StopWorkers()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_workMutex);
+		m_bStopping = true;
+	}
+	m_workSignal.notify_all();
+
+	for (size_t i = 0; i < m_workers.size(); i++)
+	{
+		m_workers[i].join();
+	}
+	m_workers.clear();
+}
+
+/***********************************************************
+ *  RasterizeTiles()
+ *
+ *  This method is used for rasterizing tiles until there
+ *  are none left.
+ ***********************************************************/
+void OcclusionBuffer::RasterizeTiles()
+{
+	int tile = m_nextTile++;
+
+	while (tile < TILE_COUNT)
+	{
+		if (m_tileTriangles[tile].size() > 0)
+		{
+			RasterizeTile(tile);
+		}
+		tile = m_nextTile++;
+	}
+}
+
+/***********************************************************
+ *  RasterizeTile()
+ *
+ *  This method is used for rasterizing the triangles of a
+ *  tile, keeping the nearest depth at every pixel center
+ *  inside a triangle.  Edge functions and depth are planes
+ *  over the screen, so each row of four pixels is found
+ *  from the row start with a few multiplies and adds.  The
+ *  furthest depth of each block of the tile is kept after
+ *  all of the triangles are drawn.
+ ***********************************************************/
+void OcclusionBuffer::RasterizeTile(int tile)
+{
+	int tileX = (tile % TILES_X) * TILE_WIDTH;
+	int tileY = (tile / TILES_X) * TILE_HEIGHT;
+
+	for (size_t i = 0; i < m_tileTriangles[tile].size(); i++)
+	{
+		const glm::vec3* v = m_triangles[m_tileTriangles[tile][i]].vertices;
+
+		// edge i is opposite vertex i, as A * x + B * y + C
+		float edgeA[3];
+		float edgeB[3];
+		float edgeC[3];
+		for (int j = 0; j < 3; j++)
+		{
+			const glm::vec3& a = v[(j + 1) % 3];
+			const glm::vec3& b = v[(j + 2) % 3];
+			edgeA[j] = a.y - b.y;
+			edgeB[j] = b.x - a.x;
+			edgeC[j] = -(edgeA[j] * a.x + edgeB[j] * a.y);
+		}
+
+		// the edge function of each edge at the opposite vertex is
+		// the doubled area, which makes the depth plane
+		float area = edgeA[0] * v[0].x + edgeB[0] * v[0].y + edgeC[0];
+		float depthA = (edgeA[0] * v[0].z + edgeA[1] * v[1].z + edgeA[2] * v[2].z) / area;
+		float depthB = (edgeB[0] * v[0].z + edgeB[1] * v[1].z + edgeB[2] * v[2].z) / area;
+		float depthC = (edgeC[0] * v[0].z + edgeC[1] * v[1].z + edgeC[2] * v[2].z) / area;
+
+		int x0 = std::max((int)floorf(std::min(v[0].x, std::min(v[1].x, v[2].x))), tileX) & ~3;
+		int x1 = std::min((int)ceilf(std::max(v[0].x, std::max(v[1].x, v[2].x))), tileX + TILE_WIDTH - 1);
+		int y0 = std::max((int)floorf(std::min(v[0].y, std::min(v[1].y, v[2].y))), tileY);
+		int y1 = std::min((int)ceilf(std::max(v[0].y, std::max(v[1].y, v[2].y))), tileY + TILE_HEIGHT - 1);
+
+		for (int y = y0; y <= y1; y++)
+		{
+			float centerY = (float)y + 0.5f;
+			float* row = &m_depth[(size_t)y * WIDTH];
+
+#ifdef OCCLUSION_BUFFER_SSE
+			const __m128 zero = _mm_setzero_ps();
+			const __m128 step = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+			__m128 rowEdge[3];
+			__m128 columnEdge[3];
+			for (int j = 0; j < 3; j++)
+			{
+				rowEdge[j] = _mm_set1_ps(edgeB[j] * centerY + edgeC[j]);
+				columnEdge[j] = _mm_set1_ps(edgeA[j]);
+			}
+			const __m128 rowDepth = _mm_set1_ps(depthB * centerY + depthC);
+			const __m128 columnDepth = _mm_set1_ps(depthA);
+
+			for (int x = x0; x <= x1; x += 4)
+			{
+				__m128 centerX = _mm_add_ps(_mm_set1_ps((float)x), step);
+				__m128 inside = _mm_and_ps(
+					_mm_and_ps(
+						_mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(columnEdge[0], centerX), rowEdge[0]), zero),
+						_mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(columnEdge[1], centerX), rowEdge[1]), zero)),
+					_mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(columnEdge[2], centerX), rowEdge[2]), zero));
+
+				if (_mm_movemask_ps(inside) == 0)
+				{
+					continue;
+				}
+
+				__m128 current = _mm_loadu_ps(row + x);
+				__m128 nearest = _mm_min_ps(current, _mm_add_ps(_mm_mul_ps(columnDepth, centerX), rowDepth));
+				_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, current)));
+			}
+#else
+			for (int x = x0; x <= x1; x++)
+			{
+				float centerX = (float)x + 0.5f;
+
+				if ((edgeA[0] * centerX + edgeB[0] * centerY + edgeC[0] >= 0.0f) &&
+					(edgeA[1] * centerX + edgeB[1] * centerY + edgeC[1] >= 0.0f) &&
+					(edgeA[2] * centerX + edgeB[2] * centerY + edgeC[2] >= 0.0f))
+				{
+					row[x] = std::min(row[x], depthA * centerX + depthB * centerY + depthC);
+				}
+			}
+#endif
+		}
+	}
+
+	for (int blockY = tileY / BLOCK_SIZE; blockY < (tileY + TILE_HEIGHT) / BLOCK_SIZE; blockY++)
+	{
+		for (int blockX = tileX / BLOCK_SIZE; blockX < (tileX + TILE_WIDTH) / BLOCK_SIZE; blockX++)
+		{
+			float furthest = 0.0f;
+
+			for (int y = blockY * BLOCK_SIZE; y < (blockY + 1) * BLOCK_SIZE; y++)
+			{
+				const float* row = &m_depth[(size_t)y * WIDTH + blockX * BLOCK_SIZE];
+				for (int x = 0; x < BLOCK_SIZE; x++)
+				{
+					furthest = std::max(furthest, row[x]);
+				}
+			}
+			m_blockDepth[blockY * BLOCKS_X + blockX] = furthest;
+		}
+	}
+}
+
+/***********************************************************
+ *  IsVisible()
+ *
+ *  This method is used for testing a box against the
+ *  rasterized occluders.  The box is taken as its screen
+ *  rectangle at the depth of its nearest corner, which can
+ *  only be seen where a block reaches further than that.
+ *  Boxes crossing the near plane are always visible.
+ ***********************************************************/
+bool OcclusionBuffer::IsVisible(const BoundingVolumeTree::BOUNDS& bounds) const
+{
+	float minX = (float)WIDTH;
+	float maxX = 0.0f;
+	float minY = (float)HEIGHT;
+	float maxY = 0.0f;
+	float nearest = 1.0f;
+
+	for (int i = 0; i < 8; i++)
+	{
+		glm::vec3 corner = bounds.center + glm::vec3(
+			(i & 1) ? bounds.extent.x : -bounds.extent.x,
+			(i & 2) ? bounds.extent.y : -bounds.extent.y,
+			(i & 4) ? bounds.extent.z : -bounds.extent.z);
+		glm::vec4 clip = m_viewProjection * glm::vec4(corner, 1.0f);
+
+		if (clip.z + clip.w <= 0.0f)
+		{
+			return(true);
+		}
+
+		float inverseW = 1.0f / clip.w;
+		float screenX = (clip.x * inverseW * 0.5f + 0.5f) * WIDTH;
+		float screenY = (clip.y * inverseW * 0.5f + 0.5f) * HEIGHT;
+		minX = std::min(minX, screenX);
+		maxX = std::max(maxX, screenX);
+		minY = std::min(minY, screenY);
+		maxY = std::max(maxY, screenY);
+		nearest = std::min(nearest, clip.z * inverseW * 0.5f + 0.5f);
+	}
+
+	if ((maxX < 0.0f) || (maxY < 0.0f) || (minX >= WIDTH) || (minY >= HEIGHT))
+	{
+		return(true);
+	}
+
+	int blockX0 = std::max((int)minX, 0) / BLOCK_SIZE;
+	int blockX1 = std::min((int)maxX, WIDTH - 1) / BLOCK_SIZE;
+	int blockY0 = std::max((int)minY, 0) / BLOCK_SIZE;
+	int blockY1 = std::min((int)maxY, HEIGHT - 1) / BLOCK_SIZE;
+
+	for (int blockY = blockY0; blockY <= blockY1; blockY++)
+	{
+		for (int blockX = blockX0; blockX <= blockX1; blockX++)
+		{
+			if (nearest <= m_blockDepth[blockY * BLOCKS_X + blockX])
+			{
+				return(true);
+			}
+		}
+	}
+
+	return(false);
+}
+
+/***********************************************************
+ *  GetTriangleCount()
+ *
+ *  This method is used for getting the number of occluder
+ *  triangles added in this frame.
+ ***********************************************************/
+int OcclusionBuffer::GetTriangleCount() const
+{
+	return((int)m_triangles.size());
+}
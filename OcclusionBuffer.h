@@ -0,0 +1,120 @@
+///////////////////////////////////////////////////////////////////////////////
+// occlusionbuffer.h
+// ============
+// rasterize large occluders on the CPU and test boxes against them
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "BoundingVolumeTree.h"
+#include "MeshGeometry.h"
+
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/***********************************************************
+ *  OcclusionBuffer
+ *
+ *  This class draws the triangles of a few large occluders
+ *  into a small depth buffer on the CPU, and then tells
+ *  whether a box could still be seen behind them.  The
+ *  occluder triangles are clipped at the near plane, moved
+ *  to the screen, and sorted into the tiles that they touch.
+ *  The tiles are rasterized on worker threads, four pixels
+ *  at a time with SSE, and each tile keeps the furthest
+ *  depth of every 8x8 block of pixels.  A box is hidden
+ *  when its nearest corner lies behind the furthest depth
+ *  of every block that its screen rectangle touches.  The
+ *  worker threads are started by the first frame with enough
+ *  triangles, and then wait to be woken by the next frames.
+ *  There is one thread per hardware thread, counting the
+ *  calling thread, unless a thread count is passed in.
+ ***********************************************************/
+class OcclusionBuffer
+{
+public:
+	// size of the depth buffer in pixels
+	static const int WIDTH = 256;
+	static const int HEIGHT = 128;
+
+	// constructor - a thread count of 0 uses every hardware thread
+	explicit OcclusionBuffer(int threadCount = 0);
+	// destructor
+	~OcclusionBuffer();
+
+	// clear the depth buffer and the occluders for a new frame
+	void Begin(const glm::mat4& viewProjection);
+	// add the triangles of a mesh, moved by a model matrix, as
+	// an occluder
+	void AddOccluder(const MeshGeometry::MESH_DATA& mesh, const glm::mat4& model);
+	// rasterize the added occluders into the depth buffer
+	void Rasterize();
+	// test whether any part of a box could be seen past the
+	// rasterized occluders
+	bool IsVisible(const BoundingVolumeTree::BOUNDS& bounds) const;
+
+	int GetTriangleCount() const;
+
+private:
+	// size of the tiles that the triangles are sorted into
+	static const int TILE_WIDTH = 64;
+	static const int TILE_HEIGHT = 32;
+	static const int TILES_X = WIDTH / TILE_WIDTH;
+	static const int TILES_Y = HEIGHT / TILE_HEIGHT;
+	static const int TILE_COUNT = TILES_X * TILES_Y;
+	// size of the blocks holding their furthest depth
+	static const int BLOCK_SIZE = 8;
+	static const int BLOCKS_X = WIDTH / BLOCK_SIZE;
+	static const int BLOCKS_Y = HEIGHT / BLOCK_SIZE;
+
+	// a triangle in pixels, with depth from 0 at the near plane
+	// to 1 at the far plane
+	struct SCREEN_TRIANGLE
+	{
+		glm::vec3 vertices[3];
+	};
+
+	// add a triangle in clip space, clipped at the near plane
+	void AddClipTriangle(const glm::vec4* clip);
+	// add a triangle in pixels to the tiles that it touches
+	void AddScreenTriangle(const glm::vec3* screen);
+	// rasterize the triangles of a tile and find the furthest
+	// depth of its blocks
+	void RasterizeTile(int tile);
+	// rasterize tiles until every tile of the frame is taken
+	void RasterizeTiles();
+	// the loop run by each of the worker threads, which
+	// rasterizes tiles every time that a frame wakes it
+	void WorkerLoop();
+	// wake the worker threads to exit, and wait for them
+	void StopWorkers();
+
+	glm::mat4 m_viewProjection;
+	std::vector<float> m_depth;
+	// furthest depth of each block of pixels
+	std::vector<float> m_blockDepth;
+	std::vector<SCREEN_TRIANGLE> m_triangles;
+	// the triangles touching each tile
+	std::vector<uint32_t> m_tileTriangles[TILE_COUNT];
+	// index of the next tile to be picked up by a worker
+	std::atomic<int> m_nextTile;
+	// number of threads that rasterize the tiles, counting the
+	// calling thread
+	size_t m_threadCount;
+	// worker threads, the number of the frame that they were last
+	// woken for, and the number still rasterizing that frame
+	std::vector<std::thread> m_workers;
+	uint64_t m_workFrame;
+	size_t m_busyWorkers;
+	bool m_bStopping;
+	std::mutex m_workMutex;
+	std::condition_variable m_workSignal;
+	std::condition_variable m_doneSignal;
+};
@@ -0,0 +1,582 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenefile.cpp
+// ============
+// read and write the scene description files
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SceneFile.h"
+#include "SceneTags.h"
+#include "TextureCache.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+// declarations for the global variables and defines
+namespace
+{
+	const char* g_BinaryExtension = ".sceneb";
+
+	const uint32_t SCENE_MAGIC = 0x314E4353; // "SCN1"
+	const uint32_t SCENE_VERSION = 1;
+
+	// the binary file starts with the header, followed by the
+	// texture and material entries with their strings, then the
+	// object and part records as they are held in memory
+	struct SCENE_HEADER
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t textureCount;
+		uint32_t materialCount;
+		uint32_t objectCount;
+		uint32_t partCount;
+		// size and modification time of the text file
+		uint64_t sourceSize;
+		int64_t sourceTime;
+	};
+
+	/***********************************************************
+	 *  ParseError()
+	 *
+	 *  Report a line of a scene text file that could not be
+	 *  parsed.
+	 ***********************************************************/
+	bool ParseError(const std::string& filename, int lineNumber, const std::string& message)
+	{
+		std::cout << filename << "(" << lineNumber << "): " << message << std::endl;
+		return(false);
+	}
+
+	/***********************************************************
+	 *  ParseFloats()
+	 *
+	 *  Parse a number of float values from the tokens of a
+	 *  line, starting at the passed in token.
+	 ***********************************************************/
+	bool ParseFloats(const std::vector<std::string>& tokens, size_t& index, float* values, int count)
+	{
+		for (int i = 0; i < count; i++, index++)
+		{
+			if (index >= tokens.size())
+			{
+				return(false);
+			}
+
+			char* end = NULL;
+			values[i] = strtof(tokens[index].c_str(), &end);
+			if (*end != 0)
+			{
+				return(false);
+			}
+		}
+
+		return(true);
+	}
+
+	/***********************************************************
+	 *  WriteString()
+	 *
+	 *  Write a string with its length into a binary file.
+	 ***********************************************************/
+	bool WriteString(FILE* file, const std::string& value)
+	{
+		uint32_t length = (uint32_t)value.size();
+
+		return((fwrite(&length, sizeof(uint32_t), 1, file) == 1) &&
+			(fwrite(value.data(), 1, length, file) == length));
+	}
+
+	/***********************************************************
+	 *  ReadString()
+	 *
+	 *  Read a string with its length from a binary file.
+	 ***********************************************************/
+	bool ReadString(FILE* file, std::string& value)
+	{
+		uint32_t length = 0;
+
+		if ((fread(&length, sizeof(uint32_t), 1, file) != 1) || (length > 4096))
+		{
+			return(false);
+		}
+		value.resize(length);
+
+		return((length == 0) || (fread(&value[0], 1, length, file) == length));
+	}
+}
+
+/***********************************************************
+ *  Load()
+ *
+ *  This method is used for loading a scene.  The compiled
+ *  binary file is used when it is present and was compiled
+ *  from the current version of the text file.
+ ***********************************************************/
+bool SceneFile::Load(const std::string& filename)
+{
+	if (LoadBinary(filename) == true)
+	{
+		return(true);
+	}
+
+	return(LoadText(filename));
+}
+
+/***********************************************************
+ *  LoadText()
+ *
+ *  This method is used for parsing a scene text file.
+ ***********************************************************/
+bool SceneFile::LoadText(const std::string& filename)
+{
+	std::ifstream file(filename);
+	std::string text;
+	int lineNumber = 0;
+	int currentObject = -1;
+
+	Clear();
+
+	if (file.is_open() == false)
+	{
+		std::cout << "Could not open scene file:" << filename << std::endl;
+		return(false);
+	}
+
+	while (std::getline(file, text))
+	{
+		lineNumber++;
+
+		// everything after a # is a comment
+		size_t comment = text.find('#');
+		if (comment != std::string::npos)
+		{
+			text.erase(comment);
+		}
+
+		std::vector<std::string> tokens;
+		std::istringstream line(text);
+		std::string token;
+		while (line >> token)
+		{
+			tokens.push_back(token);
+		}
+		if (tokens.size() == 0)
+		{
+			continue;
+		}
+
+		const std::string& keyword = tokens[0];
+		size_t index = 2;
+
+		if (keyword == "texture")
+		{
+			if (tokens.size() != 3)
+			{
+				return(ParseError(filename, lineNumber, "expected texture <tag> <image file>"));
+			}
+
+			SCENE_TEXTURE texture;
+			texture.tag = tokens[1];
+			texture.filename = tokens[2];
+			m_textures.push_back(texture);
+		}
+		else if (keyword == "material")
+		{
+			if (tokens.size() < 2)
+			{
+				return(ParseError(filename, lineNumber, "expected material <tag>"));
+			}
+
+			SCENE_MATERIAL material;
+			material.tag = tokens[1];
+			material.ambientColor = glm::vec3(0.0f);
+			material.ambientStrength = 0.0f;
+			material.diffuseColor = glm::vec3(0.0f);
+			material.specularColor = glm::vec3(0.0f);
+			material.shininess = 1.0f;
+
+			while (index < tokens.size())
+			{
+				const std::string& key = tokens[index++];
+				bool bParsed = false;
+
+				if (key == "ambient")
+				{
+					bParsed = ParseFloats(tokens, index, &material.ambientColor.x, 3) &&
+						ParseFloats(tokens, index, &material.ambientStrength, 1);
+				}
+				else if (key == "diffuse")
+				{
+					bParsed = ParseFloats(tokens, index, &material.diffuseColor.x, 3);
+				}
+				else if (key == "specular")
+				{
+					bParsed = ParseFloats(tokens, index, &material.specularColor.x, 3);
+				}
+				else if (key == "shininess")
+				{
+					bParsed = ParseFloats(tokens, index, &material.shininess, 1);
+				}
+
+				if (bParsed == false)
+				{
+					return(ParseError(filename, lineNumber, "bad material value:" + key));
+				}
+			}
+			m_materials.push_back(material);
+		}
+		else if (keyword == "object")
+		{
+			if (currentObject >= 0)
+			{
+				return(ParseError(filename, lineNumber, "object without end before it"));
+			}
+			if (tokens.size() < 2)
+			{
+				return(ParseError(filename, lineNumber, "expected object <name>"));
+			}
+
+			SCENE_OBJECT object;
+			object.nameTag = HashTag(tokens[1]);
+			object.position = glm::vec3(0.0f);
+			object.firstPart = (uint32_t)m_parts.size();
+			object.partCount = 0;
+
+			while (index < tokens.size())
+			{
+				const std::string& key = tokens[index++];
+				if ((key != "position") || (ParseFloats(tokens, index, &object.position.x, 3) == false))
+				{
+					return(ParseError(filename, lineNumber, "bad object value:" + key));
+				}
+			}
+
+			currentObject = (int)m_objects.size();
+			m_objects.push_back(object);
+		}
+		else if (keyword == "part")
+		{
+			if (currentObject < 0)
+			{
+				return(ParseError(filename, lineNumber, "part outside of an object"));
+			}
+			if (tokens.size() < 2)
+			{
+				return(ParseError(filename, lineNumber, "expected part <mesh>"));
+			}
+
+			SCENE_PART part;
+			part.meshTag = HashTag(tokens[1]);
+			part.textureTag = 0;
+			part.materialTag = 0;
+			part.faces = PART_FACE_ALL;
+			part.scale = glm::vec3(1.0f);
+			part.rotation = glm::vec3(0.0f);
+			part.position = glm::vec3(0.0f);
+			part.color = glm::vec4(1.0f);
+			part.uvScale = glm::vec2(1.0f);
+
+			while (index < tokens.size())
+			{
+				const std::string& key = tokens[index++];
+				bool bParsed = false;
+
+				if (key == "faces")
+				{
+					part.faces = 0;
+					while (index < tokens.size())
+					{
+						if (tokens[index] == "top")
+							part.faces |= PART_FACE_TOP;
+						else if (tokens[index] == "bottom")
+							part.faces |= PART_FACE_BOTTOM;
+						else if (tokens[index] == "sides")
+							part.faces |= PART_FACE_SIDES;
+						else
+							break;
+						index++;
+					}
+					bParsed = (part.faces != 0);
+				}
+				else if (key == "scale")
+				{
+					bParsed = ParseFloats(tokens, index, &part.scale.x, 3);
+				}
+				else if (key == "rotation")
+				{
+					bParsed = ParseFloats(tokens, index, &part.rotation.x, 3);
+				}
+				else if (key == "position")
+				{
+					bParsed = ParseFloats(tokens, index, &part.position.x, 3);
+				}
+				else if (key == "color")
+				{
+					bParsed = ParseFloats(tokens, index, &part.color.x, 4);
+				}
+				else if (key == "uv")
+				{
+					bParsed = ParseFloats(tokens, index, &part.uvScale.x, 2);
+				}
+				else if ((key == "texture") && (index < tokens.size()))
+				{
+					part.textureTag = HashTag(tokens[index++]);
+					bParsed = true;
+				}
+				else if ((key == "material") && (index < tokens.size()))
+				{
+					part.materialTag = HashTag(tokens[index++]);
+					bParsed = true;
+				}
+
+				if (bParsed == false)
+				{
+					return(ParseError(filename, lineNumber, "bad part value:" + key));
+				}
+			}
+
+			m_parts.push_back(part);
+			m_objects[currentObject].partCount++;
+		}
+		else if (keyword == "end")
+		{
+			if (currentObject < 0)
+			{
+				return(ParseError(filename, lineNumber, "end outside of an object"));
+			}
+			currentObject = -1;
+		}
+		else
+		{
+			return(ParseError(filename, lineNumber, "unknown entry:" + keyword));
+		}
+	}
+
+	if (currentObject >= 0)
+	{
+		return(ParseError(filename, lineNumber, "object without end"));
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  LoadBinary()
+ *
+ *  This method is used for loading the binary file compiled
+ *  from a scene text file.  The binary file is ignored when
+ *  the text file changed after it was compiled.
+ ***********************************************************/
+bool SceneFile::LoadBinary(const std::string& sourceFile)
+{
+	SCENE_HEADER header;
+	uint64_t sourceSize = 0;
+	int64_t sourceTime = 0;
+
+	Clear();
+
+	FILE* file = fopen(GetBinaryPath(sourceFile).c_str(), "rb");
+	if (file == NULL)
+	{
+		return(false);
+	}
+
+	bool bValid = (fread(&header, sizeof(SCENE_HEADER), 1, file) == 1) &&
+		(header.magic == SCENE_MAGIC) &&
+		(header.version == SCENE_VERSION);
+	// a binary file without its text file is still loaded
+	if ((bValid == true) &&
+		(TextureCache::GetFileStamp(sourceFile, sourceSize, sourceTime) == true))
+	{
+		bValid = (sourceSize == header.sourceSize) && (sourceTime == header.sourceTime);
+	}
+
+	if (bValid == true)
+	{
+		m_textures.resize(header.textureCount);
+		for (uint32_t i = 0; (i < header.textureCount) && (bValid == true); i++)
+		{
+			bValid = ReadString(file, m_textures[i].tag) &&
+				ReadString(file, m_textures[i].filename);
+		}
+
+		m_materials.resize(header.materialCount);
+		for (uint32_t i = 0; (i < header.materialCount) && (bValid == true); i++)
+		{
+			SCENE_MATERIAL& material = m_materials[i];
+			float values[11];
+
+			bValid = ReadString(file, material.tag) &&
+				(fread(values, sizeof(float), 11, file) == 11);
+			material.ambientColor = glm::vec3(values[0], values[1], values[2]);
+			material.ambientStrength = values[3];
+			material.diffuseColor = glm::vec3(values[4], values[5], values[6]);
+			material.specularColor = glm::vec3(values[7], values[8], values[9]);
+			material.shininess = values[10];
+		}
+	}
+
+	if (bValid == true)
+	{
+		m_objects.resize(header.objectCount);
+		m_parts.resize(header.partCount);
+		bValid = (fread(m_objects.data(), sizeof(SCENE_OBJECT), m_objects.size(), file) == m_objects.size()) &&
+			(fread(m_parts.data(), sizeof(SCENE_PART), m_parts.size(), file) == m_parts.size());
+	}
+	for (size_t i = 0; (i < m_objects.size()) && (bValid == true); i++)
+	{
+		bValid = ((uint64_t)m_objects[i].firstPart + m_objects[i].partCount <= m_parts.size());
+	}
+	fclose(file);
+
+	if (bValid == false)
+	{
+		Clear();
+	}
+
+	return(bValid);
+}
+
+/***********************************************************
+ *  WriteBinary()
+ *
+ *  This method is used for writing the loaded scene into
+ *  the binary file of a scene text file.  The size and
+ *  modification time of the text file are stored so that a
+ *  stale binary file is ignored after the text file changes.
+ ***********************************************************/
+bool SceneFile::WriteBinary(const std::string& sourceFile) const
+{
+	SCENE_HEADER header;
+	std::string filename = GetBinaryPath(sourceFile);
+
+	memset(&header, 0, sizeof(SCENE_HEADER));
+	header.magic = SCENE_MAGIC;
+	header.version = SCENE_VERSION;
+	header.textureCount = (uint32_t)m_textures.size();
+	header.materialCount = (uint32_t)m_materials.size();
+	header.objectCount = (uint32_t)m_objects.size();
+	header.partCount = (uint32_t)m_parts.size();
+	TextureCache::GetFileStamp(sourceFile, header.sourceSize, header.sourceTime);
+
+	FILE* file = fopen(filename.c_str(), "wb");
+	if (file == NULL)
+	{
+		return(false);
+	}
+
+	bool bReturn = (fwrite(&header, sizeof(SCENE_HEADER), 1, file) == 1);
+	for (size_t i = 0; (i < m_textures.size()) && (bReturn == true); i++)
+	{
+		bReturn = WriteString(file, m_textures[i].tag) &&
+			WriteString(file, m_textures[i].filename);
+	}
+	for (size_t i = 0; (i < m_materials.size()) && (bReturn == true); i++)
+	{
+		const SCENE_MATERIAL& material = m_materials[i];
+		float values[11] =
+		{
+			material.ambientColor.r, material.ambientColor.g, material.ambientColor.b,
+			material.ambientStrength,
+			material.diffuseColor.r, material.diffuseColor.g, material.diffuseColor.b,
+			material.specularColor.r, material.specularColor.g, material.specularColor.b,
+			material.shininess
+		};
+
+		bReturn = WriteString(file, material.tag) &&
+			(fwrite(values, sizeof(float), 11, file) == 11);
+	}
+	bReturn &= (fwrite(m_objects.data(), sizeof(SCENE_OBJECT), m_objects.size(), file) == m_objects.size());
+	bReturn &= (fwrite(m_parts.data(), sizeof(SCENE_PART), m_parts.size(), file) == m_parts.size());
+	fclose(file);
+
+	if (bReturn == false)
+	{
+		remove(filename.c_str());
+	}
+
+	return(bReturn);
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for removing everything loaded.
+ ***********************************************************/
+void SceneFile::Clear()
+{
+	m_textures.clear();
+	m_materials.clear();
+	m_objects.clear();
+	m_parts.clear();
+}
+
+/***********************************************************
+ *  GetTextures()
+ *
+ *  This method is used for getting the texture files of the
+ *  scene.
+ ***********************************************************/
+const std::vector<SceneFile::SCENE_TEXTURE>& SceneFile::GetTextures() const
+{
+	return(m_textures);
+}
+
+/***********************************************************
+ *  GetMaterials()
+ *
+ *  This method is used for getting the materials of the
+ *  scene.
+ ***********************************************************/
+const std::vector<SceneFile::SCENE_MATERIAL>& SceneFile::GetMaterials() const
+{
+	return(m_materials);
+}
+
+/***********************************************************
+ *  GetObjects()
+ *
+ *  This method is used for getting the objects of the
+ *  scene.
+ ***********************************************************/
+const std::vector<SceneFile::SCENE_OBJECT>& SceneFile::GetObjects() const
+{
+	return(m_objects);
+}
+
+/***********************************************************
+ *  GetParts()
+ *
+ *  This method is used for getting the parts of every
+ *  object of the scene.
+ ***********************************************************/
+const std::vector<SceneFile::SCENE_PART>& SceneFile::GetParts() const
+{
+	return(m_parts);
+}
+
+/***********************************************************
+ *  GetBinaryPath()
+ *
+ *  This method is used for getting the path of the binary
+ *  file, which sits next to the text file with the file
+ *  extension replaced.
+ ***********************************************************/
+std::string SceneFile::GetBinaryPath(const std::string& sourceFile)
+{
+	size_t separator = sourceFile.find_last_of("/\\");
+	size_t extension = sourceFile.find_last_of('.');
+
+	if ((extension == std::string::npos) ||
+		((separator != std::string::npos) && (extension < separator)))
+	{
+		return(sourceFile + g_BinaryExtension);
+	}
+
+	return(sourceFile.substr(0, extension) + g_BinaryExtension);
+}
@@ -0,0 +1,121 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenefile.h
+// ============
+// read and write the scene description files
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  SceneFile
+ *
+ *  This class holds the description of a scene: the texture
+ *  files, the materials, and the objects with the mesh parts
+ *  that they are drawn with.  Scenes are written as text
+ *  files and compiled into a binary file next to the text
+ *  file, which loads without any parsing.  The binary file
+ *  is only used while it matches the text file that it was
+ *  compiled from.
+ *
+ *  The text file has one entry per line, and # starts a
+ *  comment:
+ *
+ *    texture <tag> <image file>
+ *    material <tag> ambient <r g b> <strength>
+ *        diffuse <r g b> specular <r g b> shininess <value>
+ *    object <name> position <x y z>
+ *        part <mesh> [faces top bottom sides] [scale <x y z>]
+ *            [rotation <x y z>] [position <x y z>]
+ *            [texture <tag> | color <r g b a>] [uv <u v>]
+ *            [material <tag>]
+ *    end
+ *
+ *  Part positions are relative to the position of their
+ *  object, and the rotation is given in degrees.
+ ***********************************************************/
+class SceneFile
+{
+public:
+	// the faces of a cylinder that a part draws
+	enum PART_FACE
+	{
+		PART_FACE_TOP = 1,
+		PART_FACE_BOTTOM = 2,
+		PART_FACE_SIDES = 4,
+		PART_FACE_ALL = 7
+	};
+
+	struct SCENE_TEXTURE
+	{
+		std::string tag;
+		std::string filename;
+	};
+
+	struct SCENE_MATERIAL
+	{
+		std::string tag;
+		glm::vec3 ambientColor;
+		float ambientStrength;
+		glm::vec3 diffuseColor;
+		glm::vec3 specularColor;
+		float shininess;
+	};
+
+	struct SCENE_OBJECT
+	{
+		// hash of the object name
+		uint64_t nameTag;
+		glm::vec3 position;
+		// the parts of the object follow each other in the part list
+		uint32_t firstPart;
+		uint32_t partCount;
+	};
+
+	struct SCENE_PART
+	{
+		// hashes of the mesh name and of the texture and material
+		// tags, or 0 for no texture or material
+		uint64_t meshTag;
+		uint64_t textureTag;
+		uint64_t materialTag;
+		uint32_t faces;
+		glm::vec3 scale;
+		glm::vec3 rotation;
+		glm::vec3 position;
+		glm::vec4 color;
+		glm::vec2 uvScale;
+	};
+
+	// load the binary file of a scene when it matches the text
+	// file, and the text file otherwise
+	bool Load(const std::string& filename);
+	// parse a scene text file
+	bool LoadText(const std::string& filename);
+	// load the binary file compiled from a scene text file
+	bool LoadBinary(const std::string& sourceFile);
+	// write the loaded scene into the binary file of a text file
+	bool WriteBinary(const std::string& sourceFile) const;
+	// remove everything loaded
+	void Clear();
+
+	const std::vector<SCENE_TEXTURE>& GetTextures() const;
+	const std::vector<SCENE_MATERIAL>& GetMaterials() const;
+	const std::vector<SCENE_OBJECT>& GetObjects() const;
+	const std::vector<SCENE_PART>& GetParts() const;
+
+	// get the path of the binary file for a scene text file
+	static std::string GetBinaryPath(const std::string& sourceFile);
+
+private:
+	std::vector<SCENE_TEXTURE> m_textures;
+	std::vector<SCENE_MATERIAL> m_materials;
+	std::vector<SCENE_OBJECT> m_objects;
+	std::vector<SCENE_PART> m_parts;
+};
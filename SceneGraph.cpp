@@ -0,0 +1,237 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenegraph.cpp
+// ============
+// parent and child transforms of the scene objects
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SceneGraph.h"
+
+#include <iostream>
+
+/***********************************************************
+ *  SceneGraph()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+SceneGraph::SceneGraph()
+{
+	m_bDirty = false;
+}
+
+/***********************************************************
+ *  AddNode()
+ *
+ *  This method is used for adding a node to the graph.  The
+ *  subtrees of the parent and of all of its ancestors grow
+ *  to include the new node.
+ ***********************************************************/
+int SceneGraph::AddNode(
+	int parent,
+	const glm::vec3& scaleXYZ,
+	float XrotationDegrees,
+	float YrotationDegrees,
+	float ZrotationDegrees,
+	const glm::vec3& positionXYZ)
+{
+	int node = (int)m_nodes.size();
+
+	if ((parent >= 0) && (m_nodes[parent].subtreeEnd != node))
+	{
+		std::cout << "Scene node " << node << " cannot be added below node " << parent << ", which already has a later sibling" << std::endl;
+		return(-1);
+	}
+
+	SCENE_NODE sceneNode;
+	sceneNode.parent = parent;
+	sceneNode.subtreeEnd = node + 1;
+	sceneNode.bDirty = true;
+	sceneNode.bChildDirty = false;
+	m_nodes.push_back(sceneNode);
+	m_worldMatrices.push_back(glm::mat4(1.0f));
+
+	for (int ancestor = parent; ancestor >= 0; ancestor = m_nodes[ancestor].parent)
+	{
+		m_nodes[ancestor].subtreeEnd = node + 1;
+		m_nodes[ancestor].bChildDirty = true;
+	}
+
+	m_localTransforms.Add(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
+	m_bDirty = true;
+
+	return(node);
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for removing every node.
+ ***********************************************************/
+void SceneGraph::Clear()
+{
+	m_nodes.clear();
+	m_worldMatrices.clear();
+	m_localTransforms.Clear();
+	m_bDirty = false;
+}
+
+/***********************************************************
+ *  SetScale()
+ *
+ *  This method is used for changing the local scale of a
+ *  node.
+ ***********************************************************/
+void SceneGraph::SetScale(int node, const glm::vec3& scaleXYZ)
+{
+	m_localTransforms.SetScale(node, scaleXYZ);
+	MarkDirty(node);
+}
+
+/***********************************************************
+ *  SetRotation()
+ *
+ *  This method is used for changing the local rotation of a
+ *  node.
+ ***********************************************************/
+void SceneGraph::SetRotation(
+	int node,
+	float XrotationDegrees,
+	float YrotationDegrees,
+	float ZrotationDegrees)
+{
+	m_localTransforms.SetRotation(node, XrotationDegrees, YrotationDegrees, ZrotationDegrees);
+	MarkDirty(node);
+}
+
+/***********************************************************
+ *  SetPosition()
+ *
+ *  This method is used for changing the local position of a
+ *  node.
+ ***********************************************************/
+void SceneGraph::SetPosition(int node, const glm::vec3& positionXYZ)
+{
+	m_localTransforms.SetPosition(node, positionXYZ);
+	MarkDirty(node);
+}
+
+/***********************************************************
+ *  MarkDirty()
+ *
+ *  This method is used for marking a node as changed.  The
+ *  walk up the ancestors stops at the first one that already
+ *  knows about a changed node below it.
+ ***********************************************************/
+void SceneGraph::MarkDirty(int node)
+{
+	m_nodes[node].bDirty = true;
+	m_bDirty = true;
+
+	for (int ancestor = m_nodes[node].parent; ancestor >= 0; ancestor = m_nodes[ancestor].parent)
+	{
+		if (m_nodes[ancestor].bChildDirty == true)
+		{
+			break;
+		}
+		m_nodes[ancestor].bChildDirty = true;
+	}
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for computing the world matrices of
+ *  the changed nodes and of every node below them.  Subtrees
+ *  without any changed node are stepped over in one jump.
+ ***********************************************************/
+bool SceneGraph::Update()
+{
+	if (m_bDirty == false)
+	{
+		return(false);
+	}
+
+	m_localTransforms.Update();
+
+	int node = 0;
+	while (node < (int)m_nodes.size())
+	{
+		SCENE_NODE& sceneNode = m_nodes[node];
+
+		if (sceneNode.bDirty == true)
+		{
+			// a changed node moves everything below it
+			for (int i = node; i < sceneNode.subtreeEnd; i++)
+			{
+				int parent = m_nodes[i].parent;
+				if (parent < 0)
+				{
+					m_worldMatrices[i] = m_localTransforms.GetMatrix(i);
+				}
+				else
+				{
+					m_worldMatrices[i] = m_worldMatrices[parent] * m_localTransforms.GetMatrix(i);
+				}
+				m_nodes[i].bDirty = false;
+				m_nodes[i].bChildDirty = false;
+			}
+			node = sceneNode.subtreeEnd;
+		}
+		else if (sceneNode.bChildDirty == true)
+		{
+			// look for the changed nodes below this one
+			sceneNode.bChildDirty = false;
+			node++;
+		}
+		else
+		{
+			node = sceneNode.subtreeEnd;
+		}
+	}
+
+	m_bDirty = false;
+
+	return(true);
+}
+
+/***********************************************************
+ *  GetWorldMatrix()
+ *
+ *  This method is used for getting the world matrix of a
+ *  node, as computed by the last update.
+ ***********************************************************/
+const glm::mat4& SceneGraph::GetWorldMatrix(int node) const
+{
+	return(m_worldMatrices[node]);
+}
+
+/***********************************************************
+ *  GetParent()
+ *
+ *  This method is used for getting the parent of a node.
+ ***********************************************************/
+int SceneGraph::GetParent(int node) const
+{
+	return(m_nodes[node].parent);
+}
+
+/***********************************************************
+ *  GetSubtreeEnd()
+ *
+ *  This method is used for getting the index after the last
+ *  node below a node.
+ ***********************************************************/
+int SceneGraph::GetSubtreeEnd(int node) const
+{
+	return(m_nodes[node].subtreeEnd);
+}
+
+/***********************************************************
+ *  GetCount()
+ *
+ *  This method is used for getting the number of nodes.
+ ***********************************************************/
+int SceneGraph::GetCount() const
+{
+	return((int)m_nodes.size());
+}
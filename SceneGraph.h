@@ -0,0 +1,83 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenegraph.h
+// ============
+// parent and child transforms of the scene objects
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "TransformStore.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  SceneGraph
+ *
+ *  This class keeps the nodes of the scene in one flat array
+ *  in depth first order, so every node comes after its
+ *  parent and the nodes below a node directly follow it.
+ *  The local transforms live in a transform store, and the
+ *  world matrices are only computed again for the subtrees
+ *  under nodes that changed.  Whole subtrees are skipped
+ *  when nothing in them changed.
+ ***********************************************************/
+class SceneGraph
+{
+public:
+	// constructor
+	SceneGraph();
+
+	// add a node below a parent node, or at the top of the graph
+	// with a parent of -1, and return its index - the parent has
+	// to be the last added node or one of its ancestors, which
+	// keeps every subtree together in the array
+	int AddNode(
+		int parent,
+		const glm::vec3& scaleXYZ,
+		float XrotationDegrees,
+		float YrotationDegrees,
+		float ZrotationDegrees,
+		const glm::vec3& positionXYZ);
+	// remove every node
+	void Clear();
+
+	// change the local transform of a node
+	void SetScale(int node, const glm::vec3& scaleXYZ);
+	void SetRotation(int node, float XrotationDegrees, float YrotationDegrees, float ZrotationDegrees);
+	void SetPosition(int node, const glm::vec3& positionXYZ);
+
+	// compute the world matrices of the changed subtrees, and
+	// return whether any world matrix changed
+	bool Update();
+	// get the world matrix computed for a node
+	const glm::mat4& GetWorldMatrix(int node) const;
+	// get the parent of a node, or -1 for a top node
+	int GetParent(int node) const;
+	// get the index after the last node below a node
+	int GetSubtreeEnd(int node) const;
+	// get the number of nodes
+	int GetCount() const;
+
+private:
+	struct SCENE_NODE
+	{
+		int parent;
+		int subtreeEnd;
+		// the local transform of the node changed
+		bool bDirty;
+		// a node somewhere below the node changed
+		bool bChildDirty;
+	};
+
+	// mark a node as changed, and its ancestors as having a
+	// changed node below them
+	void MarkDirty(int node);
+
+	std::vector<SCENE_NODE> m_nodes;
+	std::vector<glm::mat4> m_worldMatrices;
+	TransformStore m_localTransforms;
+	bool m_bDirty;
+};
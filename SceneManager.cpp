@@ -8,6 +8,10 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "SceneManager.h"
+#include "MeshOptimizer.h"
+#include "SceneTags.h"
+#include "TextureAtlas.h"
+#include "TextureCompression.h"
 
 #ifndef STB_IMAGE_IMPLEMENTATION
 #define STB_IMAGE_IMPLEMENTATION
@@ -16,6 +20,9 @@
 
 #include <glm/gtx/transform.hpp>
 
+#include <algorithm>
+#include <cstring>
+
 // declare the global variables
 namespace
 {
@@ -24,6 +31,313 @@ namespace
 	const char* g_TextureValueName = "objectTexture";
 	const char* g_UseTextureName = "bUseTexture";
 	const char* g_UseLightingName = "bUseLighting";
+	const char* g_TextureArrayName = "objectTextureArray";
+	const char* g_TextureLayerName = "objectTextureLayer";
+	const char* g_TextureHandlesName = "objectTextureHandles";
+	const char* g_TextureIndexName = "objectTextureIndex";
+	// offset and scale of the texture on its atlas page - the shader
+	// samples at UVatlasRect.xy + fract(uv * UVscale) * UVatlasRect.zw
+	// so that tiled textures keep repeating inside their rectangle
+	const char* g_AtlasRectName = "UVatlasRect";
+
+	// width and height of the texture atlas pages
+	const int ATLAS_PAGE_SIZE = 1024;
+	// textures up to this size on both sides are packed into pages
+	const int ATLAS_MAX_TEXTURE_SIZE = 256;
+	// texels wrapped around each packed texture, which keeps the
+	// neighbouring textures out of the first few mip levels
+	const int ATLAS_PADDING = 8;
+	const int ATLAS_MAX_LEVEL = 3;
+
+	// uniform block holding every defined material, and the index
+	// of the material used by the next draw - the shader declares
+	//   layout(std140) uniform MaterialBlock { Material materials[N]; };
+	// where each Material is three vec4 values, holding the ambient
+	// color and strength, the diffuse color, and the specular color
+	// and shininess - an index of -1 is a draw without a material,
+	// which the shader does not read any material for
+	const char* g_MaterialBlockName = "MaterialBlock";
+	const char* g_MaterialIndexName = "materialIndex";
+	const GLuint MATERIAL_BLOCK_BINDING = 1;
+
+	struct MATERIAL_BLOCK_ENTRY
+	{
+		glm::vec4 ambient;
+		glm::vec4 diffuse;
+		glm::vec4 specular;
+	};
+
+	// shader storage block holding the instances of the frame, which
+	// the instanced and the indirect draws read their values from,
+	// and the switch between those and single draws - the shader
+	// declares
+	//   layout(std430, binding = 2) buffer InstanceBlock { Instance instances[]; };
+	// with the members of INSTANCE_DATA, and reads the values of
+	// instances[gl_BaseInstance + gl_InstanceID] while bUseInstances
+	// is set
+	const char* g_InstanceBlockName = "InstanceBlock";
+	const char* g_UseInstancesName = "bUseInstances";
+	const GLuint INSTANCE_BLOCK_BINDING = 2;
+
+	// the shared mesh buffers are packed when the shader declares
+	// bPackedVertices, and then unpacks the vertices with
+	//   position = packedPositionOffset + position * packedPositionScale
+	//   normal = the octahedral decoding of normal.xy
+	// while bPackedVertices is set
+	const char* g_PackedVerticesName = "bPackedVertices";
+	const char* g_PackedPositionOffsetName = "packedPositionOffset";
+	const char* g_PackedPositionScaleName = "packedPositionScale";
+
+	// largest side of a texture reduced for the texture budget
+	const int REDUCED_TEXTURE_SIZE = 64;
+
+	// the names that scene files use for the basic meshes
+	struct MESH_NAME
+	{
+		uint64_t tag;
+		SceneManager::MESH_SHAPE shape;
+	};
+	const MESH_NAME g_MeshNames[] =
+	{
+		{ "box"_tag, SceneManager::MESH_SHAPE_BOX },
+		{ "plane"_tag, SceneManager::MESH_SHAPE_PLANE },
+		{ "cylinder"_tag, SceneManager::MESH_SHAPE_CYLINDER },
+		{ "cone"_tag, SceneManager::MESH_SHAPE_CONE },
+		{ "prism"_tag, SceneManager::MESH_SHAPE_PRISM },
+		{ "pyramid4"_tag, SceneManager::MESH_SHAPE_PYRAMID4 },
+		{ "sphere"_tag, SceneManager::MESH_SHAPE_SPHERE },
+		{ "tapered_cylinder"_tag, SceneManager::MESH_SHAPE_TAPERED_CYLINDER },
+		{ "torus"_tag, SceneManager::MESH_SHAPE_TORUS },
+	};
+	const int g_MeshNameCount = sizeof(g_MeshNames) / sizeof(g_MeshNames[0]);
+
+	// radius of the tube of the torus mesh, around its ring with a
+	// radius of 1
+	const float TORUS_THICKNESS = 0.1f;
+
+	// the boxes around the basic meshes, by mesh shape, as center
+	// and half size
+	const BoundingVolumeTree::BOUNDS g_MeshBounds[] =
+	{
+		{ glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.5f, 0.5f, 0.5f) },
+		{ glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(1.0f, 0.0f, 1.0f) },
+		{ glm::vec3(0.0f, 0.5f, 0.0f), glm::vec3(1.0f, 0.5f, 1.0f) },
+		{ glm::vec3(0.0f, 0.5f, 0.0f), glm::vec3(1.0f, 0.5f, 1.0f) },
+		{ glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.5f, 0.5f, 0.5f) },
+		{ glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.5f, 0.5f, 0.5f) },
+		{ glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(1.0f, 1.0f, 1.0f) },
+		{ glm::vec3(0.0f, 0.5f, 0.0f), glm::vec3(1.0f, 0.5f, 1.0f) },
+		{ glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(1.0f + TORUS_THICKNESS, 1.0f + TORUS_THICKNESS, TORUS_THICKNESS) },
+	};
+
+	// boxes and planes become occluders when their second largest
+	// half size reaches this far
+	const float OCCLUDER_MIN_EXTENT = 1.0f;
+
+	// the part of the screen height covered by a round mesh, below
+	// which each level of detail gives way to the next level, and
+	// how far past that the size has to go before the level
+	// changes back, so that a draw at the edge does not flicker
+	// between the levels
+	const float DETAIL_SCREEN_SIZES[MeshGeometry::DETAIL_LEVELS - 1] = { 0.2f, 0.05f };
+	const float DETAIL_HYSTERESIS = 0.2f;
+
+	// distance from the camera covered by the depth of the draw sort
+	// keys, which matches the far plane of the view
+	const float SORT_DEPTH_RANGE = 100.0f;
+
+	// OpenGL pixel formats and the smallest internal formats that
+	// hold images with 1 to 4 color channels
+	const GLenum g_PixelFormats[4] = { GL_RED, GL_RG, GL_RGB, GL_RGBA };
+	const GLint g_InternalFormats8[4] = { GL_R8, GL_RG8, GL_RGB8, GL_RGBA8 };
+	const GLint g_InternalFormats16[4] = { GL_R16, GL_RG16, GL_RGB16, GL_RGBA16 };
+	const GLint g_InternalFormatsFloat[4] = { GL_R16F, GL_RG16F, GL_RGB16F, GL_RGBA16F };
+
+	/***********************************************************
+	 *  HasDetailLevels()
+	 *
+	 *  Only the round meshes are built at several levels of
+	 *  detail, the flat sided meshes have a single level.
+	 ***********************************************************/
+	bool HasDetailLevels(SceneManager::MESH_SHAPE shape)
+	{
+		return((shape == SceneManager::MESH_SHAPE_CYLINDER) ||
+			(shape == SceneManager::MESH_SHAPE_CONE) ||
+			(shape == SceneManager::MESH_SHAPE_SPHERE) ||
+			(shape == SceneManager::MESH_SHAPE_TAPERED_CYLINDER) ||
+			(shape == SceneManager::MESH_SHAPE_TORUS));
+	}
+
+	/***********************************************************
+	 *  BuildShapeMesh()
+	 *
+	 *  Build the mesh of a mesh shape at a level of detail.
+	 ***********************************************************/
+	void BuildShapeMesh(SceneManager::MESH_SHAPE shape, int level, MeshGeometry::MESH_DATA& mesh)
+	{
+		switch (shape)
+		{
+		case SceneManager::MESH_SHAPE_BOX:
+			MeshGeometry::BuildBox(mesh);
+			break;
+		case SceneManager::MESH_SHAPE_PLANE:
+			MeshGeometry::BuildPlane(mesh);
+			break;
+		case SceneManager::MESH_SHAPE_CYLINDER:
+			MeshGeometry::BuildCylinder(mesh, level);
+			break;
+		case SceneManager::MESH_SHAPE_CONE:
+			MeshGeometry::BuildCone(mesh, level);
+			break;
+		case SceneManager::MESH_SHAPE_PRISM:
+			MeshGeometry::BuildPrism(mesh);
+			break;
+		case SceneManager::MESH_SHAPE_PYRAMID4:
+			MeshGeometry::BuildPyramid4(mesh);
+			break;
+		case SceneManager::MESH_SHAPE_SPHERE:
+			MeshGeometry::BuildSphere(mesh, level);
+			break;
+		case SceneManager::MESH_SHAPE_TAPERED_CYLINDER:
+			MeshGeometry::BuildTaperedCylinder(mesh, level);
+			break;
+		default:
+			MeshGeometry::BuildTorus(mesh, TORUS_THICKNESS, level);
+			break;
+		}
+	}
+
+	/***********************************************************
+	 *  SelectDetailLevel()
+	 *
+	 *  Pick the level of detail for the part of the screen
+	 *  height that a draw covers.  The level only moves on
+	 *  once the size is well past the size between the levels.
+	 ***********************************************************/
+	int SelectDetailLevel(int level, float screenSize)
+	{
+		while ((level > 0) &&
+			(screenSize > DETAIL_SCREEN_SIZES[level - 1] * (1.0f + DETAIL_HYSTERESIS)))
+		{
+			level--;
+		}
+		while ((level < MeshGeometry::DETAIL_LEVELS - 1) &&
+			(screenSize < DETAIL_SCREEN_SIZES[level] * (1.0f - DETAIL_HYSTERESIS)))
+		{
+			level++;
+		}
+
+		return(level);
+	}
+
+	/***********************************************************
+	 *  SetTextureSwizzle()
+	 *
+	 *  Grayscale images are stored in one channel and grayscale
+	 *  images with alpha in two, so the shader still reads them
+	 *  as RGBA through a swizzle of the stored channels.
+	 ***********************************************************/
+	void SetTextureSwizzle(GLenum target, int colorChannels)
+	{
+		if (colorChannels == 1)
+		{
+			const GLint swizzle[4] = { GL_RED, GL_RED, GL_RED, GL_ONE };
+			glTexParameteriv(target, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+		}
+		else if (colorChannels == 2)
+		{
+			const GLint swizzle[4] = { GL_RED, GL_RED, GL_RED, GL_GREEN };
+			glTexParameteriv(target, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+		}
+	}
+
+	/***********************************************************
+	 *  GetTextureBytes()
+	 *
+	 *  Get the video memory taken by the mip levels of a
+	 *  texture, starting from its first resident level.  RGB
+	 *  formats are counted at 4 bytes per pixel, as drivers pad
+	 *  them to RGBA.
+	 ***********************************************************/
+	size_t GetTextureBytes(const SceneManager::TEXTURE_INFO& texture)
+	{
+		size_t bytes = 0;
+		int pixelBytes = 4;
+
+		switch (texture.internalFormat)
+		{
+		case GL_R8:
+			pixelBytes = 1;
+			break;
+		case GL_RG8:
+		case GL_R16:
+		case GL_R16F:
+			pixelBytes = 2;
+			break;
+		case GL_RGB16:
+		case GL_RGBA16:
+		case GL_RGB16F:
+		case GL_RGBA16F:
+			pixelBytes = 8;
+			break;
+		}
+
+		for (int level = std::max(texture.residentLevel, 0); (texture.residentLevel >= 0) && (level < texture.mipLevels); level++)
+		{
+			int width = std::max(texture.width >> level, 1);
+			int height = std::max(texture.height >> level, 1);
+
+			if ((texture.internalFormat == TextureCompression::BLOCK_FORMAT_BC1) ||
+				(texture.internalFormat == TextureCompression::BLOCK_FORMAT_BC3) ||
+				(texture.internalFormat == TextureCompression::BLOCK_FORMAT_BC7))
+			{
+				bytes += (size_t)((width + 3) / 4) * ((height + 3) / 4) *
+					TextureCompression::GetBlockSize((TextureCompression::BLOCK_FORMAT)texture.internalFormat);
+			}
+			else
+			{
+				bytes += (size_t)width * height * pixelBytes;
+			}
+		}
+
+		return(bytes);
+	}
+
+	/***********************************************************
+	 *  CopyToAtlasPage()
+	 *
+	 *  Copy the RGBA pixels of a texture onto an atlas page,
+	 *  surrounded by padding that wraps around like GL_REPEAT.
+	 *  Grayscale textures are read back without their swizzle,
+	 *  so it is applied to the copied pixels here.
+	 ***********************************************************/
+	void CopyToAtlasPage(
+		const unsigned char* pixels,
+		int width,
+		int height,
+		int colorChannels,
+		unsigned char* page,
+		int pageX,
+		int pageY)
+	{
+		for (int y = -ATLAS_PADDING; y < height + ATLAS_PADDING; y++)
+		{
+			int sourceY = ((y % height) + height) % height;
+			unsigned char* target = page + ((size_t)(pageY + ATLAS_PADDING + y) * ATLAS_PAGE_SIZE + pageX) * 4;
+
+			for (int x = -ATLAS_PADDING; x < width + ATLAS_PADDING; x++)
+			{
+				int sourceX = ((x % width) + width) % width;
+				const unsigned char* source = pixels + ((size_t)sourceY * width + sourceX) * 4;
+
+				target[0] = source[0];
+				target[1] = (colorChannels <= 2) ? source[0] : source[1];
+				target[2] = (colorChannels <= 2) ? source[0] : source[2];
+				target[3] = (colorChannels == 2) ? source[1] : source[3];
+				target += 4;
+			}
+		}
+	}
 
 }
 
@@ -38,12 +352,31 @@ SceneManager::SceneManager(ShaderManager* pShaderManager)
 	m_basicMeshes = new ShapeMeshes();
 
 	// initialize the texture collection
-	for (int i = 0; i < 16; i++)
+	m_textureBackend = TEXTURE_BACKEND_UNITS;
+	m_boundTextureUnits = 0;
+	m_currentTextureArray = -1;
+	m_bStreamTextures = true;
+	m_bUseTextureAtlas = false;
+	m_fallbackTextureID = 0;
+	m_materialBuffer = 0;
+	m_instanceBuffer = 0;
+	m_indirectBuffer = 0;
+	m_drawSubmission = DRAW_SUBMISSION_SINGLE;
+	m_bBakeStaticDraws = false;
+	m_vertexFormat = MeshBuffer::VERTEX_FORMAT_FLOAT;
+	m_viewMatrix = glm::mat4(1.0f);
+	m_projectionMatrix = glm::mat4(1.0f);
+	for (int shape = 0; shape < MESH_SHAPE_COUNT; shape++)
 	{
-		m_textureIDs[i].tag = "/0";
-		m_textureIDs[i].ID = -1;
+		for (int level = 0; level < MeshGeometry::DETAIL_LEVELS; level++)
+		{
+			m_meshLevels[shape][level] = shape;
+		}
 	}
-	m_loadedTextures = 0;
+
+	// only the large boxes and planes are drawn as occluders
+	MeshGeometry::BuildBox(m_occluderBox);
+	MeshGeometry::BuildPlane(m_occluderPlane);
 }
 
 /***********************************************************
@@ -59,6 +392,21 @@ SceneManager::~SceneManager()
 	m_basicMeshes = NULL;
 	// destroy the created OpenGL textures
 	DestroyGLTextures();
+	if (m_materialBuffer != 0)
+	{
+		glDeleteBuffers(1, &m_materialBuffer);
+		m_materialBuffer = 0;
+	}
+	if (m_instanceBuffer != 0)
+	{
+		glDeleteBuffers(1, &m_instanceBuffer);
+		m_instanceBuffer = 0;
+	}
+	if (m_indirectBuffer != 0)
+	{
+		glDeleteBuffers(1, &m_indirectBuffer);
+		m_indirectBuffer = 0;
+	}
 }
 
 /***********************************************************
@@ -71,26 +419,108 @@ SceneManager::~SceneManager()
  ***********************************************************/
 bool SceneManager::CreateGLTexture(const char* filename, std::string tag)
 {
-	int width = 0;
-	int height = 0;
-	int colorChannels = 0;
-	GLuint textureID = 0;
+	TextureDecoder::TEXTURE_REQUEST request;
+	TextureDecoder::DECODED_IMAGE image;
+	bool bReturn = false;
+
+	request.filename = filename;
+	request.tag = tag;
+	request.bHighPrecision = true;
 
 	// indicate to always flip images vertically when loaded
 	stbi_set_flip_vertically_on_load(true);
 
 	// try to parse the image data from the specified image file
-	unsigned char* image = stbi_load(
-		filename,
-		&width,
-		&height,
-		&colorChannels,
-		0);
+	TextureDecoder::DecodeFile(request, image);
+
+	bReturn = UploadGLTexture(image);
+
+	// free the image data from local memory
+	TextureDecoder::FreeImage(image);
+
+	return(bReturn);
+}
+
+/***********************************************************
+ *  CreateGLTextures()
+ *
+ *  This method is used for loading a list of textures.  The
+ *  image files are decoded at the same time on the worker
+ *  threads of the texture decoder, and each decoded image is
+ *  uploaded into OpenGL on this thread as soon as it is ready.
+ ***********************************************************/
+void SceneManager::CreateGLTextures(
+	const std::vector<TextureDecoder::TEXTURE_REQUEST>& requests)
+{
+	TextureDecoder decoder;
+	TextureDecoder::DECODED_IMAGE image;
+
+	decoder.Start(requests);
+
+	while (decoder.WaitForNext(image) == true)
+	{
+		UploadGLTexture(image);
+
+		// free the image data from local memory
+		TextureDecoder::FreeImage(image);
+	}
+}
+
+/***********************************************************
+ *  UploadGLTexture()
+ *
+ *  This method is used for uploading the decoded image data
+ *  into a new OpenGL texture, and registering the texture in
+ *  the next available texture slot in memory.
+ ***********************************************************/
+bool SceneManager::UploadGLTexture(TextureDecoder::DECODED_IMAGE& image)
+{
+	TEXTURE_INFO textureInfo;
+
+	if (LoadGLTextureLevels(image, 0, textureInfo) == false)
+	{
+		return false;
+	}
+
+	// register the loaded texture and associate it with the special tag string
+	m_textureIDs.push_back(textureInfo);
+
+	return true;
+}
+
+/***********************************************************
+ *  LoadGLTextureLevels()
+ *
+ *  This method is used for configuring the texture mapping
+ *  parameters in OpenGL, uploading the decoded image data
+ *  and generating the mipmaps.  When texture streaming is
+ *  on, a cached mip chain is handed over to the texture
+ *  streamer instead of being uploaded all at once.  With a
+ *  first level above 0, only the smaller levels of a cached
+ *  mip chain are uploaded, for a texture that was reduced to
+ *  stay within the texture budget.
+ ***********************************************************/
+bool SceneManager::LoadGLTextureLevels(
+	TextureDecoder::DECODED_IMAGE& image,
+	int firstLevel,
+	TEXTURE_INFO& textureInfo)
+{
+	GLuint textureID = 0;
+
+	if ((firstLevel > 0) && ((int)image.cache.mipLevels.size() <= firstLevel))
+	{
+		// only cached mip chains can be loaded from a smaller level
+		return false;
+	}
 
 	// if the image was successfully read from the image file
-	if (image)
+	// or mapped from the texture cache
+	if ((image.pixels != NULL) || (image.cache.mipLevels.size() > 0))
 	{
-		std::cout << "Successfully loaded image:" << filename << ", width:" << width << ", height:" << height << ", channels:" << colorChannels << std::endl;
+		if (firstLevel == 0)
+		{
+			std::cout << "Successfully loaded image:" << image.filename << ", width:" << image.width << ", height:" << image.height << ", channels:" << image.colorChannels << std::endl;
+		}
 
 		glGenTextures(1, &textureID);
 		glBindTexture(GL_TEXTURE_2D, textureID);
@@ -102,34 +532,108 @@ bool SceneManager::CreateGLTexture(const char* filename, std::string tag)
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-		// if the loaded image is in RGB format
-		if (colorChannels == 3)
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
-		// if the loaded image is in RGBA format - it supports transparency
-		else if (colorChannels == 4)
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
-		else
+		GLint internalFormat = 0;
+		GLenum pixelFormat = 0;
+		GLenum pixelType = GL_UNSIGNED_BYTE;
+
+		if ((image.colorChannels < 1) || (image.colorChannels > 4))
 		{
-			std::cout << "Not implemented to handle image with " << colorChannels << " channels" << std::endl;
+			std::cout << "Not implemented to handle image with " << image.colorChannels << " channels" << std::endl;
+			glBindTexture(GL_TEXTURE_2D, 0);
+			glDeleteTextures(1, &textureID);
 			return false;
 		}
 
-		// generate the texture mipmaps for mapping textures to lower resolutions
-		glGenerateMipmap(GL_TEXTURE_2D);
+		// store every image at the smallest format that holds its
+		// channels - grayscale masks take one byte per pixel
+		pixelFormat = g_PixelFormats[image.colorChannels - 1];
+		if (image.pixelType == TextureDecoder::PIXEL_TYPE_FLOAT)
+		{
+			internalFormat = g_InternalFormatsFloat[image.colorChannels - 1];
+			pixelType = GL_FLOAT;
+		}
+		else if (image.pixelType == TextureDecoder::PIXEL_TYPE_UINT16)
+		{
+			internalFormat = g_InternalFormats16[image.colorChannels - 1];
+			pixelType = GL_UNSIGNED_SHORT;
+		}
+		else
+		{
+			internalFormat = g_InternalFormats8[image.colorChannels - 1];
+		}
+		SetTextureSwizzle(GL_TEXTURE_2D, image.colorChannels);
+
+		// rows of RGB and grayscale images and of the small mip
+		// levels are not padded to 4 bytes
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+		int levelCount = (int)image.cache.mipLevels.size() - firstLevel;
+
+		if (image.cache.compressedFormat != 0)
+		{
+			// block compressed levels baked offline are uploaded as
+			// they are, straight from the mapped container
+			internalFormat = image.cache.compressedFormat;
+			for (int level = 0; level < levelCount; level++)
+			{
+				const TextureCache::MIP_LEVEL& mipLevel = image.cache.mipLevels[firstLevel + level];
+				glCompressedTexImage2D(GL_TEXTURE_2D, level, internalFormat, mipLevel.width, mipLevel.height, 0, (GLsizei)mipLevel.size, mipLevel.pixels);
+			}
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+		}
+		else if ((levelCount > 0) && (firstLevel == 0) && (m_bStreamTextures == true))
+		{
+			// allocate every level up front, then let the streamer
+			// fill them in from the coarsest level to the finest
+			glTexStorage2D(GL_TEXTURE_2D, levelCount, internalFormat, image.width, image.height);
+			m_textureStreamer.Add(textureID, pixelFormat, image);
+		}
+		else if (levelCount > 0)
+		{
+			// the cache already holds the full mip chain, so every
+			// level is uploaded straight from the mapped cache file
+			for (int level = 0; level < levelCount; level++)
+			{
+				const TextureCache::MIP_LEVEL& mipLevel = image.cache.mipLevels[firstLevel + level];
+				glTexImage2D(GL_TEXTURE_2D, level, internalFormat, mipLevel.width, mipLevel.height, 0, pixelFormat, GL_UNSIGNED_BYTE, mipLevel.pixels);
+			}
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+		}
+		else
+		{
+			glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, image.width, image.height, 0, pixelFormat, pixelType, image.pixels);
+
+			// generate the texture mipmaps for mapping textures to lower resolutions
+			glGenerateMipmap(GL_TEXTURE_2D);
+		}
+
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
 
-		// free the image data from local memory
-		stbi_image_free(image);
 		glBindTexture(GL_TEXTURE_2D, 0); // Unbind the texture
 
-		// register the loaded texture and associate it with the special tag string
-		m_textureIDs[m_loadedTextures].ID = textureID;
-		m_textureIDs[m_loadedTextures].tag = tag;
-		m_loadedTextures++;
+		textureInfo.tag = image.tag;
+		textureInfo.filename = image.filename;
+		textureInfo.ID = textureID;
+		textureInfo.width = image.width;
+		textureInfo.height = image.height;
+		textureInfo.colorChannels = image.colorChannels;
+		textureInfo.internalFormat = internalFormat;
+		textureInfo.mipLevels = 1;
+		while ((std::max(image.width, image.height) >> textureInfo.mipLevels) > 0)
+		{
+			textureInfo.mipLevels++;
+		}
+		textureInfo.residentLevel = firstLevel;
+		textureInfo.arrayIndex = -1;
+		textureInfo.layer = -1;
+		textureInfo.handle = 0;
+		textureInfo.atlasSlot = -1;
+		textureInfo.atlasRect = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
 
 		return true;
 	}
 
-	std::cout << "Could not load image:" << filename << std::endl;
+	std::cout << "Could not load image:" << image.filename << std::endl;
 
 	// Error loading the image
 	return false;
@@ -138,12 +642,55 @@ bool SceneManager::CreateGLTexture(const char* filename, std::string tag)
 /***********************************************************
  *  BindGLTextures()
  *
- *  This method is used for binding the loaded textures to
- *  OpenGL texture memory slots.  There are up to 16 slots.
+ *  This method is used for binding the loaded textures for
+ *  drawing.  Depending on what the shader and the driver
+ *  support, the textures are packed into texture arrays,
+ *  made resident as bindless handles, or bound to their own
+ *  OpenGL texture units.
  ***********************************************************/
 void SceneManager::BindGLTextures()
 {
-	for (int i = 0; i < m_loadedTextures; i++)
+	m_textureBackend = SelectTextureBackend();
+	m_currentTextureArray = -1;
+
+	if (m_textureBackend == TEXTURE_BACKEND_ARRAYS)
+	{
+		// bind every texture array on its own texture unit
+		for (size_t i = 0; i < m_textureArrays.size(); i++)
+		{
+			glActiveTexture(GL_TEXTURE0 + (GLenum)i);
+			glBindTexture(GL_TEXTURE_2D_ARRAY, m_textureArrays[i]);
+		}
+		return;
+	}
+
+	if (m_textureBackend == TEXTURE_BACKEND_BINDLESS)
+	{
+		// no texture units are needed when using bindless handles
+		return;
+	}
+
+	GLint maxTextureUnits = 0;
+	glGetIntegerv(GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS, &maxTextureUnits);
+
+	// textures packed into atlas pages are kept after the other
+	// slots and need no unit of their own
+	int textureCount = 0;
+	while ((textureCount < (int)m_textureIDs.size()) &&
+		(m_textureIDs[textureCount].atlasSlot < 0))
+	{
+		textureCount++;
+	}
+
+	// when there are more textures than units, the last unit is
+	// kept free for binding the remaining textures on demand
+	m_boundTextureUnits = textureCount;
+	if (m_boundTextureUnits > maxTextureUnits)
+	{
+		m_boundTextureUnits = maxTextureUnits - 1;
+	}
+
+	for (int i = 0; i < m_boundTextureUnits; i++)
 	{
 		// bind textures on corresponding texture units
 		glActiveTexture(GL_TEXTURE0 + i);
@@ -152,1314 +699,2229 @@ void SceneManager::BindGLTextures()
 }
 
 /***********************************************************
- *  DestroyGLTextures()
+ *  BuildTextureAtlas()
  *
- *  This method is used for freeing the memory in all the
- *  used texture memory slots.
+ *  This method is used for packing the small 8-bit textures
+ *  into shared atlas pages when the shader declares the
+ *  UVatlasRect uniform.  The packed textures are drawn from
+ *  their page with their own UV offset and scale, and are
+ *  moved after the other slots so that they need no texture
+ *  unit, array layer or bindless handle of their own.
  ***********************************************************/
-void SceneManager::DestroyGLTextures()
+bool SceneManager::BuildTextureAtlas()
 {
-	for (int i = 0; i < m_loadedTextures; ++i)
-		if (m_textureIDs[i].ID != 0)
-			glDeleteTextures(1, &m_textureIDs[i].ID);
-	m_loadedTextures = 0;
-}
+	GLint programID = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &programID);
 
-/***********************************************************
- *  FindTextureID()
- *
- *  This method is used for getting an ID for the previously
- *  loaded texture bitmap associated with the passed in tag.
- ***********************************************************/
-int SceneManager::FindTextureID(std::string tag)
-{
-	int textureID = -1;
-	int index = 0;
-	bool bFound = false;
+	if ((programID == 0) || (glGetUniformLocation(programID, g_AtlasRectName) < 0))
+	{
+		return(false);
+	}
+
+	std::vector<int> packedSlots;
+	std::vector<TextureAtlas::ATLAS_RECT> rects;
 
-	while ((index < m_loadedTextures) && (bFound == false))
+	for (int slot = 0; slot < (int)m_textureIDs.size(); slot++)
 	{
-		if (m_textureIDs[index].tag.compare(tag) == 0)
+		const TEXTURE_INFO& texture = m_textureIDs[slot];
+		if ((texture.width <= ATLAS_MAX_TEXTURE_SIZE) &&
+			(texture.height <= ATLAS_MAX_TEXTURE_SIZE) &&
+			(texture.internalFormat == g_InternalFormats8[texture.colorChannels - 1]))
 		{
-			textureID = m_textureIDs[index].ID;
-			bFound = true;
+			TextureAtlas::ATLAS_RECT rect;
+			rect.width = texture.width + 2 * ATLAS_PADDING;
+			rect.height = texture.height + 2 * ATLAS_PADDING;
+			packedSlots.push_back(slot);
+			rects.push_back(rect);
 		}
-		else
-			index++;
 	}
 
-	return(textureID);
+	// a page holding a single texture would not save anything
+	if (packedSlots.size() < 2)
+	{
+		return(false);
+	}
+
+	// the base level has to be in place before it is read back
+	m_textureStreamer.Flush();
+
+	TextureAtlas atlas(ATLAS_PAGE_SIZE);
+	int pageCount = atlas.Pack(rects);
+
+	std::vector<std::vector<unsigned char> > pages(
+		pageCount, std::vector<unsigned char>((size_t)ATLAS_PAGE_SIZE * ATLAS_PAGE_SIZE * 4, 0));
+	std::vector<unsigned char> pixels;
+
+	for (size_t i = 0; i < packedSlots.size(); i++)
+	{
+		const TEXTURE_INFO& texture = m_textureIDs[packedSlots[i]];
+
+		pixels.resize((size_t)texture.width * texture.height * 4);
+		glBindTexture(GL_TEXTURE_2D, texture.ID);
+		glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+
+		CopyToAtlasPage(
+			pixels.data(),
+			texture.width,
+			texture.height,
+			texture.colorChannels,
+			pages[rects[i].page].data(),
+			rects[i].x,
+			rects[i].y);
+	}
+
+	// the atlas pages take the place of the packed textures, which
+	// are moved after every other slot
+	std::vector<TEXTURE_INFO> textures;
+	std::vector<TEXTURE_INFO> packedTextures;
+	for (int slot = 0; slot < (int)m_textureIDs.size(); slot++)
+	{
+		if (std::find(packedSlots.begin(), packedSlots.end(), slot) == packedSlots.end())
+		{
+			textures.push_back(m_textureIDs[slot]);
+		}
+	}
+
+	// every packed texture fits on a page, as the largest one is
+	// much smaller than a page
+	int firstPageSlot = (int)textures.size();
+	for (int page = 0; page < pageCount; page++)
+	{
+		TEXTURE_INFO pageInfo;
+		GLuint pageID = 0;
+
+		glGenTextures(1, &pageID);
+		glBindTexture(GL_TEXTURE_2D, pageID);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		// coarser levels would blend the packed textures together
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, ATLAS_MAX_LEVEL);
+		glTexStorage2D(GL_TEXTURE_2D, ATLAS_MAX_LEVEL + 1, GL_RGBA8, ATLAS_PAGE_SIZE, ATLAS_PAGE_SIZE);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, ATLAS_PAGE_SIZE, ATLAS_PAGE_SIZE, GL_RGBA, GL_UNSIGNED_BYTE, pages[page].data());
+		glGenerateMipmap(GL_TEXTURE_2D);
+
+		pageInfo.tag = "atlas page " + std::to_string(page);
+		pageInfo.filename = "";
+		pageInfo.ID = pageID;
+		pageInfo.width = ATLAS_PAGE_SIZE;
+		pageInfo.height = ATLAS_PAGE_SIZE;
+		pageInfo.colorChannels = 4;
+		pageInfo.internalFormat = GL_RGBA8;
+		pageInfo.mipLevels = ATLAS_MAX_LEVEL + 1;
+		pageInfo.residentLevel = 0;
+		pageInfo.arrayIndex = -1;
+		pageInfo.layer = -1;
+		pageInfo.handle = 0;
+		pageInfo.atlasSlot = -1;
+		pageInfo.atlasRect = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+		textures.push_back(pageInfo);
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	for (size_t i = 0; i < packedSlots.size(); i++)
+	{
+		TEXTURE_INFO texture = m_textureIDs[packedSlots[i]];
+
+		glDeleteTextures(1, &texture.ID);
+		texture.ID = 0;
+		texture.atlasSlot = firstPageSlot + rects[i].page;
+		texture.atlasRect = glm::vec4(
+			(float)(rects[i].x + ATLAS_PADDING) / ATLAS_PAGE_SIZE,
+			(float)(rects[i].y + ATLAS_PADDING) / ATLAS_PAGE_SIZE,
+			(float)texture.width / ATLAS_PAGE_SIZE,
+			(float)texture.height / ATLAS_PAGE_SIZE);
+		packedTextures.push_back(texture);
+	}
+
+	m_textureIDs = textures;
+	m_textureIDs.insert(m_textureIDs.end(), packedTextures.begin(), packedTextures.end());
+
+	std::cout << "Packed " << packedTextures.size() << " textures into " << pageCount << " atlas pages" << std::endl;
+
+	return(true);
 }
 
 /***********************************************************
- *  FindTextureSlot()
+ *  SelectTextureBackend()
  *
- *  This method is used for getting a slot index for the previously
- *  loaded texture bitmap associated with the passed in tag.
+ *  This method is used for picking the texture backend.  The
+ *  bindless backend is used when the driver supports the
+ *  ARB_bindless_texture extension and the shader declares the
+ *  objectTextureHandles sampler array.  The texture array
+ *  backend is used when the shader declares the
+ *  objectTextureArray sampler.  Otherwise every texture is
+ *  bound to its own texture unit.
  ***********************************************************/
-int SceneManager::FindTextureSlot(std::string tag)
+SceneManager::TEXTURE_BACKEND SceneManager::SelectTextureBackend()
 {
-	int textureSlot = -1;
-	int index = 0;
-	bool bFound = false;
+	GLint programID = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &programID);
 
-	while ((index < m_loadedTextures) && (bFound == false))
+	if ((programID == 0) || (m_textureIDs.size() == 0))
 	{
-		if (m_textureIDs[index].tag.compare(tag) == 0)
-		{
-			textureSlot = index;
-			bFound = true;
-		}
-		else
-			index++;
+		return(TEXTURE_BACKEND_UNITS);
 	}
 
-	return(textureSlot);
+	if ((GLEW_ARB_bindless_texture) &&
+		(glGetUniformLocation(programID, g_TextureHandlesName) >= 0) &&
+		(MakeTexturesBindless() == true))
+	{
+		std::cout << "Using bindless textures for " << m_textureIDs.size() << " textures" << std::endl;
+		return(TEXTURE_BACKEND_BINDLESS);
+	}
+
+	if ((glGetUniformLocation(programID, g_TextureArrayName) >= 0) &&
+		(BuildTextureArrays() == true))
+	{
+		std::cout << "Using " << m_textureArrays.size() << " texture arrays for " << m_textureIDs.size() << " textures" << std::endl;
+		return(TEXTURE_BACKEND_ARRAYS);
+	}
+
+	return(TEXTURE_BACKEND_UNITS);
 }
 
 /***********************************************************
- *  FindMaterial()
+ *  BuildTextureArrays()
  *
- *  This method is used for getting a material from the previously
- *  defined materials list that is associated with the passed in tag.
+ *  This method is used for packing the loaded textures into
+ *  the layers of 2D texture arrays.  Textures with the same
+ *  size and format share one array, and their image data is
+ *  copied on the GPU including all of the mipmap levels.
  ***********************************************************/
-bool SceneManager::FindMaterial(std::string tag, OBJECT_MATERIAL& material)
+bool SceneManager::BuildTextureArrays()
 {
-	if (m_objectMaterials.size() == 0)
+	// every level has to be in place before it can be copied
+	m_textureStreamer.Flush();
+
+	GLint maxTextureUnits = 0;
+	GLint maxArrayLayers = 0;
+	std::vector<std::vector<int> > arraySlots;
+
+	glGetIntegerv(GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS, &maxTextureUnits);
+	glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxArrayLayers);
+
+	// group the textures by size and format
+	for (int slot = 0; slot < (int)m_textureIDs.size(); slot++)
+	{
+		const TEXTURE_INFO& texture = m_textureIDs[slot];
+		if (texture.atlasSlot >= 0)
+		{
+			continue;
+		}
+		size_t group = 0;
+		while ((group < arraySlots.size()) &&
+			((m_textureIDs[arraySlots[group][0]].width != texture.width) ||
+			(m_textureIDs[arraySlots[group][0]].height != texture.height) ||
+			(m_textureIDs[arraySlots[group][0]].internalFormat != texture.internalFormat) ||
+			((GLint)arraySlots[group].size() >= maxArrayLayers)))
+		{
+			group++;
+		}
+		if (group == arraySlots.size())
+		{
+			arraySlots.push_back(std::vector<int>());
+		}
+		arraySlots[group].push_back(slot);
+	}
+
+	// every array needs its own texture unit
+	if ((GLint)arraySlots.size() > maxTextureUnits)
 	{
 		return(false);
 	}
 
-	int index = 0;
-	bool bFound = false;
-	while ((index < m_objectMaterials.size()) && (bFound == false))
+	for (size_t group = 0; group < arraySlots.size(); group++)
 	{
-		if (m_objectMaterials[index].tag.compare(tag) == 0)
+		const TEXTURE_INFO& first = m_textureIDs[arraySlots[group][0]];
+		GLuint arrayID = 0;
+
+		glGenTextures(1, &arrayID);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, arrayID);
+		glTexStorage3D(
+			GL_TEXTURE_2D_ARRAY,
+			first.mipLevels,
+			first.internalFormat,
+			first.width,
+			first.height,
+			(GLsizei)arraySlots[group].size());
+
+		// set the same wrapping and filtering as the 2D textures
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		SetTextureSwizzle(GL_TEXTURE_2D_ARRAY, first.colorChannels);
+
+		for (size_t layer = 0; layer < arraySlots[group].size(); layer++)
 		{
-			bFound = true;
-			material.ambientColor = m_objectMaterials[index].ambientColor;
-			material.ambientStrength = m_objectMaterials[index].ambientStrength;
-			material.diffuseColor = m_objectMaterials[index].diffuseColor;
-			material.specularColor = m_objectMaterials[index].specularColor;
-			material.shininess = m_objectMaterials[index].shininess;
-		}
-		else
-		{
-			index++;
+			TEXTURE_INFO& texture = m_textureIDs[arraySlots[group][layer]];
+
+			for (int level = 0; level < texture.mipLevels; level++)
+			{
+				glCopyImageSubData(
+					texture.ID, GL_TEXTURE_2D, level, 0, 0, 0,
+					arrayID, GL_TEXTURE_2D_ARRAY, level, 0, 0, (GLint)layer,
+					std::max(texture.width >> level, 1),
+					std::max(texture.height >> level, 1),
+					1);
+			}
+
+			// the 2D texture is no longer needed once it is copied
+			glDeleteTextures(1, &texture.ID);
+			texture.ID = 0;
+			texture.arrayIndex = (int)group;
+			texture.layer = (int)layer;
 		}
+
+		m_textureArrays.push_back(arrayID);
 	}
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
 
 	return(true);
 }
 
 /***********************************************************
- *  SetTransformations()
+ *  MakeTexturesBindless()
  *
- *  This method is used for setting the transform buffer
- *  using the passed in transformation values.
+ *  This method is used for creating a resident bindless
+ *  handle for every loaded texture, and passing all of the
+ *  handles into the shader sampler array at once.
  ***********************************************************/
-void SceneManager::SetTransformations(
-	glm::vec3 scaleXYZ,
-	float XrotationDegrees,
-	float YrotationDegrees,
-	float ZrotationDegrees,
-	glm::vec3 positionXYZ)
+bool SceneManager::MakeTexturesBindless()
 {
-	// variables for this method
-	glm::mat4 modelView;
-	glm::mat4 scale;
-	glm::mat4 rotationX;
-	glm::mat4 rotationY;
-	glm::mat4 rotationZ;
-	glm::mat4 translation;
-
-	// set the scale value in the transform buffer
-	scale = glm::scale(scaleXYZ);
-	// set the rotation values in the transform buffer
-	rotationX = glm::rotate(glm::radians(XrotationDegrees), glm::vec3(1.0f, 0.0f, 0.0f));
-	rotationY = glm::rotate(glm::radians(YrotationDegrees), glm::vec3(0.0f, 1.0f, 0.0f));
-	rotationZ = glm::rotate(glm::radians(ZrotationDegrees), glm::vec3(0.0f, 0.0f, 1.0f));
-	// set the translation value in the transform buffer
-	translation = glm::translate(positionXYZ);
-
-	modelView = translation * rotationX * rotationY * rotationZ * scale;
+	// the base level of a texture cannot change once it has a
+	// handle, so the streaming has to finish first
+	m_textureStreamer.Flush();
 
-	if (NULL != m_pShaderManager)
+	GLint programID = 0;
+	std::vector<GLuint64> handles;
+
+	glGetIntegerv(GL_CURRENT_PROGRAM, &programID);
+
+	for (size_t slot = 0; slot < m_textureIDs.size(); slot++)
 	{
-		m_pShaderManager->setMat4Value(g_ModelName, modelView);
+		// the atlas pages are drawn in place of the packed textures,
+		// which are kept after the other slots
+		if (m_textureIDs[slot].atlasSlot >= 0)
+		{
+			break;
+		}
+
+		GLuint64 handle = glGetTextureHandleARB(m_textureIDs[slot].ID);
+		if (handle == 0)
+		{
+			// undo the handles made resident so far
+			for (size_t i = 0; i < slot; i++)
+			{
+				glMakeTextureHandleNonResidentARB(m_textureIDs[i].handle);
+				m_textureIDs[i].handle = 0;
+			}
+			return(false);
+		}
+
+		glMakeTextureHandleResidentARB(handle);
+		m_textureIDs[slot].handle = handle;
+		handles.push_back(handle);
 	}
+
+	glUniformHandleui64vARB(
+		glGetUniformLocation(programID, g_TextureHandlesName),
+		(GLsizei)handles.size(),
+		handles.data());
+
+	return(true);
 }
 
 /***********************************************************
- *  SetShaderColor()
+ *  DestroyGLTextures()
  *
- *  This method is used for setting the passed in color
- *  into the shader for the next draw command
+ *  This method is used for freeing the memory in all the
+ *  used texture memory slots.
  ***********************************************************/
-void SceneManager::SetShaderColor(
-	float redColorValue,
-	float greenColorValue,
-	float blueColorValue,
-	float alphaValue)
+void SceneManager::DestroyGLTextures()
 {
-	// variables for this method
-	glm::vec4 currentColor;
+	for (size_t i = 0; i < m_textureIDs.size(); ++i)
+	{
+		if (m_textureIDs[i].handle != 0)
+			glMakeTextureHandleNonResidentARB(m_textureIDs[i].handle);
+		if (m_textureIDs[i].ID != 0)
+			glDeleteTextures(1, &m_textureIDs[i].ID);
+	}
+	m_textureIDs.clear();
 
-	currentColor.r = redColorValue;
-	currentColor.g = greenColorValue;
-	currentColor.b = blueColorValue;
-	currentColor.a = alphaValue;
+	for (size_t i = 0; i < m_textureArrays.size(); ++i)
+		glDeleteTextures(1, &m_textureArrays[i]);
+	m_textureArrays.clear();
 
-	if (NULL != m_pShaderManager)
+	// reloads still decoding are dropped when they come back
+	m_reloadRequests.clear();
+	m_reloadSlots.clear();
+	if (m_fallbackTextureID != 0)
 	{
-		m_pShaderManager->setIntValue(g_UseTextureName, false);
-		m_pShaderManager->setVec4Value(g_ColorValueName, currentColor);
+		glDeleteTextures(1, &m_fallbackTextureID);
+		m_fallbackTextureID = 0;
 	}
 }
 
 /***********************************************************
- *  SetShaderTexture()
+ *  SetTextureBudget()
  *
- *  This method is used for setting the texture data
- *  associated with the passed in ID into the shader.
+ *  This method is used for setting the number of bytes of
+ *  video memory that the scene textures may use together.
  ***********************************************************/
-void SceneManager::SetShaderTexture(
-	std::string textureTag)
+void SceneManager::SetTextureBudget(size_t budgetBytes)
 {
-	if (NULL != m_pShaderManager)
-	{
-		m_pShaderManager->setIntValue(g_UseTextureName, true);
-
-		int textureID = -1;
-		textureID = FindTextureSlot(textureTag);
-		m_pShaderManager->setSampler2DValue(g_TextureValueName, textureID);
-	}
+	m_textureResidency.SetBudget(budgetBytes);
 }
 
 /***********************************************************
- *  SetTextureUVScale()
+ *  EnforceTextureBudget()
  *
- *  This method is used for setting the texture UV scale
- *  values into the shader.
+ *  This method is used for giving back the memory of the
+ *  least recently drawn textures while the textures use more
+ *  than the budget.  Cold textures are first reduced to their
+ *  small mip levels, and only evicted completely when that is
+ *  not enough.
  ***********************************************************/
-void SceneManager::SetTextureUVScale(float u, float v)
+void SceneManager::EnforceTextureBudget()
 {
-	if (NULL != m_pShaderManager)
+	// the other backends keep the textures in shared arrays or
+	// resident handles, and textures that are still streaming in
+	// cannot be replaced
+	if ((m_textureBackend != TEXTURE_BACKEND_UNITS) ||
+		(m_textureStreamer.IsIdle() == false))
 	{
-		m_pShaderManager->setVec2Value("UVscale", glm::vec2(u, v));
+		return;
 	}
-}
 
-/***********************************************************
- *  SetShaderMaterial()
- *
- *  This method is used for passing the material values
- *  into the shader.
- ***********************************************************/
-void SceneManager::SetShaderMaterial(
-	std::string materialTag)
-{
-	if (m_objectMaterials.size() > 0)
+	while (m_textureResidency.IsOverBudget() == true)
 	{
-		OBJECT_MATERIAL material;
-		bool bReturn = false;
+		int slot = m_textureResidency.FindColdest(true);
+		if (slot < 0)
+		{
+			break;
+		}
+		if (ReduceGLTexture(slot) == false)
+		{
+			EvictGLTexture(slot);
+		}
+	}
 
-		bReturn = FindMaterial(materialTag, material);
-		if (bReturn == true)
+	while (m_textureResidency.IsOverBudget() == true)
+	{
+		int slot = m_textureResidency.FindColdest(false);
+		if (slot < 0)
 		{
-			m_pShaderManager->setVec3Value("material.ambientColor", material.ambientColor);
-			m_pShaderManager->setFloatValue("material.ambientStrength", material.ambientStrength);
-			m_pShaderManager->setVec3Value("material.diffuseColor", material.diffuseColor);
-			m_pShaderManager->setVec3Value("material.specularColor", material.specularColor);
-			m_pShaderManager->setFloatValue("material.shininess", material.shininess);
+			break;
 		}
+		EvictGLTexture(slot);
 	}
 }
 
-/**************************************************************/
-/*** The code in the methods BELOW is for preparing and     ***/
-/*** rendering the 3D replicated scenes.                    ***/
-/**************************************************************/
-
-
 /***********************************************************
- *  LoadSceneTextures()
+ *  ReplaceGLTexture()
  *
- *  This method is used for preparing the 3D scene by loading
- *  the shapes, textures in memory to support the 3D scene
- *  rendering
+ *  This method is used for replacing the OpenGL texture in a
+ *  slot with a new texture made from decoded image data.  The
+ *  new texture is created on the unit that the slot is drawn
+ *  from, so the bindings of the other slots stay in place.
  ***********************************************************/
-void SceneManager::LoadSceneTextures()
+bool SceneManager::ReplaceGLTexture(int slot, TextureDecoder::DECODED_IMAGE& image, int firstLevel)
 {
+	TEXTURE_INFO replacement;
 
-	bool bReturn = false;
-
-
-	bReturn = CreateGLTexture(
-		"Debug/textures/woodesk.jpg", "desk");
-
-	bReturn = CreateGLTexture(
-		"Debug/textures/mugbody.jpg", "mugbody");
-
-	bReturn = CreateGLTexture(
-		"Debug/textures/mugholder.jpg", "mugholder");
-
-	bReturn = CreateGLTexture(
-		"Debug/textures/coffeetop1.jpg", "coffee");
+	glActiveTexture(GL_TEXTURE0 + std::min(slot, m_boundTextureUnits));
 
-	bReturn = CreateGLTexture(
-		"Debug/textures/keyboard.jpg", "keyboard");
-
-	bReturn = CreateGLTexture(
-		"Debug/textures/Screentexture.jpg", "screen");
-
-	bReturn = CreateGLTexture(
-		"Debug/textures/Macbook.jpg", "macbook");
-
-	bReturn = CreateGLTexture(
-		"Debug/textures/lamp.jpg", "lamp");
-
-	bReturn = CreateGLTexture(
-		"Debug/textures/wall.jpg", "wall");
-
-	bReturn = CreateGLTexture(
-		"Debug/textures/mouse.jpg", "mouse");
-
-	bReturn = CreateGLTexture(
-		"Debug/textures/mousepad.png", "mousepad");
+	if (LoadGLTextureLevels(image, firstLevel, replacement) == false)
+	{
+		return(false);
+	}
 
+	TEXTURE_INFO& texture = m_textureIDs[slot];
+	if (texture.ID != 0)
+	{
+		glDeleteTextures(1, &texture.ID);
+	}
+	texture.ID = replacement.ID;
+	texture.internalFormat = replacement.internalFormat;
+	texture.residentLevel = firstLevel;
 
+	if (slot < m_boundTextureUnits)
+	{
+		glBindTexture(GL_TEXTURE_2D, texture.ID);
+	}
 
+	m_textureResidency.Track(slot, GetTextureBytes(texture), firstLevel > 0);
 
-	// after the texture image data is loaded into memory, the
-	// loaded textures need to be bound to texture slots - there
-	// are a total of 16 available slots for scene textures
-	BindGLTextures();
+	return(true);
 }
 
 /***********************************************************
- *  DefineObjectMaterials()
+ *  ReduceGLTexture()
  *
- *  This method is used for configuring the various material
- *  settings for all of the objects within the 3D scene.
+ *  This method is used for replacing a texture with its
+ *  small mip levels from the decode cache or the baked
+ *  container.  Textures without a cached mip chain cannot be
+ *  reduced, and are found out before anything is decoded.
  ***********************************************************/
-void SceneManager::DefineObjectMaterials()
+bool SceneManager::ReduceGLTexture(int slot)
 {
+	const TEXTURE_INFO& texture = m_textureIDs[slot];
+	int reducedLevel = 0;
 
-	OBJECT_MATERIAL plasticMaterial;
-	plasticMaterial.ambientColor = glm::vec3(0.2f, 0.2f, 0.1f);
-	plasticMaterial.ambientStrength = 0.4f;
-	plasticMaterial.diffuseColor = glm::vec3(0.3f, 0.3f, 0.2f);
-	plasticMaterial.specularColor = glm::vec3(0.6f, 0.5f, 0.4f);
-	plasticMaterial.shininess = 12.0f;
-	plasticMaterial.tag = "plastic";
-
-	m_objectMaterials.push_back(plasticMaterial);
-
-	OBJECT_MATERIAL metalMaterial;
-	metalMaterial.ambientColor = glm::vec3(0.2f, 0.2f, 0.2f);
-	metalMaterial.ambientStrength = 0.3f;
-	metalMaterial.diffuseColor = glm::vec3(0.2f, 0.2f, 0.2f);
-	metalMaterial.specularColor = glm::vec3(0.5f, 0.5f, 0.5f);
-	metalMaterial.shininess = 17.0;
-	metalMaterial.tag = "metal";
-
-	m_objectMaterials.push_back(metalMaterial);
-
-	OBJECT_MATERIAL cementMaterial;
-	cementMaterial.ambientColor = glm::vec3(0.2f, 0.2f, 0.2f);
-	cementMaterial.ambientStrength = 0.06f;
-	cementMaterial.diffuseColor = glm::vec3(0.42f, 0.42f, 0.42f);
-	cementMaterial.specularColor = glm::vec3(0.8f, 0.6f, 0.3f);
-	cementMaterial.shininess = 8.0f;
-	cementMaterial.tag = "cement";
-
-
-	m_objectMaterials.push_back(cementMaterial);
+	// only 8-bit and block compressed textures have cached mip chains
+	if ((texture.internalFormat == g_InternalFormats16[texture.colorChannels - 1]) ||
+		(texture.internalFormat == g_InternalFormatsFloat[texture.colorChannels - 1]))
+	{
+		return(false);
+	}
 
-	OBJECT_MATERIAL woodMaterial;
-	woodMaterial.ambientColor = glm::vec3(0.05f, 0.05f, 0.05f);
-	woodMaterial.ambientStrength = 0.1f;
-	woodMaterial.diffuseColor = glm::vec3(0.1f, 0.1f, 0.1f);       
-	woodMaterial.specularColor = glm::vec3(0.8f, 0.6f, 0.3f);      
-	woodMaterial.shininess = 16.0f;                                
-	woodMaterial.tag = "wood";
+	while ((std::max(texture.width, texture.height) >> reducedLevel) > REDUCED_TEXTURE_SIZE)
+	{
+		reducedLevel++;
+	}
+	if (reducedLevel == 0)
+	{
+		return(false);
+	}
 
+	TextureDecoder::TEXTURE_REQUEST request;
+	TextureDecoder::DECODED_IMAGE image;
+	request.filename = texture.filename;
+	request.tag = texture.tag;
+	request.bHighPrecision = true;
 
-	m_objectMaterials.push_back(woodMaterial);
+	// decoding the whole image file would cost more than evicting
+	if (TextureDecoder::MapCachedFile(request, image) == false)
+	{
+		TextureDecoder::FreeImage(image);
+		return(false);
+	}
+	bool bReduced = ReplaceGLTexture(slot, image, reducedLevel);
+	TextureDecoder::FreeImage(image);
 
+	return(bReduced);
+}
 
-	OBJECT_MATERIAL glassMaterial;
-	glassMaterial.ambientColor = glm::vec3(0.2f, 0.3f, 0.4f);
-	glassMaterial.ambientStrength = 0.3f;
-	glassMaterial.diffuseColor = glm::vec3(0.3f, 0.2f, 0.1f);
-	glassMaterial.specularColor = glm::vec3(0.4f, 0.5f, 0.6f);
-	glassMaterial.shininess = 35.0f;
-	glassMaterial.tag = "glass";
+/***********************************************************
+ *  EvictGLTexture()
+ *
+ *  This method is used for deleting a texture until it is
+ *  drawn again.  The unit of the slot draws the fallback
+ *  texture until then.
+ ***********************************************************/
+void SceneManager::EvictGLTexture(int slot)
+{
+	TEXTURE_INFO& texture = m_textureIDs[slot];
 
-	m_objectMaterials.push_back(glassMaterial);
+	if (texture.ID != 0)
+	{
+		glDeleteTextures(1, &texture.ID);
+		texture.ID = 0;
+	}
+	texture.residentLevel = -1;
 
-	OBJECT_MATERIAL clayMaterial;
-	clayMaterial.ambientColor = glm::vec3(0.2f, 0.2f, 0.3f);
-	clayMaterial.ambientStrength = 0.3f;
-	clayMaterial.diffuseColor = glm::vec3(0.4f, 0.4f, 0.5f);
-	clayMaterial.specularColor = glm::vec3(0.2f, 0.2f, 0.4f);
-	clayMaterial.shininess = 0.5f;
-	clayMaterial.tag = "clay";
+	if (slot < m_boundTextureUnits)
+	{
+		glActiveTexture(GL_TEXTURE0 + slot);
+		BindFallbackTexture();
+	}
 
-	m_objectMaterials.push_back(clayMaterial);
+	m_textureResidency.Track(slot, 0, false);
+}
 
-	OBJECT_MATERIAL MousepadMaterial;
-	MousepadMaterial.ambientColor = glm::vec3(0.1f, 0.1f, 0.1f);
-	MousepadMaterial.ambientStrength = 0.3f;
-	MousepadMaterial.diffuseColor = glm::vec3(0.4f, 0.4f, 0.5f);
-	MousepadMaterial.specularColor = glm::vec3(0.2f, 0.2f, 0.4f);
-	MousepadMaterial.shininess = 2.0f;
-	MousepadMaterial.tag = "Mousepad";
+/***********************************************************
+ *  QueueTextureReload()
+ *
+ *  This method is used for queueing a reduced or evicted
+ *  texture to be loaded again in full.  The file is decoded
+ *  on the worker threads of the reload decoder, so drawing
+ *  never waits on the disk.
+ ***********************************************************/
+void SceneManager::QueueTextureReload(int slot)
+{
+	if (std::find(m_reloadSlots.begin(), m_reloadSlots.end(), slot) != m_reloadSlots.end())
+	{
+		return;
+	}
 
-	m_objectMaterials.push_back(MousepadMaterial);
+	TextureDecoder::TEXTURE_REQUEST request;
+	request.filename = m_textureIDs[slot].filename;
+	request.tag = m_textureIDs[slot].tag;
+	request.bHighPrecision = true;
 
+	m_reloadRequests.push_back(request);
+	m_reloadSlots.push_back(slot);
 }
 
-
-void SceneManager::SetupSceneLights()
+/***********************************************************
+ *  UpdateTextureReloads()
+ *
+ *  This method is used for replacing the reduced and evicted
+ *  textures whose reload finished decoding, from the baked
+ *  container or the decode cache when they have it.  With
+ *  texture streaming on, the textures sharpen over the next
+ *  frames.  The reloads queued since the last batch are
+ *  started once the decoder has handed back every image.
+ ***********************************************************/
+void SceneManager::UpdateTextureReloads()
 {
+	TextureDecoder::DECODED_IMAGE image;
 
-	/****************************************************************/
-	/*** Light 0 – LEFT WARM WASH ***/
-	m_pShaderManager->setVec3Value("lightSources[0].position", -6.8f, 1.10f, -4.25f);
-	m_pShaderManager->setVec3Value("lightSources[0].diffuseColor", 1.0f, 0.20f, 0.0f);
-	m_pShaderManager->setVec3Value("lightSources[0].specularColor", 1.0f, 0.5f, 0.0f);
-	m_pShaderManager->setVec3Value("lightSources[0].ambientColor", 0.15f, 0.05f, 0.0f);
-	m_pShaderManager->setFloatValue("lightSources[0].focalStrength", 10.0f);        
-	m_pShaderManager->setFloatValue("lightSources[0].specularIntensity", 0.12f);        
-	/****************************************************************/
-
-	/*** Light 1 – TOP WHITE HALO ***/
-	m_pShaderManager->setVec3Value("lightSources[1].position", 0.0f, 10.2f, -4.8f);
-	m_pShaderManager->setVec3Value("lightSources[1].ambientColor", 0.10f, 0.12f, 0.16f);
-	m_pShaderManager->setVec3Value("lightSources[1].diffuseColor", 0.70f, 0.74f, 0.82f);
-	m_pShaderManager->setVec3Value("lightSources[1].specularColor", 1.0f, 1.0f, 1.0f);
-	m_pShaderManager->setFloatValue("lightSources[1].focalStrength", 30.0f);
-	m_pShaderManager->setFloatValue("lightSources[1].specularIntensity", 0.65f);
-	/****************************************************************/
-
-	/*** Light 2 – RIGHT/BACK WHITE FILL  ***/
-	m_pShaderManager->setVec3Value("lightSources[2].position", 16.5f, 3.5f, 3.5f);		   
-	m_pShaderManager->setVec3Value("lightSources[2].ambientColor", 0.20f, 0.21f, 0.23f);   
-	m_pShaderManager->setVec3Value("lightSources[2].diffuseColor", 0.58f, 0.62f, 0.68f);  
-	m_pShaderManager->setVec3Value("lightSources[2].specularColor", 0.62f, 0.66f, 0.72f);  
-	m_pShaderManager->setFloatValue("lightSources[2].focalStrength", 110.0f);              
-	m_pShaderManager->setFloatValue("lightSources[2].specularIntensity", 0.82f);          
-	/****************************************************************/
-	
-	/*** Light 3 – UNDER-DESK STRIP ***/
-	m_pShaderManager->setVec3Value("lightSources[3].position", 0.0f, -0.32f, -6.20f);
-	m_pShaderManager->setVec3Value("lightSources[3].ambientColor", 0.01f, 0.001f, 0.001f); 
-	m_pShaderManager->setVec3Value("lightSources[3].diffuseColor", 0.80f, 0.28f, 0.02f);  
-	m_pShaderManager->setVec3Value("lightSources[3].specularColor", 0.80f, 0.28f, 0.02f);
-	m_pShaderManager->setFloatValue("lightSources[3].focalStrength", 8.0f);       
-	m_pShaderManager->setFloatValue("lightSources[3].specularIntensity", 0.05f); 
+	while (m_reloadDecoder.PollNext(image) == true)
+	{
+		int slot = FindTextureSlot(image.tag);
+		std::vector<int>::iterator queued = std::find(m_reloadSlots.begin(), m_reloadSlots.end(), slot);
 
+		// a failed reload is queued again the next time it is drawn
+		if (queued != m_reloadSlots.end())
+		{
+			m_reloadSlots.erase(queued);
+			ReplaceGLTexture(slot, image, 0);
+		}
+		TextureDecoder::FreeImage(image);
+	}
 
-	// enable the use of lighting in the shader
-	m_pShaderManager->setBoolValue("bUseLighting", true);
+	if ((m_reloadDecoder.IsFinished() == true) && (m_reloadRequests.empty() == false))
+	{
+		m_reloadDecoder.Start(m_reloadRequests);
+		m_reloadRequests.clear();
+	}
+}
 
+/***********************************************************
+ *  BindFallbackTexture()
+ *
+ *  This method is used for binding the fallback texture to
+ *  the active texture unit.  The fallback is a single gray
+ *  pixel, made the first time that it is needed.
+ ***********************************************************/
+void SceneManager::BindFallbackTexture()
+{
+	if (m_fallbackTextureID == 0)
+	{
+		const unsigned char gray[4] = { 128, 128, 128, 255 };
 
+		glGenTextures(1, &m_fallbackTextureID);
+		glBindTexture(GL_TEXTURE_2D, m_fallbackTextureID);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, gray);
+	}
 
+	glBindTexture(GL_TEXTURE_2D, m_fallbackTextureID);
 }
 
 /***********************************************************
- *  PrepareScene()
+ *  InternTextureTags()
  *
- *  This method is used for preparing the 3D scene by loading
- *  the shapes, textures in memory to support the 3D scene
- *  rendering
+ *  This method is used for mapping the hash of every loaded
+ *  texture tag to its slot, once the slots are final, so the
+ *  textures can be found by tag without comparing strings.
  ***********************************************************/
+void SceneManager::InternTextureTags()
+{
+	m_textureSlots.clear();
 
+	for (int slot = 0; slot < (int)m_textureIDs.size(); slot++)
+	{
+		uint64_t tagHash = HashTag(m_textureIDs[slot].tag);
+		if (m_textureSlots.insert(std::make_pair(tagHash, slot)).second == false)
+		{
+			std::cout << "Texture tag " << m_textureIDs[slot].tag << " is already in use" << std::endl;
+		}
+	}
+}
 
-void SceneManager::PrepareScene()
+/***********************************************************
+ *  InternMaterialTags()
+ *
+ *  This method is used for mapping the hash of every defined
+ *  material tag to its index in the materials list.
+ ***********************************************************/
+void SceneManager::InternMaterialTags()
 {
-	// load the textures for the 3D scene
-	LoadSceneTextures();
+	m_materialIndices.clear();
 
-	//define the object materials that will be used in the scene
-	DefineObjectMaterials();
+	for (int index = 0; index < (int)m_objectMaterials.size(); index++)
+	{
+		uint64_t tagHash = HashTag(m_objectMaterials[index].tag);
+		if (m_materialIndices.insert(std::make_pair(tagHash, index)).second == false)
+		{
+			std::cout << "Material tag " << m_objectMaterials[index].tag << " is already in use" << std::endl;
+		}
+	}
+}
 
-	//Setting up scene lighting
-	SetupSceneLights();
+/***********************************************************
+ *  FindTextureID()
+ *
+ *  This method is used for getting an ID for the previously
+ *  loaded texture bitmap associated with the passed in tag.
+ ***********************************************************/
+int SceneManager::FindTextureID(const std::string& tag)
+{
+	int textureSlot = FindTextureSlot(tag);
 
-	// only one instance of a particular mesh needs to be
-	// loaded in memory no matter how many times it is drawn
-	// in the rendered 3D scene
+	if (textureSlot < 0)
+	{
+		return(-1);
+	}
 
-	m_basicMeshes->LoadBoxMesh();
-	m_basicMeshes->LoadPlaneMesh();
-	m_basicMeshes->LoadCylinderMesh();
-	m_basicMeshes->LoadConeMesh();
-	m_basicMeshes->LoadPrismMesh();
-	m_basicMeshes->LoadPyramid4Mesh();
-	m_basicMeshes->LoadSphereMesh();
-	m_basicMeshes->LoadTaperedCylinderMesh();
-	m_basicMeshes->LoadTorusMesh();
+	return(m_textureIDs[textureSlot].ID);
 }
 
-
-
 /***********************************************************
- *  RenderScene()
+ *  FindTextureSlot()
  *
- *  This method is used for rendering the 3D scene by
- *  transforming and drawing the basic 3D shapes
+ *  This method is used for getting a slot index for the previously
+ *  loaded texture bitmap associated with the passed in tag.
  ***********************************************************/
-
-
-void SceneManager::RenderScene()
+int SceneManager::FindTextureSlot(const std::string& tag)
 {
-	RenderTable();
-	RenderLamp();
-	RenderBackdrop();
-	RenderLaptop();
-	RenderMonitor();
-	RenderKeyboard();
-	RenderMouse();
-	RenderMug();
-	RenderMousepad();
+	return(FindTextureSlot(HashTag(tag)));
 }
 
-/****************************************************************
-	*  RenderTable()
-	*
-	*  This method is called to render the shapes for the scene
-	*  Table object.
-	****************************************************************/
-void SceneManager::RenderTable()
+int SceneManager::FindTextureSlot(uint64_t tagHash)
 {
+	std::unordered_map<uint64_t, int>::const_iterator it = m_textureSlots.find(tagHash);
 
-	// declare the variables for the transformations
-	glm::vec3 scaleXYZ;
-	float XrotationDegrees = 0.0f;
-	float YrotationDegrees = 0.0f;
-	float ZrotationDegrees = 0.0f;
-	glm::vec3 positionXYZ;
-
-	// set the scale for the mesh
-	scaleXYZ = glm::vec3(20.0f, 0.3f, 9.4f);
+	if (it == m_textureSlots.end())
+	{
+		return(-1);
+	}
 
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
+	return(it->second);
+}
 
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(0.0f, 0.0f, -0.30f);
+/***********************************************************
+ *  FindMaterialIndex()
+ *
+ *  This method is used for getting the index of a previously
+ *  defined material associated with the passed in tag.
+ ***********************************************************/
+int SceneManager::FindMaterialIndex(uint64_t tagHash)
+{
+	std::unordered_map<uint64_t, int>::const_iterator it = m_materialIndices.find(tagHash);
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	if (it == m_materialIndices.end())
+	{
+		return(-1);
+	}
 
-	//Use the desk texture
-	SetShaderTexture("desk");
+	return(it->second);
+}
 
-	//Scale the texture to fit the desk
-	SetTextureUVScale(1, 1);
+/***********************************************************
+ *  FindMaterial()
+ *
+ *  This method is used for getting a material from the previously
+ *  defined materials list that is associated with the passed in tag.
+ ***********************************************************/
+bool SceneManager::FindMaterial(const std::string& tag, OBJECT_MATERIAL& material)
+{
+	int index = FindMaterialIndex(HashTag(tag));
 
-	// Use the wood material
-	SetShaderMaterial("wood");
+	if (index < 0)
+	{
+		return(false);
+	}
 
-	// draw the mesh
-	m_basicMeshes->DrawBoxMesh();
+	material = m_objectMaterials[index];
 
+	return(true);
 }
 
-/****************************************************************
-*  RenderBackdrop()
-*
-*  This method is called to render the shapes for the scene
-*  backdrop object.
-****************************************************************/
-void SceneManager::RenderBackdrop()
+/***********************************************************
+ *  FindMeshShape()
+ *
+ *  This method is used for finding the basic mesh that a
+ *  scene file names by the hash of the name.
+ ***********************************************************/
+bool SceneManager::FindMeshShape(uint64_t meshTag, MESH_SHAPE& shape)
 {
-	// declare the variables for the transformations
-	glm::vec3 scaleXYZ;
-	float XrotationDegrees = 0.0f;
-	float YrotationDegrees = 0.0f;
-	float ZrotationDegrees = 0.0f;
-	glm::vec3 positionXYZ;
-
-	// set the scale for the mesh
-	scaleXYZ = glm::vec3(13.0f, 0.3f, 8.0f);
-
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 90.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
-
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(0.0f, 3.0f, -5.5f);
-
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
-
-	// Use the wall texture
-	SetShaderTexture("wall");
-
-	// Use the cement material
-	SetShaderMaterial("cement");
-
-	// Set the UV scale for the texture mapping
-	SetTextureUVScale(2, 1);
-
-	// draw the mesh
-	m_basicMeshes->DrawPlaneMesh();
+	for (int i = 0; i < g_MeshNameCount; i++)
+	{
+		if (g_MeshNames[i].tag == meshTag)
+		{
+			shape = g_MeshNames[i].shape;
+			return(true);
+		}
+	}
+
+	return(false);
 }
 
-/****************************************************************
-*  RenderLamp()
-*
-*  This method is called to render the shapes for the scene
-*  Lamp object.
-/****************************************************************/
-void SceneManager::RenderLamp()
+/***********************************************************
+ *  GetTextureBinding()
+ *
+ *  This method is used for getting the texture object that
+ *  drawing a texture slot binds.  Textures packed into an
+ *  atlas page bind the page, and with the texture array
+ *  backend every texture of an array binds the array.
+ ***********************************************************/
+int SceneManager::GetTextureBinding(int textureSlot)
 {
-	// declare the variables for the transformations
-	glm::vec3 scaleXYZ;
-	float XrotationDegrees = 0.0f;
-	float YrotationDegrees = 0.0f;
-	float ZrotationDegrees = 0.0f;
-	glm::vec3 positionXYZ;
-
-	//Sphere - Lamp Body *******/
-
-	// Declare scale for the mesh
-	scaleXYZ = glm::vec3(1.8f, 0.7f, 1.8f);
-
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
-
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(-7.0f, 0.9f, -3.0f);
-
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	if (textureSlot < 0)
+	{
+		return(-1);
+	}
 
+	if (m_textureIDs[textureSlot].atlasSlot >= 0)
+	{
+		textureSlot = m_textureIDs[textureSlot].atlasSlot;
+	}
+	if (m_textureBackend == TEXTURE_BACKEND_ARRAYS)
+	{
+		return(m_textureIDs[textureSlot].arrayIndex);
+	}
 
-	// Set the shader texture for the lamp body
-	SetShaderTexture("lamp");
+	return(textureSlot);
+}
 
-	// Set the texture UV scale for the lamp body
-	SetTextureUVScale(1.0, 1.0); // Scale the texture to fit the sphere
+/***********************************************************
+ *  SetShaderColor()
+ *
+ *  This method is used for setting the passed in color
+ *  into the shader for the next draw command
+ ***********************************************************/
+void SceneManager::SetShaderColor(
+	float redColorValue,
+	float greenColorValue,
+	float blueColorValue,
+	float alphaValue)
+{
+	// variables for this method
+	glm::vec4 currentColor;
 
-	// Set the shader material for the lamp body
-	SetShaderMaterial("glass");
+	currentColor.r = redColorValue;
+	currentColor.g = greenColorValue;
+	currentColor.b = blueColorValue;
+	currentColor.a = alphaValue;
 
-	// draw the mesh
-	m_basicMeshes->DrawSphereMesh();
+	if (NULL != m_pShaderManager)
+	{
+		m_uniforms.setIntValue(g_UseTextureName, false);
+		m_uniforms.setVec4Value(g_ColorValueName, currentColor);
+	}
+}
 
+/***********************************************************
+ *  SetShaderTexture()
+ *
+ *  This method is used for setting the texture data in the
+ *  passed in slot into the shader.  With the texture array
+ *  and bindless backends only the layer or handle index
+ *  changes from draw to draw.
+ ***********************************************************/
+void SceneManager::SetShaderTexture(
+	int textureSlot)
+{
+	if (NULL != m_pShaderManager)
+	{
+		m_uniforms.setIntValue(g_UseTextureName, true);
 
-	/****************************************************************/
+		int textureID = textureSlot;
+		UseTexture(textureID);
 
-	// Cylinder - Lamp Pole *******/
+		// a texture packed into an atlas is drawn from its page
+		glm::vec4 atlasRect = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+		if ((textureID >= 0) && (m_textureIDs[textureID].atlasSlot >= 0))
+		{
+			atlasRect = m_textureIDs[textureID].atlasRect;
+			textureID = m_textureIDs[textureID].atlasSlot;
+		}
+		if (m_bUseTextureAtlas == true)
+		{
+			m_uniforms.setVec4Value(g_AtlasRectName, atlasRect);
+		}
 
-	// Declare scale for the mesh
-	scaleXYZ = glm::vec3(1.4f, 0.9f, 1.4f);
+		if ((m_textureBackend == TEXTURE_BACKEND_ARRAYS) && (textureID >= 0))
+		{
+			const TEXTURE_INFO& texture = m_textureIDs[textureID];
+
+			// the array sampler only changes when switching arrays
+			if (texture.arrayIndex != m_currentTextureArray)
+			{
+				m_uniforms.setSampler2DValue(g_TextureArrayName, texture.arrayIndex);
+				m_currentTextureArray = texture.arrayIndex;
+			}
+			m_uniforms.setIntValue(g_TextureLayerName, texture.layer);
+		}
+		else if ((m_textureBackend == TEXTURE_BACKEND_BINDLESS) && (textureID >= 0))
+		{
+			m_uniforms.setIntValue(g_TextureIndexName, textureID);
+		}
+		else
+		{
+			// textures past the permanently bound units share the
+			// last unit and are bound when they are used
+			if (textureID >= m_boundTextureUnits)
+			{
+				glActiveTexture(GL_TEXTURE0 + m_boundTextureUnits);
+				if (m_textureIDs[textureID].ID != 0)
+				{
+					glBindTexture(GL_TEXTURE_2D, m_textureIDs[textureID].ID);
+				}
+				else
+				{
+					BindFallbackTexture();
+				}
+				textureID = m_boundTextureUnits;
+			}
+			m_uniforms.setSampler2DValue(g_TextureValueName, textureID);
+		}
+	}
+}
 
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
+/***********************************************************
+ *  UseTexture()
+ *
+ *  This method is used for marking the texture in the passed
+ *  in slot as drawn in this frame.  A texture given back for
+ *  the texture budget is queued to be loaded again in full
+ *  as soon as it is drawn, and is drawn reduced or with the
+ *  fallback texture until the reload is uploaded.
+ ***********************************************************/
+void SceneManager::UseTexture(int textureSlot)
+{
+	if (textureSlot < 0)
+	{
+		return;
+	}
 
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(-7.0f, 0.0f, -3.0f); // Base on ground
+	if ((m_textureIDs[textureSlot].residentLevel != 0) &&
+		(m_textureIDs[textureSlot].filename.empty() == false))
+	{
+		QueueTextureReload(textureSlot);
+	}
+	m_textureResidency.Touch(textureSlot);
+}
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+/***********************************************************
+ *  SetTextureUVScale()
+ *
+ *  This method is used for setting the texture UV scale
+ *  values into the shader.  The atlas rectangle of a packed
+ *  texture is applied after the scale in the shader, so the
+ *  same scale values work for packed textures.
+ ***********************************************************/
+void SceneManager::SetTextureUVScale(float u, float v)
+{
+	if (NULL != m_pShaderManager)
+	{
+		m_uniforms.setVec2Value("UVscale", glm::vec2(u, v));
+	}
+}
 
-	// Set the shader color for the lamp pole
-	SetShaderColor(0.3f, 0.2f, 0.0f, 1.0f);
+/***********************************************************
+ *  SetShaderMaterial()
+ *
+ *  This method is used for passing the values of the
+ *  material at the passed in index into the shader.  With
+ *  the material uniform buffer, only the index is passed,
+ *  and an index of -1 is passed on for draws without a
+ *  material, the same as in the instances.
+ ***********************************************************/
+void SceneManager::SetShaderMaterial(
+	int materialIndex)
+{
+	if (m_materialBuffer != 0)
+	{
+		// the material values are already in the uniform buffer
+		m_uniforms.setIntValue(g_MaterialIndexName, materialIndex);
+	}
+	else if ((materialIndex >= 0) && (materialIndex < (int)m_objectMaterials.size()))
+	{
+		const OBJECT_MATERIAL& material = m_objectMaterials[materialIndex];
 
-	// Set the shader material for the lamp body
-	SetShaderMaterial("plastic");
+		m_uniforms.setVec3Value("material.ambientColor", material.ambientColor);
+		m_uniforms.setFloatValue("material.ambientStrength", material.ambientStrength);
+		m_uniforms.setVec3Value("material.diffuseColor", material.diffuseColor);
+		m_uniforms.setVec3Value("material.specularColor", material.specularColor);
+		m_uniforms.setFloatValue("material.shininess", material.shininess);
+	}
+}
 
-	// draw the mesh
-	m_basicMeshes->DrawCylinderMesh();
-	/****************************************************************/
+/**************************************************************/
+/*** The code in the methods BELOW is for preparing and     ***/
+/*** rendering the 3D replicated scenes.                    ***/
+/**************************************************************/
 
-	/*** Lamp Switch - Box ***/
 
-	// Declare scale for the mesh
-	scaleXYZ = glm::vec3(0.35f, 0.15f, 0.25f);
+/***********************************************************
+ *  LoadSceneTextures()
+ *
+ *  This method is used for preparing the 3D scene by loading
+ *  the shapes, textures in memory to support the 3D scene
+ *  rendering
+ ***********************************************************/
+void SceneManager::LoadSceneTextures(const SceneFile& scene)
+{
+	const std::vector<SceneFile::SCENE_TEXTURE>& textures = scene.GetTextures();
+	std::vector<TextureDecoder::TEXTURE_REQUEST> requests;
 
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 25.0f;
-	ZrotationDegrees = 0.0f;
+	for (size_t i = 0; i < textures.size(); i++)
+	{
+		TextureDecoder::TEXTURE_REQUEST request;
+		request.filename = textures[i].filename;
+		request.tag = textures[i].tag;
+		request.bHighPrecision = true;
+		requests.push_back(request);
+	}
 
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(-6.5f, 0.3f, -1.8f);
+	// decode all of the image files at the same time on worker
+	// threads and upload each one as soon as it is decoded
+	CreateGLTextures(requests);
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	// share atlas pages between the small textures when the
+	// shader supports it
+	m_bUseTextureAtlas = BuildTextureAtlas();
 
-	// Set the shader color for the lamp switch
-	SetShaderColor(0.8f, 0.8f, 0.8f, 1.0f);
+	// after the texture image data is loaded into memory, the
+	// loaded textures need to be bound for drawing
+	BindGLTextures();
 
-	// Set the shader material for the lamp body
-	SetShaderMaterial("plastic");
+	// the texture slots are final now, so the tags can be interned
+	InternTextureTags();
 
-	// draw the mesh
-	m_basicMeshes->DrawBoxMesh();
+	// the textures bound to their own units are the ones that can
+	// be reduced or evicted for the texture budget
+	if (m_textureBackend == TEXTURE_BACKEND_UNITS)
+	{
+		for (int slot = 0; slot < (int)m_textureIDs.size(); slot++)
+		{
+			if ((m_textureIDs[slot].ID != 0) && (m_textureIDs[slot].filename.empty() == false))
+			{
+				m_textureResidency.Track(slot, GetTextureBytes(m_textureIDs[slot]), false);
+			}
+		}
+	}
 }
 
-/****************************************************************
-*  RenderMug()
-*
-*  This method is called to render the shapes for the scene
-*  Mug object.
-****************************************************************/
-void SceneManager::RenderMug()
+/***********************************************************
+ *  DefineObjectMaterials()
+ *
+ *  This method is used for configuring the various material
+ *  settings for all of the objects within the 3D scene.
+ ***********************************************************/
+void SceneManager::DefineObjectMaterials(const SceneFile& scene)
 {
-	// declare the variables for the transformations
-	glm::vec3 scaleXYZ;
-	float XrotationDegrees = 0.0f;
-	float YrotationDegrees = 0.0f;
-	float ZrotationDegrees = 0.0f;
-	glm::vec3 positionXYZ;
+	const std::vector<SceneFile::SCENE_MATERIAL>& materials = scene.GetMaterials();
 
+	for (size_t i = 0; i < materials.size(); i++)
+	{
+		OBJECT_MATERIAL material;
+		material.ambientColor = materials[i].ambientColor;
+		material.ambientStrength = materials[i].ambientStrength;
+		material.diffuseColor = materials[i].diffuseColor;
+		material.specularColor = materials[i].specularColor;
+		material.shininess = materials[i].shininess;
+		material.tag = materials[i].tag;
+
+		m_objectMaterials.push_back(material);
+	}
 
-	// Declare scale for the mesh
-	scaleXYZ = glm::vec3(0.5f, 1.5f, 0.5f); // Tall cylinder for body
+	InternMaterialTags();
 
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
+	// upload every material at once when the shader reads them
+	// from a uniform buffer
+	UploadMaterialBuffer();
+}
 
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(6.0f, 0.1f, 3.0f);
+/***********************************************************
+ *  UploadMaterialBuffer()
+ *
+ *  This method is used for uploading all of the defined
+ *  materials into a std140 uniform buffer, when the shader
+ *  declares the MaterialBlock uniform block.  Each draw then
+ *  only passes the index of its material.
+ ***********************************************************/
+bool SceneManager::UploadMaterialBuffer()
+{
+	GLint programID = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &programID);
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	if ((programID == 0) || (m_objectMaterials.size() == 0))
+	{
+		return(false);
+	}
 
-	// Set the shader color or texture for the mug body
-	SetShaderTexture("mugbody"); // Body texture
+	GLuint blockIndex = glGetUniformBlockIndex(programID, g_MaterialBlockName);
+	if (blockIndex == GL_INVALID_INDEX)
+	{
+		return(false);
+	}
 
+	// the shader decides how many materials the block can hold
+	GLint blockSize = 0;
+	glGetActiveUniformBlockiv(programID, blockIndex, GL_UNIFORM_BLOCK_DATA_SIZE, &blockSize);
+	size_t materialCount = std::min(m_objectMaterials.size(), (size_t)blockSize / sizeof(MATERIAL_BLOCK_ENTRY));
+	if (materialCount < m_objectMaterials.size())
+	{
+		std::cout << "The material block holds " << materialCount << " of " << m_objectMaterials.size() << " materials" << std::endl;
+		return(false);
+	}
 
-	// Set the shader material for the mug body
-	SetShaderMaterial("clay");
+	// the buffer is as large as the block, which may end part way
+	// into an entry
+	std::vector<MATERIAL_BLOCK_ENTRY> entries((blockSize + sizeof(MATERIAL_BLOCK_ENTRY) - 1) / sizeof(MATERIAL_BLOCK_ENTRY));
+	for (size_t i = 0; i < m_objectMaterials.size(); i++)
+	{
+		const OBJECT_MATERIAL& material = m_objectMaterials[i];
+		entries[i].ambient = glm::vec4(material.ambientColor, material.ambientStrength);
+		entries[i].diffuse = glm::vec4(material.diffuseColor, 0.0f);
+		entries[i].specular = glm::vec4(material.specularColor, material.shininess);
+	}
 
-	// Set the texture UV scale to fit the cylinder
-	SetTextureUVScale(1.0, 5.0);
+	if (m_materialBuffer == 0)
+	{
+		glGenBuffers(1, &m_materialBuffer);
+	}
+	glBindBuffer(GL_UNIFORM_BUFFER, m_materialBuffer);
+	glBufferData(GL_UNIFORM_BUFFER, (GLsizeiptr)blockSize, entries.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
 
-	//This draws the mug body cylinder side 
-	m_basicMeshes->DrawCylinderMesh(false, false, true);
+	glUniformBlockBinding(programID, blockIndex, MATERIAL_BLOCK_BINDING);
+	glBindBufferBase(GL_UNIFORM_BUFFER, MATERIAL_BLOCK_BINDING, m_materialBuffer);
 
-	//This draws the mug body cylinder top 
-	// set the texture for the top of the mug
+	std::cout << "Using a uniform buffer for " << m_objectMaterials.size() << " materials" << std::endl;
 
-	SetShaderTexture("coffee");
+	return(true);
+}
 
-	// Set the texture UV scale for the top
-	SetTextureUVScale(0.7, 0.7);
+/***********************************************************
+ *  SelectDrawSubmission()
+ *
+ *  This method is used for loading the basic meshes into
+ *  shared buffers and picking the way of sending the draws.
+ *  Instanced and indirect draws are only used when the
+ *  shader declares the InstanceBlock storage block, and when
+ *  the materials are in the uniform buffer, since the
+ *  instances only hold the index of their material.  The
+ *  indirect draws also need the ARB_multi_draw_indirect
+ *  extension.
+ ***********************************************************/
+SceneManager::DRAW_SUBMISSION SceneManager::SelectDrawSubmission()
+{
+	GLint programID = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &programID);
 
-	// Draw the top of the mug as a flat cylinder
-	m_basicMeshes->DrawCylinderMesh(true, false, false);
+	if ((programID == 0) || (m_materialBuffer == 0))
+	{
+		return(DRAW_SUBMISSION_SINGLE);
+	}
 
-	/****************************************************************/
+	GLuint blockIndex = glGetProgramResourceIndex(programID, GL_SHADER_STORAGE_BLOCK, g_InstanceBlockName);
+	if ((blockIndex == GL_INVALID_INDEX) || (glGetUniformLocation(programID, g_UseInstancesName) < 0))
+	{
+		return(DRAW_SUBMISSION_SINGLE);
+	}
 
-	// Mug Handle - Torus *******/
+	// every level of detail of the round meshes is a mesh of its
+	// own, and the other meshes use their one mesh at every level
+	MeshGeometry::MESH_DATA mesh;
+	size_t triangleCount = 0;
+	size_t missesBefore = 0;
+	size_t missesAfter = 0;
+	m_meshBuffer.Destroy();
+	for (int shape = 0; shape < MESH_SHAPE_COUNT; shape++)
+	{
+		for (int level = 0; level < MeshGeometry::DETAIL_LEVELS; level++)
+		{
+			if ((level > 0) && (HasDetailLevels((MESH_SHAPE)shape) == false))
+			{
+				m_meshLevels[shape][level] = m_meshLevels[shape][0];
+				continue;
+			}
+
+			// the meshes are reordered for the vertex cache once, as
+			// they are built
+			BuildShapeMesh((MESH_SHAPE)shape, level, mesh);
+			missesBefore += MeshOptimizer::CountCacheMisses(mesh);
+			MeshOptimizer::Optimize(mesh);
+			missesAfter += MeshOptimizer::CountCacheMisses(mesh);
+			triangleCount += mesh.indices.size() / 3;
+
+			m_meshLevels[shape][level] = m_meshBuffer.AddMesh(mesh);
+		}
+	}
 
-	// Declare scale for the mesh
-	scaleXYZ = glm::vec3(0.4f, 0.5f, 0.3f);
+	if (triangleCount > 0)
+	{
+		std::cout << "Reordered the basic meshes for the vertex cache, ACMR "
+			<< (float)missesBefore / triangleCount << " to "
+			<< (float)missesAfter / triangleCount << std::endl;
+	}
 
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f; // Rotate to align like a handle
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 90.0f;
+	m_vertexFormat = MeshBuffer::VERTEX_FORMAT_FLOAT;
+	if (glGetUniformLocation(programID, g_PackedVerticesName) >= 0)
+	{
+		m_vertexFormat = MeshBuffer::VERTEX_FORMAT_PACKED;
+	}
 
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(6.7f, 0.8f, 3.0f); // Positioned to side
+	if (m_meshBuffer.Upload(m_vertexFormat) == false)
+	{
+		return(DRAW_SUBMISSION_SINGLE);
+	}
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	if (m_instanceBuffer == 0)
+	{
+		glGenBuffers(1, &m_instanceBuffer);
+	}
+	glShaderStorageBlockBinding(programID, blockIndex, INSTANCE_BLOCK_BINDING);
 
-	// Set the shader texture for the mug handle
-	SetShaderTexture("mugholder");
+	if (GLEW_ARB_multi_draw_indirect)
+	{
+		if (m_indirectBuffer == 0)
+		{
+			glGenBuffers(1, &m_indirectBuffer);
+		}
 
-	// Set the shader material for the mug handle
-	SetShaderMaterial("clay");
+		std::cout << "Drawing the scene with indirect multi draws" << std::endl;
+		return(DRAW_SUBMISSION_INDIRECT);
+	}
 
-	// Set the texture UV scale to fit the torus
-	SetTextureUVScale(5.0, 1.0);
+	std::cout << "Drawing repeated meshes as instances" << std::endl;
 
-	// Draw the torus mesh for the mug handle
-	m_basicMeshes->DrawTorusMesh();
-	/****************************************************************/
+	return(DRAW_SUBMISSION_INSTANCED);
 }
 
-/****************************************************************
-*  RenderLaptop()
-*
-*  This method is called to render the shapes for the scene
-*  Laptop object.
-****************************************************************/
-void SceneManager::RenderLaptop()
+void SceneManager::SetupSceneLights()
 {
-	// declare the variables for the transformations
-	glm::vec3 scaleXYZ;
-	float XrotationDegrees = 0.0f;
-	float YrotationDegrees = 0.0f;
-	float ZrotationDegrees = 0.0f;
-	glm::vec3 positionXYZ;
-
-	// Declare scale for the mesh
-	scaleXYZ = glm::vec3(2.75f, 2.0f, 0.06f);
-
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f; // 
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
-
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(5.0f, 1.3f, -4.5f);
-
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
-
-	// Set the shader color for the macbook
-	SetShaderColor(0.3f, 0.3f, 0.3f, 1.0f); // Silver-gray
-
-	// Set the shader material for the mug body
-	SetShaderMaterial("metal");
-
-	// draw the mesh
-	m_basicMeshes->DrawBoxMesh();
 
 	/****************************************************************/
-
-	// Macbook Plane ( For logo )
-
-	// Declare scale for the mesh
-	scaleXYZ = glm::vec3(1.38f, 0.0f, 1.0f);
-
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 90.0f; // That makes mesh vertical
-	YrotationDegrees = 180.0f; // Rotating logo like on the reference image
-	ZrotationDegrees = 0.0f;
-
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(5.0f, 1.3f, -4.465f);
-
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
-
-	// Set the shader texture for the macbook plane
-	SetShaderTexture("macbook");
-
-	// Set the shader material for the macbook plane
-	SetShaderMaterial("metal");
-
-	// Set the texture UV scale to fit the plane
-	SetTextureUVScale(1.0, 0.95);
-
-	// draw the mesh
-	m_basicMeshes->DrawPlaneMesh();
-
+	/*** Light 0 – LEFT WARM WASH ***/
+	m_uniforms.setVec3Value("lightSources[0].position", -6.8f, 1.10f, -4.25f);
+	m_uniforms.setVec3Value("lightSources[0].diffuseColor", 1.0f, 0.20f, 0.0f);
+	m_uniforms.setVec3Value("lightSources[0].specularColor", 1.0f, 0.5f, 0.0f);
+	m_uniforms.setVec3Value("lightSources[0].ambientColor", 0.15f, 0.05f, 0.0f);
+	m_uniforms.setFloatValue("lightSources[0].focalStrength", 10.0f);        
+	m_uniforms.setFloatValue("lightSources[0].specularIntensity", 0.12f);        
 	/****************************************************************/
 
-	// Macbook Holder ( Bottom Stand )
-
-	// Declare scale for the mesh
-	scaleXYZ = glm::vec3(1.1f, 0.1f, 0.5f);
-
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f; // 
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
-
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(5.0f, 0.3f, -4.5f);
-
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
-
-	// Set the shader color for the macbook holder
-	SetShaderColor(0.5f, 0.5f, 0.5f, 1.0f);
-
-	// Set the shader material for the macbook holder
-	SetShaderMaterial("plastic");
-
-	// draw the mesh
-	m_basicMeshes->DrawBoxMesh();
-
+	/*** Light 1 – TOP WHITE HALO ***/
+	m_uniforms.setVec3Value("lightSources[1].position", 0.0f, 10.2f, -4.8f);
+	m_uniforms.setVec3Value("lightSources[1].ambientColor", 0.10f, 0.12f, 0.16f);
+	m_uniforms.setVec3Value("lightSources[1].diffuseColor", 0.70f, 0.74f, 0.82f);
+	m_uniforms.setVec3Value("lightSources[1].specularColor", 1.0f, 1.0f, 1.0f);
+	m_uniforms.setFloatValue("lightSources[1].focalStrength", 30.0f);
+	m_uniforms.setFloatValue("lightSources[1].specularIntensity", 0.65f);
 	/****************************************************************/
 
-	// Macbook Holder ( Vertical Stand )
-
-	// Declare scale for the mesh
-	scaleXYZ = glm::vec3(1.1f, 0.4f, 0.2f);
-
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f; // 
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
+	/*** Light 2 – RIGHT/BACK WHITE FILL  ***/
+	m_uniforms.setVec3Value("lightSources[2].position", 16.5f, 3.5f, 3.5f);		   
+	m_uniforms.setVec3Value("lightSources[2].ambientColor", 0.20f, 0.21f, 0.23f);   
+	m_uniforms.setVec3Value("lightSources[2].diffuseColor", 0.58f, 0.62f, 0.68f);  
+	m_uniforms.setVec3Value("lightSources[2].specularColor", 0.62f, 0.66f, 0.72f);  
+	m_uniforms.setFloatValue("lightSources[2].focalStrength", 110.0f);              
+	m_uniforms.setFloatValue("lightSources[2].specularIntensity", 0.82f);          
+	/****************************************************************/
+	
+	/*** Light 3 – UNDER-DESK STRIP ***/
+	m_uniforms.setVec3Value("lightSources[3].position", 0.0f, -0.32f, -6.20f);
+	m_uniforms.setVec3Value("lightSources[3].ambientColor", 0.01f, 0.001f, 0.001f); 
+	m_uniforms.setVec3Value("lightSources[3].diffuseColor", 0.80f, 0.28f, 0.02f);  
+	m_uniforms.setVec3Value("lightSources[3].specularColor", 0.80f, 0.28f, 0.02f);
+	m_uniforms.setFloatValue("lightSources[3].focalStrength", 8.0f);       
+	m_uniforms.setFloatValue("lightSources[3].specularIntensity", 0.05f); 
 
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(5.0f, 0.5f, -4.5f);
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	// enable the use of lighting in the shader
+	m_uniforms.setBoolValue("bUseLighting", true);
 
-	// Set the shader color for the macbook holder
-	SetShaderColor(0.5f, 0.5f, 0.5f, 1.0f);
 
-	// Set the shader material for the macbook holder
-	SetShaderMaterial("plastic");
 
-	// draw the mesh
-	m_basicMeshes->DrawBoxMesh();
 }
 
-/****************************************************************
-*  RenderMonitor()
-*
-*  This method is called to render the shapes for the scene
-*  Monitor object.
-****************************************************************/
-void SceneManager::RenderMonitor()
-{
+/***********************************************************
+ *  PrepareScene()
+ *
+ *  This method is used for preparing the 3D scene by loading
+ *  the shapes, textures in memory to support the 3D scene
+ *  rendering
+ ***********************************************************/
 
-	// declare the variables for the transformations
-	glm::vec3 scaleXYZ;
-	float XrotationDegrees = 0.0f;
-	float YrotationDegrees = 0.0f;
-	float ZrotationDegrees = 0.0f;
-	glm::vec3 positionXYZ;
 
-	/*** Monitor - Screen Box ***/
+bool SceneManager::PrepareScene(const std::string& sceneFile)
+{
+	// load the scene description, from its compiled binary file
+	// when that is up to date
+	SceneFile scene;
+	if (scene.Load(sceneFile) == false)
+	{
+		std::cout << "Could not load scene:" << sceneFile << std::endl;
+		return(false);
+	}
 
-	// Declare scale for the mesh
-	scaleXYZ = glm::vec3(8.5f, 4.5f, 0.1f);
+	// load the textures for the 3D scene
+	LoadSceneTextures(scene);
 
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
+	//define the object materials that will be used in the scene
+	DefineObjectMaterials(scene);
 
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(0.0f, 3.7f, -4.2f);
+	//Setting up scene lighting
+	SetupSceneLights();
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	// only one instance of a particular mesh needs to be
+	// loaded in memory no matter how many times it is drawn
+	// in the rendered 3D scene
 
-	// Set the shader color for the monitor screen
-	SetShaderColor(0.1f, 0.1f, 0.1f, 1.0f);
+	m_basicMeshes->LoadBoxMesh();
+	m_basicMeshes->LoadPlaneMesh();
+	m_basicMeshes->LoadCylinderMesh();
+	m_basicMeshes->LoadConeMesh();
+	m_basicMeshes->LoadPrismMesh();
+	m_basicMeshes->LoadPyramid4Mesh();
+	m_basicMeshes->LoadSphereMesh();
+	m_basicMeshes->LoadTaperedCylinderMesh();
+	m_basicMeshes->LoadTorusMesh();
 
-	// Set the shader material for the monitor screen
-	SetShaderMaterial("metal");
+	// the same meshes in shared buffers, when the shader can
+	// draw them as instances or with indirect draws
+	m_drawSubmission = SelectDrawSubmission();
 
-	//draw the mesh
-	m_basicMeshes->DrawBoxMesh();
+	// build the draws of the scene objects, which are replayed
+	// every frame from the scene graph
+	BuildDrawList(scene);
 
-	/****************************************************************/
+	return(true);
+}
 
-	/*** Monitor - Screen Plane ***/
 
-	// Declare scale for the mesh
-	scaleXYZ = glm::vec3(4.1f, 4.5f, 2.1f);
 
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 90.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
+/***********************************************************
+ *  RenderScene()
+ *
+ *  This method is used for rendering the 3D scene by
+ *  transforming and drawing the basic 3D shapes
+ ***********************************************************/
 
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(0.0f, 3.7f, -4.14f);
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+void SceneManager::RenderScene()
+{
+	// sharpen the streamed textures with the next mip levels, and
+	// upload the textures that were reloaded since the last frame
+	m_textureStreamer.Update();
+	UpdateTextureReloads();
+
+	// give back the memory of the textures not drawn lately
+	EnforceTextureBudget();
+	m_textureResidency.BeginFrame();
+
+	// compute the model matrices below the scene objects that
+	// moved since the last frame, find the draws inside the view
+	// frustum and not hidden by the occluders, then walk those
+	// draws in the order of the sort keys
+	if (m_sceneGraph.Update() == true)
+	{
+		UpdateDrawBounds();
+	}
+	if (m_bBakeStaticDraws == true)
+	{
+		BakeStaticDraws();
+	}
+	m_drawTree.CullFrustum(m_projectionMatrix * m_viewMatrix, m_visibleDraws);
+	CullOccludedDraws();
+	CullBakedGroups();
+	SortDrawList();
 
-	// Set the shader texture for the monitor plane
-	SetShaderTexture("screen");
+	switch (m_drawSubmission)
+	{
+	case DRAW_SUBMISSION_INDIRECT:
+		RenderIndirectDraws();
+		break;
+	case DRAW_SUBMISSION_INSTANCED:
+		RenderInstancedDraws();
+		break;
+	default:
+		RenderDraws();
+		break;
+	}
+}
 
-	// Set the shader material for the monitor screen
-	SetShaderMaterial("glass");
+/***********************************************************
+ *  RenderDraws()
+ *
+ *  This method is used for drawing the sorted draws one at
+ *  a time, with the uniforms of each draw.
+ ***********************************************************/
+void SceneManager::RenderDraws()
+{
+	for (size_t i = 0; i < m_drawKeys.size(); i++)
+	{
+		const DRAW_COMMAND& draw = m_drawCommands[DrawSortKeys::GetDrawIndex(m_drawKeys[i])];
 
-	// Set the texture UV scale to fit the plane
-	SetTextureUVScale(1.0, 1.0);
+		if (NULL != m_pShaderManager)
+		{
+			m_uniforms.setMat4Value(g_ModelName, m_sceneGraph.GetWorldMatrix(draw.node));
+		}
+		if (draw.bUseTexture == true)
+		{
+			SetShaderTexture(draw.texture);
+		}
+		else
+		{
+			SetShaderColor(draw.color.r, draw.color.g, draw.color.b, draw.color.a);
+		}
+		SetTextureUVScale(draw.uvScale.x, draw.uvScale.y);
+		SetShaderMaterial(draw.material);
 
-	// draw the mesh
-	m_basicMeshes->DrawPlaneMesh();
+		DrawShapeMesh(draw.shape, draw.bDrawTop, draw.bDrawBottom, draw.bDrawSides);
+	}
+}
 
-	/****************************************************************/
-	/*** Monitor - Stand (Pole) ***/
+/***********************************************************
+ *  WriteInstances()
+ *
+ *  This method is used for writing the values of every
+ *  draw into the instance buffer, in the sorted order, so
+ *  that a run of sorted draws is a range of instances.  The
+ *  visible baked groups follow the draws, with their UV
+ *  scale already applied to their vertices.  Each instance
+ *  is compared with the one written in the last frame, and
+ *  the buffer is only uploaded when any of them changed, so
+ *  a scene that does not move uploads nothing.
+ ***********************************************************/
+void SceneManager::WriteInstances()
+{
+	size_t drawCount = m_drawKeys.size();
+	bool bChanged = (m_instances.size() != drawCount + m_visibleGroups.size());
 
-	// Declare scale for the mesh
-	scaleXYZ = glm::vec3(0.2f, 2.5f, 0.2f);
+	m_instances.resize(drawCount + m_visibleGroups.size());
+	for (size_t i = 0; i < drawCount; i++)
+	{
+		const DRAW_COMMAND& draw = m_drawCommands[DrawSortKeys::GetDrawIndex(m_drawKeys[i])];
+		INSTANCE_DATA& instance = m_instances[i];
+		INSTANCE_DATA previous = instance;
+
+		instance.model = m_sceneGraph.GetWorldMatrix(draw.node);
+		instance.color = draw.color;
+		instance.uvScale = draw.uvScale;
+		instance.material = draw.material;
+		SetInstanceTexture(instance, (draw.bUseTexture == true) ? draw.texture : -1);
+		bChanged = bChanged || (memcmp(&previous, &instance, sizeof(INSTANCE_DATA)) != 0);
+	}
+	for (size_t i = 0; i < m_visibleGroups.size(); i++)
+	{
+		const BAKED_GROUP& group = m_bakedGroups[m_visibleGroups[i]];
+		INSTANCE_DATA& instance = m_instances[drawCount + i];
+		INSTANCE_DATA previous = instance;
+
+		instance.model = glm::mat4(1.0f);
+		instance.color = group.color;
+		instance.uvScale = glm::vec2(1.0f, 1.0f);
+		instance.material = group.material;
+		SetInstanceTexture(instance, (group.bUseTexture == true) ? group.texture : -1);
+		bChanged = bChanged || (memcmp(&previous, &instance, sizeof(INSTANCE_DATA)) != 0);
+	}
 
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
+	if (bChanged == true)
+	{
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_instanceBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, m_instances.size() * sizeof(INSTANCE_DATA), m_instances.data(), GL_STREAM_DRAW);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	}
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, INSTANCE_BLOCK_BINDING, m_instanceBuffer);
+}
 
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(1.1f, 0.3f, -4.5f);
+/***********************************************************
+ *  SetInstanceTexture()
+ *
+ *  This method is used for setting the texture values of
+ *  an instance, or turning off its texture for a slot of
+ *  -1.  The texture is marked as drawn in this frame.
+ ***********************************************************/
+void SceneManager::SetInstanceTexture(INSTANCE_DATA& instance, int textureSlot)
+{
+	instance.atlasRect = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+	instance.texture = 0;
+	instance.bUseTexture = (textureSlot >= 0) ? 1 : 0;
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	if (textureSlot < 0)
+	{
+		return;
+	}
 
-	// Set the shader color for the monitor stand pole
-	SetShaderColor(0.5f, 0.5f, 0.5f, 1.0f);
+	UseTexture(textureSlot);
 
-	// Set the shader material for the monitor screen
-	SetShaderMaterial("metal");
+	// a texture packed into an atlas is drawn from its page
+	if (m_textureIDs[textureSlot].atlasSlot >= 0)
+	{
+		instance.atlasRect = m_textureIDs[textureSlot].atlasRect;
+		textureSlot = m_textureIDs[textureSlot].atlasSlot;
+	}
+	instance.texture = (m_textureBackend == TEXTURE_BACKEND_ARRAYS) ? m_textureIDs[textureSlot].layer : textureSlot;
+}
 
-	// draw the mesh
-	m_basicMeshes->DrawCylinderMesh();
+/***********************************************************
+ *  BindMeshBuffer()
+ *
+ *  This method is used for binding shared mesh buffers.  The
+ *  packed positions of each buffer are fractions of its own
+ *  bounds, so the shader gets the bounds of the buffer.
+ ***********************************************************/
+void SceneManager::BindMeshBuffer(const MeshBuffer& buffer)
+{
+	buffer.Bind();
 
-	/****************************************************************/
+	if (buffer.GetVertexFormat() == MeshBuffer::VERTEX_FORMAT_PACKED)
+	{
+		m_uniforms.setVec3Value(g_PackedPositionOffsetName, buffer.GetPositionOffset());
+		m_uniforms.setVec3Value(g_PackedPositionScaleName, buffer.GetPositionScale());
+	}
+}
 
-	/*** Monitor - Stand (Base Plate) ***/
+/***********************************************************
+ *  FindInstanceRun()
+ *
+ *  This method is used for finding the end of the run of
+ *  sorted draws that starts at the passed in position.  The
+ *  draws of a run have the same mesh, faces and texture
+ *  object, so they can be drawn as instances of one draw.
+ ***********************************************************/
+size_t SceneManager::FindInstanceRun(size_t first)
+{
+	const DRAW_COMMAND& draw = m_drawCommands[DrawSortKeys::GetDrawIndex(m_drawKeys[first])];
+	size_t last = first + 1;
 
-	// Declare scale for the mesh
-	scaleXYZ = glm::vec3(1.0f, 0.1f, 1.0f);
+	while (last < m_drawKeys.size())
+	{
+		const DRAW_COMMAND& next = m_drawCommands[DrawSortKeys::GetDrawIndex(m_drawKeys[last])];
+
+		if ((next.shape != draw.shape) ||
+			(next.meshLevel != draw.meshLevel) ||
+			(next.bDrawTop != draw.bDrawTop) ||
+			(next.bDrawBottom != draw.bDrawBottom) ||
+			(next.bDrawSides != draw.bDrawSides) ||
+			(next.textureBinding != draw.textureBinding))
+		{
+			break;
+		}
+		last++;
+	}
 
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
+	return(last);
+}
 
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(1.1f, 0.2f, -4.5f);
+/***********************************************************
+ *  RenderInstancedDraws()
+ *
+ *  This method is used for drawing the sorted draws as
+ *  instances.  Each run of neighbouring draws with the same
+ *  mesh, faces and texture object becomes one instanced
+ *  draw.  The sort keeps those draws together, and the
+ *  instances of a draw are drawn in order, so transparent
+ *  draws stay back to front.
+ ***********************************************************/
+void SceneManager::RenderInstancedDraws()
+{
+	size_t drawCount = m_drawKeys.size();
+	if ((drawCount == 0) && (m_visibleGroups.size() == 0))
+	{
+		return;
+	}
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	WriteInstances();
 
-	// Set the shader color for the monitor stand base plate
-	SetShaderColor(0.5f, 0.5f, 0.5f, 1.0f);
+	m_uniforms.setBoolValue(g_UseInstancesName, true);
+	m_uniforms.setBoolValue(g_PackedVerticesName, m_vertexFormat == MeshBuffer::VERTEX_FORMAT_PACKED);
+	RenderBakedGroups(drawCount);
+	BindMeshBuffer(m_meshBuffer);
 
-	// Set the shader material for the monitor screen
-	SetShaderMaterial("metal");
+	size_t first = 0;
+	while (first < drawCount)
+	{
+		const DRAW_COMMAND& draw = m_drawCommands[DrawSortKeys::GetDrawIndex(m_drawKeys[first])];
+		size_t last = FindInstanceRun(first);
 
-	// draw the mesh
-	m_basicMeshes->DrawBoxMesh();
+		// every draw of the run shares the bound texture object,
+		// and the instances pick their layer or handle
+		if (draw.textureBinding >= 0)
+		{
+			SetShaderTexture(draw.texture);
+		}
 
-	/****************************************************************/
-	/*** Monitor - Light Bar ***/
+		m_meshBuffer.DrawInstanced(
+			m_meshLevels[draw.shape][draw.meshLevel],
+			draw.bDrawTop,
+			draw.bDrawBottom,
+			draw.bDrawSides,
+			(int)(last - first),
+			(int)first);
 
-	// Declare scale for the mesh
-	scaleXYZ = glm::vec3(6.0f, 0.1f, 0.3f);
+		first = last;
+	}
 
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
+	m_meshBuffer.Unbind();
+	m_uniforms.setBoolValue(g_UseInstancesName, false);
+	m_uniforms.setBoolValue(g_PackedVerticesName, false);
+}
 
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(0.0f, 6.2f, -4.17f);
+/***********************************************************
+ *  RenderIndirectDraws()
+ *
+ *  This method is used for drawing the sorted draws with
+ *  indirect draw commands.  Every run of draws becomes the
+ *  commands of an instanced draw, and the commands are sent
+ *  with one multi draw for each texture object that has to
+ *  be bound.  Bindless textures need no binding, so then the
+ *  whole scene is a single multi draw.  The draws are sorted
+ *  by texture before mesh for this, as switching meshes
+ *  inside a multi draw costs nothing.
+ ***********************************************************/
+void SceneManager::RenderIndirectDraws()
+{
+	size_t drawCount = m_drawKeys.size();
+	if ((drawCount == 0) && (m_visibleGroups.size() == 0))
+	{
+		return;
+	}
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	WriteInstances();
 
-	// Set the shader color for the monitor light bar
-	SetShaderColor(0.2f, 0.2f, 0.2f, 1.0f);
+	// the commands of each multi draw, with the texture slot that
+	// is bound for it
+	struct INDIRECT_BATCH
+	{
+		size_t firstCommand;
+		int texture;
+	};
+	std::vector<INDIRECT_BATCH> batches;
+	int batchBinding = -1;
 
-	// Set the shader material for the mug body
-	SetShaderMaterial("plastic");
+	m_indirectCommands.clear();
 
-	// draw the mesh
+	size_t first = 0;
+	while (first < drawCount)
+	{
+		const DRAW_COMMAND& draw = m_drawCommands[DrawSortKeys::GetDrawIndex(m_drawKeys[first])];
+		size_t last = FindInstanceRun(first);
+
+		// draws without a texture fit into any multi draw, and a
+		// multi draw without a texture yet takes the next one
+		bool bTextured = (draw.textureBinding >= 0);
+		if ((batches.size() == 0) ||
+			((bTextured == true) &&
+			(batches.back().texture >= 0) &&
+			(draw.textureBinding != batchBinding) &&
+			(m_textureBackend != TEXTURE_BACKEND_BINDLESS)))
+		{
+			INDIRECT_BATCH batch;
+			batch.firstCommand = m_indirectCommands.size();
+			batch.texture = bTextured ? draw.texture : -1;
+			batches.push_back(batch);
+			batchBinding = draw.textureBinding;
+		}
+		else if ((bTextured == true) && (batches.back().texture < 0))
+		{
+			batches.back().texture = draw.texture;
+			batchBinding = draw.textureBinding;
+		}
 
-	m_basicMeshes->DrawBoxMesh();
+		m_meshBuffer.AddDrawCommands(
+			m_meshLevels[draw.shape][draw.meshLevel],
+			draw.bDrawTop,
+			draw.bDrawBottom,
+			draw.bDrawSides,
+			(int)(last - first),
+			(int)first,
+			m_indirectCommands);
 
-	/****************************************************************/
-	/*** Monitor - Light Bar Small Box (Center Piece) ***/
+		first = last;
+	}
 
-	// Declare scale for the mesh
-	scaleXYZ = glm::vec3(0.6f, 0.3f, 0.2f); // Centered box
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_indirectBuffer);
+	glBufferData(
+		GL_DRAW_INDIRECT_BUFFER,
+		m_indirectCommands.size() * sizeof(MeshBuffer::DRAW_ELEMENTS_COMMAND),
+		m_indirectCommands.data(),
+		GL_STREAM_DRAW);
 
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
+	m_uniforms.setBoolValue(g_UseInstancesName, true);
+	m_uniforms.setBoolValue(g_PackedVerticesName, m_vertexFormat == MeshBuffer::VERTEX_FORMAT_PACKED);
+	RenderBakedGroups(drawCount);
+	BindMeshBuffer(m_meshBuffer);
 
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(0.0f, 6.10f, -4.2f);
+	for (size_t i = 0; i < batches.size(); i++)
+	{
+		size_t endCommand = (i + 1 < batches.size()) ? batches[i + 1].firstCommand : m_indirectCommands.size();
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+		if (batches[i].texture >= 0)
+		{
+			SetShaderTexture(batches[i].texture);
+		}
+		m_meshBuffer.DrawIndirect(batches[i].firstCommand, (int)(endCommand - batches[i].firstCommand));
+	}
 
-	// Set the shader material for the mug body
-	SetShaderMaterial("plastic");
+	m_meshBuffer.Unbind();
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	m_uniforms.setBoolValue(g_UseInstancesName, false);
+	m_uniforms.setBoolValue(g_PackedVerticesName, false);
+}
 
-	// Set the shader color for the monitor light bar small box
-	SetShaderColor(0.2f, 0.2f, 0.2f, 1.0f);
+/***********************************************************
+ *  BuildDrawList()
+ *
+ *  This method is used for building the flat list of draws
+ *  from the objects of a scene.  Every object gets a scene
+ *  graph node, and the transform of every part becomes a
+ *  node below it.  The texture and material tags of the
+ *  parts are resolved here, so the draws hold slots and
+ *  indices only.
+ ***********************************************************/
+void SceneManager::BuildDrawList(const SceneFile& scene)
+{
+	const std::vector<SceneFile::SCENE_OBJECT>& objects = scene.GetObjects();
+	const std::vector<SceneFile::SCENE_PART>& parts = scene.GetParts();
+
+	m_sceneGraph.Clear();
+	m_sceneObjects.clear();
+	m_drawCommands.clear();
+	m_drawTree.Clear();
+	// the static draws are baked once their model matrices are
+	// known, when the draws go through the shared mesh buffers
+	m_bakedGroups.clear();
+	m_visibleGroups.clear();
+	m_bBakeStaticDraws = (m_drawSubmission != DRAW_SUBMISSION_SINGLE);
+	m_drawCommands.reserve(parts.size());
+
+	for (size_t i = 0; i < objects.size(); i++)
+	{
+		const SceneFile::SCENE_OBJECT& object = objects[i];
+		int objectNode = m_sceneGraph.AddNode(-1, glm::vec3(1.0f), 0.0f, 0.0f, 0.0f, object.position);
+		m_sceneObjects[object.nameTag] = objectNode;
 
-	// draw the mesh
-	m_basicMeshes->DrawBoxMesh();
+		for (uint32_t j = object.firstPart; j < object.firstPart + object.partCount; j++)
+		{
+			const SceneFile::SCENE_PART& part = parts[j];
+			DRAW_COMMAND draw;
+
+			if (m_drawCommands.size() > DrawSortKeys::MAX_DRAW_INDEX)
+			{
+				std::cout << "Scene part " << j << " is past the most draws that can be sorted" << std::endl;
+				break;
+			}
+
+			if (FindMeshShape(part.meshTag, draw.shape) == false)
+			{
+				std::cout << "Scene part " << j << " uses an unknown mesh" << std::endl;
+				continue;
+			}
+
+			draw.meshLevel = 0;
+			draw.node = m_sceneGraph.AddNode(
+				objectNode,
+				part.scale,
+				part.rotation.x,
+				part.rotation.y,
+				part.rotation.z,
+				part.position);
+			draw.bDrawTop = (part.faces & SceneFile::PART_FACE_TOP) != 0;
+			draw.bDrawBottom = (part.faces & SceneFile::PART_FACE_BOTTOM) != 0;
+			draw.bDrawSides = (part.faces & SceneFile::PART_FACE_SIDES) != 0;
+			// only the cylinders can leave out faces, and the cone
+			// its bottom, so the other meshes always draw every face
+			if ((draw.shape != MESH_SHAPE_CYLINDER) && (draw.shape != MESH_SHAPE_TAPERED_CYLINDER))
+			{
+				draw.bDrawTop = true;
+				draw.bDrawBottom = draw.bDrawBottom || (draw.shape != MESH_SHAPE_CONE);
+				draw.bDrawSides = true;
+			}
+			draw.bUseTexture = (part.textureTag != 0);
+			draw.texture = draw.bUseTexture ? FindTextureSlot(part.textureTag) : -1;
+			draw.textureBinding = draw.bUseTexture ? GetTextureBinding(draw.texture) : -1;
+			draw.color = part.color;
+			draw.uvScale = part.uvScale;
+			draw.material = (part.materialTag != 0) ? FindMaterialIndex(part.materialTag) : -1;
+			// textures with an alpha channel may be see-through
+			if (draw.bUseTexture == true)
+			{
+				draw.bTransparent = (draw.texture >= 0) &&
+					((m_textureIDs[draw.texture].colorChannels == 2) || (m_textureIDs[draw.texture].colorChannels == 4));
+			}
+			else
+			{
+				draw.bTransparent = (part.color.a < 1.0f);
+			}
+			draw.bOccluder = false;
+			draw.bDynamic = false;
+			draw.bBaked = false;
+			m_drawCommands.push_back(draw);
+		}
+	}
 }
 
-/**************************************************************
-*  RenderMouse()
-*
-*  This method is called to render the shapes for the scene
-*  Mouse object.
-***************************************************************/
-void SceneManager::RenderMouse()
+/***********************************************************
+ *  UpdateDrawBounds()
+ *
+ *  This method is used for moving the box of the mesh of
+ *  every draw into world space with its model matrix.  The
+ *  tree over the boxes is built the first time, and only
+ *  refitted after that.  Opaque boxes and planes that are
+ *  large on at least two axes are picked as occluders.
+ ***********************************************************/
+void SceneManager::UpdateDrawBounds()
 {
-	// declare the variables for the transformations
-	glm::vec3 scaleXYZ;
-	float XrotationDegrees = 0.0f;
-	float YrotationDegrees = 0.0f;
-	float ZrotationDegrees = 0.0f;
-	glm::vec3 positionXYZ;
-
+	m_drawBounds.resize(m_drawCommands.size());
 
-	// declare the scale for the mouse mesh
-	scaleXYZ = glm::vec3(0.5f, 0.4f, 0.8f); // Rounded upper body
+	for (size_t i = 0; i < m_drawCommands.size(); i++)
+	{
+		DRAW_COMMAND& draw = m_drawCommands[i];
+		m_drawBounds[i] = BoundingVolumeTree::TransformBounds(
+			g_MeshBounds[draw.shape],
+			m_sceneGraph.GetWorldMatrix(draw.node));
+		const glm::vec3& extent = m_drawBounds[i].extent;
+
+		// the second largest half size tells whether the draw
+		// covers an area, and not just a thin line
+		float secondExtent = std::max(
+			std::min(extent.x, extent.y),
+			std::min(std::max(extent.x, extent.y), extent.z));
+		draw.bOccluder = (draw.bTransparent == false) &&
+			((draw.shape == MESH_SHAPE_BOX) || (draw.shape == MESH_SHAPE_PLANE)) &&
+			(secondExtent >= OCCLUDER_MIN_EXTENT);
+	}
 
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 180.0f;
-	ZrotationDegrees = 0.0f;
+	if (m_drawTree.GetNodeCount() == 0)
+	{
+		m_drawTree.Build(m_drawBounds);
+	}
+	else
+	{
+		m_drawTree.Refit(m_drawBounds);
+	}
+}
 
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(3.5f, 0.4f, 2.3f);
+/***********************************************************
+ *  CullOccludedDraws()
+ *
+ *  This method is used for drawing the visible occluders
+ *  into the occlusion buffer, and then removing the visible
+ *  draws whose boxes are hidden behind them.  The occluders
+ *  themselves are always kept.  Baked draws leave the list
+ *  here without being tested, once they have been drawn as
+ *  occluders.
+ ***********************************************************/
+void SceneManager::CullOccludedDraws()
+{
+	m_occlusionBuffer.Begin(m_projectionMatrix * m_viewMatrix);
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	for (size_t i = 0; i < m_visibleDraws.size(); i++)
+	{
+		const DRAW_COMMAND& draw = m_drawCommands[m_visibleDraws[i]];
 
-	// Set the shader texture for the mouse
-	SetShaderTexture("mouse"); // Use the screen texture
+		if (draw.bOccluder == true)
+		{
+			m_occlusionBuffer.AddOccluder(
+				(draw.shape == MESH_SHAPE_BOX) ? m_occluderBox : m_occluderPlane,
+				m_sceneGraph.GetWorldMatrix(draw.node));
+		}
+	}
 
-	// Set the texture UV scale to fit the mouse
-	SetTextureUVScale(1.0, 1.0);
+	bool bOccluded = (m_occlusionBuffer.GetTriangleCount() > 0);
+	if (bOccluded == true)
+	{
+		m_occlusionBuffer.Rasterize();
+	}
 
-	// Set the shader material for the mouse
-	SetShaderMaterial("plastic");
+	// baked draws are only needed up to here as occluders, since
+	// they are drawn and culled with their groups
+	size_t visibleCount = 0;
+	for (size_t i = 0; i < m_visibleDraws.size(); i++)
+	{
+		uint32_t drawIndex = m_visibleDraws[i];
+		const DRAW_COMMAND& draw = m_drawCommands[drawIndex];
 
-	// draw the mesh
-	m_basicMeshes->DrawSphereMesh();
+		if (draw.bBaked == true)
+		{
+			continue;
+		}
+		if ((bOccluded == false) ||
+			(draw.bOccluder == true) ||
+			(m_occlusionBuffer.IsVisible(m_drawBounds[drawIndex]) == true))
+		{
+			m_visibleDraws[visibleCount++] = drawIndex;
+		}
+	}
+	m_visibleDraws.resize(visibleCount);
 }
 
-/****************************************************************
-*  RenderKeyboard()
-*
-*  This method is called to render the shapes for the scene
-*  Keyboard object.
-****************************************************************/
-void SceneManager::RenderKeyboard()
+/***********************************************************
+ *  BakeStaticDraws()
+ *
+ *  This method is used for baking the opaque draws that
+ *  have never moved into meshes in world space.  The draws
+ *  are grouped by their texture, or by their color when
+ *  they have no texture, and by their material, so a whole
+ *  group is drawn with the values of a single instance.
+ *  Draws with a texture tag that matches no loaded texture
+ *  are not baked.  The UV scale of each draw is applied to
+ *  its vertices.  Baked draws use the finest level of detail.
+ ***********************************************************/
+void SceneManager::BakeStaticDraws()
 {
+	std::vector<MeshGeometry::MESH_DATA> shapeMeshes(MESH_SHAPE_COUNT);
+	std::vector<MeshGeometry::MESH_DATA> groupMeshes;
+	std::vector<glm::vec3> groupMin;
+	std::vector<glm::vec3> groupMax;
+
+	m_bBakeStaticDraws = false;
+	m_bakedBuffer.Destroy();
+	m_bakedGroups.clear();
+	m_bakedTree.Clear();
+	m_visibleGroups.clear();
+
+	for (int shape = 0; shape < MESH_SHAPE_COUNT; shape++)
+	{
+		BuildShapeMesh((MESH_SHAPE)shape, 0, shapeMeshes[shape]);
+		MeshOptimizer::Optimize(shapeMeshes[shape]);
+	}
 
-	// declare the variables for the transformations
-	glm::vec3 scaleXYZ;
-	float XrotationDegrees = 0.0f;
-	float YrotationDegrees = 0.0f;
-	float ZrotationDegrees = 0.0f;
-	glm::vec3 positionXYZ;
-
-	/*** Keyboard Plane ***/
-
-	// Declare scale for the mesh
-	scaleXYZ = glm::vec3(1.9f, 0.0f, 0.7f);
-
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
+	for (size_t i = 0; i < m_drawCommands.size(); i++)
+	{
+		DRAW_COMMAND& draw = m_drawCommands[i];
+		draw.bBaked = false;
+
+		// transparent draws are sorted back to front every frame,
+		// and draws whose texture is missing are left to the
+		// per draw path, so they look the same baked or not
+		if ((draw.bTransparent == true) || (draw.bDynamic == true) ||
+			((draw.bUseTexture == true) && (draw.texture < 0)))
+		{
+			continue;
+		}
 
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(0.0f, 0.46f, 2.3f);
+		bool bUseTexture = draw.bUseTexture;
+		size_t group = 0;
+		while (group < m_bakedGroups.size())
+		{
+			const BAKED_GROUP& baked = m_bakedGroups[group];
+
+			if ((baked.bUseTexture == bUseTexture) &&
+				(baked.material == draw.material) &&
+				((bUseTexture == true) ? (baked.texture == draw.texture) : (baked.color == draw.color)))
+			{
+				break;
+			}
+			group++;
+		}
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+		if (group == m_bakedGroups.size())
+		{
+			BAKED_GROUP baked;
+			baked.mesh = -1;
+			baked.bUseTexture = bUseTexture;
+			baked.texture = bUseTexture ? draw.texture : -1;
+			baked.textureBinding = bUseTexture ? draw.textureBinding : -1;
+			baked.color = draw.color;
+			baked.material = draw.material;
+			m_bakedGroups.push_back(baked);
+
+			groupMeshes.push_back(MeshGeometry::MESH_DATA());
+			groupMin.push_back(m_drawBounds[i].center - m_drawBounds[i].extent);
+			groupMax.push_back(m_drawBounds[i].center + m_drawBounds[i].extent);
+		}
 
+		// normals move with the cofactors of the model matrix,
+		// which stay valid for the flat scale of a plane
+		const glm::mat4& model = m_sceneGraph.GetWorldMatrix(draw.node);
+		glm::vec3 column0 = glm::vec3(model[0]);
+		glm::vec3 column1 = glm::vec3(model[1]);
+		glm::vec3 column2 = glm::vec3(model[2]);
+		glm::vec3 normalX = glm::cross(column1, column2);
+		glm::vec3 normalY = glm::cross(column2, column0);
+		glm::vec3 normalZ = glm::cross(column0, column1);
+		if (glm::dot(column0, normalX) < 0.0f)
+		{
+			normalX = -normalX;
+			normalY = -normalY;
+			normalZ = -normalZ;
+		}
 
-	// Set the shader color for the keyboard plane
-	SetShaderTexture("keyboard");
+		const MeshGeometry::MESH_DATA& shapeMesh = shapeMeshes[draw.shape];
+		MeshGeometry::MESH_DATA& groupMesh = groupMeshes[group];
+		uint32_t baseVertex = (uint32_t)groupMesh.vertices.size();
 
-	// Set the shader material for the keyboard plane
-	SetShaderMaterial("plastic");
+		for (size_t j = 0; j < shapeMesh.vertices.size(); j++)
+		{
+			MeshGeometry::VERTEX vertex = shapeMesh.vertices[j];
+			glm::vec3 normal = normalX * vertex.normal.x + normalY * vertex.normal.y + normalZ * vertex.normal.z;
 
-	// Set the texture UV scale to fit the keyboard plane
-	SetTextureUVScale(1.0, 1.0);
+			vertex.position = glm::vec3(model * glm::vec4(vertex.position, 1.0f));
+			vertex.normal = (glm::length(normal) > 0.0f) ? glm::normalize(normal) : vertex.normal;
+			vertex.uv = vertex.uv * draw.uvScale;
+			groupMesh.vertices.push_back(vertex);
+		}
 
-	// draw the mesh
-	m_basicMeshes->DrawPlaneMesh();
+		const bool bDrawPart[MeshGeometry::MESH_PART_COUNT] = { draw.bDrawSides, draw.bDrawTop, draw.bDrawBottom };
+		for (int part = 0; part < MeshGeometry::MESH_PART_COUNT; part++)
+		{
+			if (bDrawPart[part] == false)
+			{
+				continue;
+			}
+			for (uint32_t j = 0; j < shapeMesh.partCount[part]; j++)
+			{
+				groupMesh.indices.push_back(baseVertex + shapeMesh.indices[shapeMesh.partFirst[part] + j]);
+			}
+		}
 
-	/****************************************************************/
+		groupMin[group] = glm::min(groupMin[group], m_drawBounds[i].center - m_drawBounds[i].extent);
+		groupMax[group] = glm::max(groupMax[group], m_drawBounds[i].center + m_drawBounds[i].extent);
+		draw.bBaked = true;
+	}
 
-	/*** Keyboard Base ***/
+	// every group is one mesh of sides only, in one pair of buffers
+	std::vector<BoundingVolumeTree::BOUNDS> groupBounds(m_bakedGroups.size());
+	for (size_t i = 0; i < m_bakedGroups.size(); i++)
+	{
+		MeshGeometry::MESH_DATA& groupMesh = groupMeshes[i];
+
+		groupMesh.partFirst[MeshGeometry::MESH_PART_SIDES] = 0;
+		groupMesh.partCount[MeshGeometry::MESH_PART_SIDES] = (uint32_t)groupMesh.indices.size();
+		groupMesh.partFirst[MeshGeometry::MESH_PART_TOP] = 0;
+		groupMesh.partCount[MeshGeometry::MESH_PART_TOP] = 0;
+		groupMesh.partFirst[MeshGeometry::MESH_PART_BOTTOM] = 0;
+		groupMesh.partCount[MeshGeometry::MESH_PART_BOTTOM] = 0;
+		m_bakedGroups[i].mesh = m_bakedBuffer.AddMesh(groupMesh);
+
+		groupBounds[i].center = (groupMin[i] + groupMax[i]) * 0.5f;
+		groupBounds[i].extent = (groupMax[i] - groupMin[i]) * 0.5f;
+		m_bakedGroups[i].bounds = groupBounds[i];
+	}
 
-	// Declare scale for the mesh
-	scaleXYZ = glm::vec3(4.0f, 0.2f, 1.5f);
+	if (m_bakedBuffer.Upload(m_vertexFormat) == false)
+	{
+		m_bakedGroups.clear();
+		return;
+	}
+	m_bakedTree.Build(groupBounds);
 
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
+	std::cout << "Baked the static draws into " << m_bakedGroups.size() << " groups" << std::endl;
+}
 
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(0.0f, 0.35f, 2.3f);
+/***********************************************************
+ *  CullBakedGroups()
+ *
+ *  This method is used for finding the baked groups inside
+ *  the view frustum, and removing the groups hidden behind
+ *  the occluders rasterized for this frame.
+ ***********************************************************/
+void SceneManager::CullBakedGroups()
+{
+	if (m_bakedGroups.size() == 0)
+	{
+		m_visibleGroups.clear();
+		return;
+	}
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	m_bakedTree.CullFrustum(m_projectionMatrix * m_viewMatrix, m_visibleGroups);
+	if (m_occlusionBuffer.GetTriangleCount() == 0)
+	{
+		return;
+	}
 
-	// Set the shader color for the keyboard
-	SetShaderColor(0.1f, 0.1f, 0.1f, 1.0f);
+	size_t visibleCount = 0;
+	for (size_t i = 0; i < m_visibleGroups.size(); i++)
+	{
+		if (m_occlusionBuffer.IsVisible(m_bakedGroups[m_visibleGroups[i]].bounds) == true)
+		{
+			m_visibleGroups[visibleCount++] = m_visibleGroups[i];
+		}
+	}
+	m_visibleGroups.resize(visibleCount);
+}
 
-	// Set the shader material for the keyboard plane
-	SetShaderMaterial("plastic");
+/***********************************************************
+ *  RenderBakedGroups()
+ *
+ *  This method is used for drawing every visible baked
+ *  group with a single draw.  The groups are all opaque, so
+ *  they are drawn before the sorted draws.
+ ***********************************************************/
+void SceneManager::RenderBakedGroups(size_t firstInstance)
+{
+	if (m_visibleGroups.size() == 0)
+	{
+		return;
+	}
 
-	// draw the mesh
-	m_basicMeshes->DrawBoxMesh();
+	BindMeshBuffer(m_bakedBuffer);
+	for (size_t i = 0; i < m_visibleGroups.size(); i++)
+	{
+		const BAKED_GROUP& group = m_bakedGroups[m_visibleGroups[i]];
 
+		if (group.textureBinding >= 0)
+		{
+			SetShaderTexture(group.texture);
+		}
+		m_bakedBuffer.DrawInstanced(group.mesh, true, true, true, 1, (int)(firstInstance + i));
+	}
+	m_bakedBuffer.Unbind();
 }
 
-/****************************************************************
-*  RenderMousepad()
-*
-*  This method is called to render the shapes for the scene
-*  Mousepad object.
-****************************************************************/
-void SceneManager::RenderMousepad()
+/***********************************************************
+ *  SortDrawList()
+ *
+ *  This method is used for making the sort key of every
+ *  visible draw for the current view and sorting the keys.  Draws
+ *  are grouped by mesh, texture and material, so the state
+ *  between neighbouring draws rarely changes, and the depth
+ *  is taken at the origin of each draw in view space.  Only
+ *  texture objects split the indirect multi draws, and the
+ *  instances carry their material, so for indirect draws
+ *  the mesh takes the place of the material in the keys.
+ *  The level of detail of the round meshes is picked here
+ *  from the size of their box on the screen, for either
+ *  projection, when the draws use the shared mesh buffers.
+ ***********************************************************/
+void SceneManager::SortDrawList()
 {
+	m_drawKeys.resize(m_visibleDraws.size());
+	bool bSortByMesh = (m_drawSubmission != DRAW_SUBMISSION_INDIRECT);
 
-	// declare the variables for the transformations
-	glm::vec3 scaleXYZ;
-	float XrotationDegrees = 0.0f;
-	float YrotationDegrees = 0.0f;
-	float ZrotationDegrees = 0.0f;
-	glm::vec3 positionXYZ;
-
+	for (size_t i = 0; i < m_visibleDraws.size(); i++)
+	{
+		uint32_t drawIndex = m_visibleDraws[i];
+		DRAW_COMMAND& draw = m_drawCommands[drawIndex];
+		const glm::mat4& model = m_sceneGraph.GetWorldMatrix(draw.node);
+		glm::vec4 viewPosition = m_viewMatrix * model[3];
 
-	// Declare scale for the mesh
-	scaleXYZ = glm::vec3(9.5f, 0.030f, 4.0f);
+		if ((m_drawSubmission != DRAW_SUBMISSION_SINGLE) && (HasDetailLevels(draw.shape) == true))
+		{
+			// an orthographic projection, which has no w from the
+			// depth, draws the box at the same size at any distance -
+			// draws at or behind the camera keep the finest level
+			float radius = glm::length(m_drawBounds[drawIndex].extent);
+			float screenSize = 1.0f;
+			if (m_projectionMatrix[2][3] == 0.0f)
+			{
+				screenSize = radius * m_projectionMatrix[1][1];
+			}
+			else if (viewPosition.z < 0.0f)
+			{
+				screenSize = radius * m_projectionMatrix[1][1] / -viewPosition.z;
+			}
+			draw.meshLevel = SelectDetailLevel(draw.meshLevel, screenSize);
+		}
+		int mesh = m_meshLevels[draw.shape][draw.meshLevel];
+
+		m_drawKeys[i] = DrawSortKeys::MakeKey(
+			0,
+			draw.bTransparent,
+			bSortByMesh ? mesh : 0,
+			draw.textureBinding,
+			bSortByMesh ? draw.material : mesh,
+			-viewPosition.z / SORT_DEPTH_RANGE,
+			drawIndex);
+	}
 
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
+	m_drawSorter.Sort(m_drawKeys);
+}
 
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(0.0f, 0.2f, 2.0f);
+/***********************************************************
+ *  SetViewTransform()
+ *
+ *  This method is used for setting the view and projection
+ *  matrices of the current frame, which the draws are
+ *  sorted against.
+ ***********************************************************/
+void SceneManager::SetViewTransform(const glm::mat4& view, const glm::mat4& projection)
+{
+	m_viewMatrix = view;
+	m_projectionMatrix = projection;
+}
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+/***********************************************************
+ *  SetSceneObjectTransform()
+ *
+ *  This method is used for moving a scene object.
+ *  Only the node of the object changes, and its parts get
+ *  their new matrices in the next rendered frame.  From
+ *  then on the parts are drawn on their own, and no longer
+ *  baked with the static draws.
+ ***********************************************************/
+bool SceneManager::SetSceneObjectTransform(
+	const std::string& name,
+	const glm::vec3& scaleXYZ,
+	float XrotationDegrees,
+	float YrotationDegrees,
+	float ZrotationDegrees,
+	const glm::vec3& positionXYZ)
+{
+	std::unordered_map<uint64_t, int>::iterator it = m_sceneObjects.find(HashTag(name));
+	if (it == m_sceneObjects.end())
+	{
+		return(false);
+	}
 
+	// the parts of a moved object are taken out of the baked
+	// geometry, which is baked again without them
+	for (size_t i = 0; i < m_drawCommands.size(); i++)
+	{
+		DRAW_COMMAND& draw = m_drawCommands[i];
 
-	// Set the shader material for the mousepad
-	SetShaderMaterial("Mousepad");
+		if ((draw.bDynamic == false) && (m_sceneGraph.GetParent(draw.node) == it->second))
+		{
+			draw.bDynamic = true;
+			if (draw.bBaked == true)
+			{
+				m_bBakeStaticDraws = true;
+			}
+		}
+	}
 
-	// Set Shader texture
-	SetShaderTexture("mousepad");
+	m_sceneGraph.SetScale(it->second, scaleXYZ);
+	m_sceneGraph.SetRotation(it->second, XrotationDegrees, YrotationDegrees, ZrotationDegrees);
+	m_sceneGraph.SetPosition(it->second, positionXYZ);
 
-	// draw the mesh
-	m_basicMeshes->DrawBoxMesh();
+	return(true);
+}
 
+/***********************************************************
+ *  DrawShapeMesh()
+ *
+ *  This method is used for drawing a basic mesh.
+ ***********************************************************/
+void SceneManager::DrawShapeMesh(
+	MESH_SHAPE shape,
+	bool bDrawTop,
+	bool bDrawBottom,
+	bool bDrawSides)
+{
+	switch (shape)
+	{
+	case MESH_SHAPE_BOX:
+		m_basicMeshes->DrawBoxMesh();
+		break;
+	case MESH_SHAPE_PLANE:
+		m_basicMeshes->DrawPlaneMesh();
+		break;
+	case MESH_SHAPE_CYLINDER:
+		m_basicMeshes->DrawCylinderMesh(bDrawTop, bDrawBottom, bDrawSides);
+		break;
+	case MESH_SHAPE_CONE:
+		m_basicMeshes->DrawConeMesh(bDrawBottom);
+		break;
+	case MESH_SHAPE_PRISM:
+		m_basicMeshes->DrawPrismMesh();
+		break;
+	case MESH_SHAPE_PYRAMID4:
+		m_basicMeshes->DrawPyramid4Mesh();
+		break;
+	case MESH_SHAPE_SPHERE:
+		m_basicMeshes->DrawSphereMesh();
+		break;
+	case MESH_SHAPE_TAPERED_CYLINDER:
+		m_basicMeshes->DrawTaperedCylinderMesh(bDrawTop, bDrawBottom, bDrawSides);
+		break;
+	case MESH_SHAPE_TORUS:
+		m_basicMeshes->DrawTorusMesh();
+		break;
+	default:
+		break;
+	}
 }
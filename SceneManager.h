@@ -9,10 +9,21 @@
 
 #pragma once
 
+#include "BoundingVolumeTree.h"
+#include "DrawSortKeys.h"
+#include "MeshBuffer.h"
+#include "OcclusionBuffer.h"
+#include "SceneFile.h"
+#include "SceneGraph.h"
 #include "ShaderManager.h"
+#include "ShaderUniformCache.h"
 #include "ShapeMeshes.h"
+#include "TextureDecoder.h"
+#include "TextureResidency.h"
+#include "TextureStreamer.h"
 
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 /***********************************************************
@@ -32,7 +43,131 @@ public:
 	struct TEXTURE_INFO
 	{
 		std::string tag;
+		// image file that the texture is reloaded from
+		std::string filename;
 		uint32_t ID;
+		int width;
+		int height;
+		int colorChannels;
+		int internalFormat;
+		int mipLevels;
+		// finest mip level held in video memory - above 0 when the
+		// texture was reduced for the texture budget, and -1 when
+		// it was evicted
+		int residentLevel;
+		// texture array and layer holding the texture, when the
+		// texture array backend is in use
+		int arrayIndex;
+		int layer;
+		// resident bindless handle, when the bindless backend is in use
+		uint64_t handle;
+		// slot of the atlas page holding the texture and the UV offset
+		// and scale of the texture on that page, when it was packed
+		// into a texture atlas
+		int atlasSlot;
+		glm::vec4 atlasRect;
+	};
+
+	// the ways that loaded textures can be bound for drawing
+	enum TEXTURE_BACKEND
+	{
+		// every texture is bound to its own texture unit
+		TEXTURE_BACKEND_UNITS,
+		// same sized textures are packed into layers of 2D texture arrays
+		TEXTURE_BACKEND_ARRAYS,
+		// every texture is accessed through a resident bindless handle
+		TEXTURE_BACKEND_BINDLESS
+	};
+
+	// the ways that the sorted draws can be sent to OpenGL
+	enum DRAW_SUBMISSION
+	{
+		// every draw sets its uniforms and draws its mesh
+		DRAW_SUBMISSION_SINGLE,
+		// runs of draws of the same mesh are drawn as instances
+		DRAW_SUBMISSION_INSTANCED,
+		// the runs are written as indirect draw commands and drawn
+		// with a few multi draws
+		DRAW_SUBMISSION_INDIRECT
+	};
+
+	// the basic meshes that the scene is drawn with
+	enum MESH_SHAPE
+	{
+		MESH_SHAPE_BOX,
+		MESH_SHAPE_PLANE,
+		MESH_SHAPE_CYLINDER,
+		MESH_SHAPE_CONE,
+		MESH_SHAPE_PRISM,
+		MESH_SHAPE_PYRAMID4,
+		MESH_SHAPE_SPHERE,
+		MESH_SHAPE_TAPERED_CYLINDER,
+		MESH_SHAPE_TORUS,
+		MESH_SHAPE_COUNT
+	};
+
+	// everything needed for one draw of a basic mesh
+	struct DRAW_COMMAND
+	{
+		// scene graph node holding the model matrix
+		int node;
+		MESH_SHAPE shape;
+		// level of detail of the round meshes, picked every frame
+		// from the size of the draw on the screen
+		int meshLevel;
+		// which parts of a cylinder to draw
+		bool bDrawTop;
+		bool bDrawBottom;
+		bool bDrawSides;
+		// either a texture slot or a color is used
+		bool bUseTexture;
+		int texture;
+		// the texture object that the draw binds, which is shared
+		// by the draws on the same atlas page or texture array
+		int textureBinding;
+		// drawn after the opaque draws, from back to front
+		bool bTransparent;
+		// large and opaque enough to hide the draws behind it
+		bool bOccluder;
+		// moved since the scene was loaded, which keeps the draw out
+		// of the baked geometry
+		bool bDynamic;
+		// drawn as part of a baked group instead of on its own
+		bool bBaked;
+		glm::vec4 color;
+		glm::vec2 uvScale;
+		int material;
+	};
+
+	// the static draws that share a texture or color and a material,
+	// baked into one mesh in world space
+	struct BAKED_GROUP
+	{
+		// the mesh of the group in the baked mesh buffer
+		int mesh;
+		bool bUseTexture;
+		int texture;
+		int textureBinding;
+		glm::vec4 color;
+		int material;
+		// world space box around every draw of the group
+		BoundingVolumeTree::BOUNDS bounds;
+	};
+
+	// per instance values of the instanced draws, laid out as the
+	// std430 Instance struct of the shader
+	struct INSTANCE_DATA
+	{
+		glm::mat4 model;
+		glm::vec4 color;
+		glm::vec4 atlasRect;
+		glm::vec2 uvScale;
+		int material;
+		// texture array layer with the texture array backend, and
+		// bindless handle index with the bindless backend
+		int texture;
+		int bUseTexture;
+		int padding[3];
 	};
 
 	struct OBJECT_MATERIAL
@@ -48,35 +183,192 @@ public:
 private:
 	// pointer to shader manager object
 	ShaderManager* m_pShaderManager;
+	// uniform locations and last written values of the shader
+	ShaderUniformCache m_uniforms;
 	// pointer to basic shapes object
 	ShapeMeshes* m_basicMeshes;
-	// total number of loaded textures
-	int m_loadedTextures;
 	// loaded textures info
-	TEXTURE_INFO m_textureIDs[16];
+	std::vector<TEXTURE_INFO> m_textureIDs;
+	// the selected way of binding the loaded textures
+	TEXTURE_BACKEND m_textureBackend;
+	// number of textures bound to their own unit for the whole frame
+	int m_boundTextureUnits;
+	// texture arrays created by the texture array backend
+	std::vector<uint32_t> m_textureArrays;
+	// texture array currently selected in the shader
+	int m_currentTextureArray;
+	// streams cached mip levels into the textures over several frames
+	TextureStreamer m_textureStreamer;
+	// whether cached textures are streamed instead of uploaded at once
+	bool m_bStreamTextures;
+	// whether small textures were packed into texture atlas pages
+	bool m_bUseTextureAtlas;
+	// memory and usage of the textures against the texture budget
+	TextureResidency m_textureResidency;
+	// decodes the reduced and evicted textures that are drawn again,
+	// the requests waiting for the next batch, and the slots that
+	// are waiting for their reload
+	TextureDecoder m_reloadDecoder;
+	std::vector<TextureDecoder::TEXTURE_REQUEST> m_reloadRequests;
+	std::vector<int> m_reloadSlots;
+	// texture drawn in place of an evicted texture until it is back
+	uint32_t m_fallbackTextureID;
 	// defined object materials
 	std::vector<OBJECT_MATERIAL> m_objectMaterials;
+	// slots of the loaded textures and indices of the defined
+	// materials by the hash of their tags
+	std::unordered_map<uint64_t, int> m_textureSlots;
+	std::unordered_map<uint64_t, int> m_materialIndices;
+	// transforms of every draw, as nodes below the nodes of the
+	// scene objects that the draws belong to
+	SceneGraph m_sceneGraph;
+	// scene object nodes by the hash of their names
+	std::unordered_map<uint64_t, int> m_sceneObjects;
+	// draws of the scene objects, built once from the scene file
+	// and walked every frame
+	std::vector<DRAW_COMMAND> m_drawCommands;
+	// world space boxes around the draws, and the tree over them
+	// that finds the draws inside the view frustum
+	std::vector<BoundingVolumeTree::BOUNDS> m_drawBounds;
+	BoundingVolumeTree m_drawTree;
+	// the draws inside the view frustum and not hidden behind the
+	// occluders in the current frame
+	std::vector<uint32_t> m_visibleDraws;
+	// depth of the occluders drawn on the CPU, and the meshes that
+	// occluders are drawn with
+	OcclusionBuffer m_occlusionBuffer;
+	MeshGeometry::MESH_DATA m_occluderBox;
+	MeshGeometry::MESH_DATA m_occluderPlane;
+	// sort keys of the visible draws, sorted by state and depth
+	// every frame
+	std::vector<uint64_t> m_drawKeys;
+	DrawSortKeys m_drawSorter;
+	// view and projection matrices of the current frame
+	glm::mat4 m_viewMatrix;
+	glm::mat4 m_projectionMatrix;
+	// uniform buffer holding every defined material, when the
+	// shader reads the materials from a uniform block
+	uint32_t m_materialBuffer;
+	// the basic meshes in shared buffers, for the instanced draws,
+	// and the mesh in the buffers for each shape and level of detail
+	MeshBuffer m_meshBuffer;
+	int m_meshLevels[MESH_SHAPE_COUNT][MeshGeometry::DETAIL_LEVELS];
+	// the layout that the vertices of the shared buffers are in
+	MeshBuffer::VERTEX_FORMAT m_vertexFormat;
+	// shader storage buffer holding the instances of the frame, and
+	// the instances last uploaded into it
+	uint32_t m_instanceBuffer;
+	std::vector<INSTANCE_DATA> m_instances;
+	// the static draws baked into world space meshes, one mesh for
+	// each group, and the tree finding the visible groups
+	MeshBuffer m_bakedBuffer;
+	std::vector<BAKED_GROUP> m_bakedGroups;
+	BoundingVolumeTree m_bakedTree;
+	std::vector<uint32_t> m_visibleGroups;
+	// whether the static draws are baked again before the next frame
+	bool m_bBakeStaticDraws;
+	// indirect draw commands of the frame, and the buffer that
+	// they are uploaded into
+	std::vector<MeshBuffer::DRAW_ELEMENTS_COMMAND> m_indirectCommands;
+	uint32_t m_indirectBuffer;
+	// the selected way of sending the draws
+	DRAW_SUBMISSION m_drawSubmission;
 
 	// load texture images and convert to OpenGL texture data
 	bool CreateGLTexture(const char* filename, std::string tag);
+	// decode a list of texture images in parallel and upload them
+	void CreateGLTextures(const std::vector<TextureDecoder::TEXTURE_REQUEST>& requests);
+	// upload decoded texture image data into OpenGL
+	bool UploadGLTexture(TextureDecoder::DECODED_IMAGE& image);
+	// create an OpenGL texture from the levels of decoded image data
+	bool LoadGLTextureLevels(TextureDecoder::DECODED_IMAGE& image, int firstLevel, TEXTURE_INFO& textureInfo);
 	// bind loaded OpenGL textures to slots in memory
 	void BindGLTextures();
+	// pack the small loaded textures into shared atlas pages
+	bool BuildTextureAtlas();
+	// pick the texture backend supported by the shader and driver
+	TEXTURE_BACKEND SelectTextureBackend();
+	// pack the loaded textures into layers of texture arrays
+	bool BuildTextureArrays();
+	// create resident bindless handles for the loaded textures
+	bool MakeTexturesBindless();
 	// free the loaded OpenGL textures
 	void DestroyGLTextures();
+	// give back the memory of cold textures while over the budget
+	void EnforceTextureBudget();
+	// replace the texture in a slot with the levels of decoded image data
+	bool ReplaceGLTexture(int slot, TextureDecoder::DECODED_IMAGE& image, int firstLevel);
+	// reduce a texture to its small mip levels
+	bool ReduceGLTexture(int slot);
+	// free the memory of a texture until it is drawn again
+	void EvictGLTexture(int slot);
+	// queue a reduced or evicted texture to be loaded again in full
+	void QueueTextureReload(int slot);
+	// upload the reloaded textures that finished decoding, and start
+	// decoding the queued reloads
+	void UpdateTextureReloads();
+	// bind the fallback texture to a texture unit
+	void BindFallbackTexture();
+	// map the tags of the loaded textures and defined materials
+	// to their slots and indices
+	void InternTextureTags();
+	void InternMaterialTags();
 	// find a loaded texture by tag
-	int FindTextureID(std::string tag);
-	int FindTextureSlot(std::string tag);
+	int FindTextureID(const std::string& tag);
+	int FindTextureSlot(const std::string& tag);
+	int FindTextureSlot(uint64_t tagHash);
 	// find a defined material by tag
-	bool FindMaterial(std::string tag, OBJECT_MATERIAL& material);
+	int FindMaterialIndex(uint64_t tagHash);
+	bool FindMaterial(const std::string& tag, OBJECT_MATERIAL& material);
+	// find a basic mesh by the hash of its name in the scene file
+	bool FindMeshShape(uint64_t meshTag, MESH_SHAPE& shape);
+	// get the texture object that drawing a texture slot binds
+	int GetTextureBinding(int textureSlot);
+	// upload the defined materials into a uniform buffer
+	bool UploadMaterialBuffer();
+	// load the basic meshes into shared buffers for instanced and
+	// indirect drawing, and pick the way of sending the draws
+	DRAW_SUBMISSION SelectDrawSubmission();
 
-	// set the transformation values 
-	// into the transform buffer
-	void SetTransformations(
-		glm::vec3 scaleXYZ,
-		float XrotationDegrees,
-		float YrotationDegrees,
-		float ZrotationDegrees,
-		glm::vec3 positionXYZ);
+	// build the draw list from the objects of a scene file
+	void BuildDrawList(const SceneFile& scene);
+	// fit the boxes of the draws to their model matrices
+	void UpdateDrawBounds();
+	// remove the visible draws hidden behind the occluders
+	void CullOccludedDraws();
+	// bake the static opaque draws into world space meshes
+	void BakeStaticDraws();
+	// find the baked groups inside the view frustum and not hidden
+	// behind the occluders
+	void CullBakedGroups();
+	// draw the visible baked groups, whose instances follow the
+	// instances of the sorted draws
+	void RenderBakedGroups(size_t firstInstance);
+	// order the visible draws by their sort keys for the current view
+	void SortDrawList();
+	// draw the sorted draws one at a time
+	void RenderDraws();
+	// write the values of the sorted draws and the baked groups into
+	// the instance buffer
+	void WriteInstances();
+	// set the texture values of an instance from a texture slot
+	void SetInstanceTexture(INSTANCE_DATA& instance, int textureSlot);
+	// bind shared mesh buffers, with the values that unpack their
+	// vertices when they are packed
+	void BindMeshBuffer(const MeshBuffer& buffer);
+	// find the end of the run of sorted draws that can be drawn as
+	// instances together with the draw at the passed in position
+	size_t FindInstanceRun(size_t first);
+	// draw runs of sorted draws as instances of one mesh
+	void RenderInstancedDraws();
+	// draw the runs of sorted draws with a few multi draws
+	void RenderIndirectDraws();
+	// draw a basic mesh
+	void DrawShapeMesh(
+		MESH_SHAPE shape,
+		bool bDrawTop,
+		bool bDrawBottom,
+		bool bDrawSides);
 
 	// set the color values into the shader
 	void SetShaderColor(
@@ -85,40 +377,47 @@ private:
 		float blueColorValue,
 		float alphaValue);
 
-	// set the texture data into the shader
+	// set the texture data in a texture slot into the shader
 	void SetShaderTexture(
-		std::string textureTag);
+		int textureSlot);
+	// load a texture given back for the budget again and mark it
+	// as used in this frame
+	void UseTexture(int textureSlot);
 
 	// set the UV scale for the texture mapping
 	void SetTextureUVScale(
 		float u, float v);
 
-	// set the object material into the shader
+	// set the object material at an index into the shader
 	void SetShaderMaterial(
-		std::string materialTag);
+		int materialIndex);
 
 public:
 
-	// prepare the 3D scene for rendering
-	void PrepareScene();
+	// set the number of bytes that the scene textures may use
+	void SetTextureBudget(size_t budgetBytes);
+
+	// move a whole scene object, with all of its parts
+	bool SetSceneObjectTransform(
+		const std::string& name,
+		const glm::vec3& scaleXYZ,
+		float XrotationDegrees,
+		float YrotationDegrees,
+		float ZrotationDegrees,
+		const glm::vec3& positionXYZ);
+
+	// set the view and projection matrices of the current frame
+	void SetViewTransform(const glm::mat4& view, const glm::mat4& projection);
+
+	// prepare the 3D scene described by a scene file for rendering
+	bool PrepareScene(const std::string& sceneFile);
 	// render the objects in the 3D scene
 	void RenderScene();
 
 	// load all of the needed textures before rendering
-	void LoadSceneTextures();
+	void LoadSceneTextures(const SceneFile& scene);
 	// define all the object materials before rendering
-	void DefineObjectMaterials();
+	void DefineObjectMaterials(const SceneFile& scene);
 	// add and define the light sources before rendering
 	void SetupSceneLights();
-
-	// methods for rendering the various objects in the 3D scene
-	void RenderTable();
-	void RenderMug();
-	void RenderBackdrop();
-	void RenderLamp();
-	void RenderLaptop();
-	void RenderMonitor();
-	void RenderKeyboard();
-	void RenderMouse();
-	void RenderMousepad();
 };
\ No newline at end of file
@@ -0,0 +1,36 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenetags.h
+// ============
+// hash the tag strings of scene textures and materials
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/***********************************************************
+ *  HashTag()
+ *
+ *  Calculate the 64-bit FNV-1a hash of a tag string.  Tags
+ *  written as literals can be hashed by the compiler, either
+ *  through a constexpr variable or with the _tag suffix, so
+ *  drawing code can look up textures and materials without
+ *  building or comparing strings.
+ ***********************************************************/
+constexpr uint64_t HashTag(const char* tag, uint64_t hash = 14695981039346656037ULL)
+{
+	return((*tag == 0) ? hash : HashTag(tag + 1, (hash ^ (uint8_t)*tag) * 1099511628211ULL));
+}
+
+inline uint64_t HashTag(const std::string& tag)
+{
+	return(HashTag(tag.c_str()));
+}
+
+constexpr uint64_t operator"" _tag(const char* tag, size_t)
+{
+	return(HashTag(tag));
+}
@@ -0,0 +1,196 @@
+///////////////////////////////////////////////////////////////////////////////
+// shaderuniformcache.cpp
+// ============
+// cache uniform locations and skip uploads of unchanged values
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ShaderUniformCache.h"
+#include "SceneTags.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <cstring>
+
+/***********************************************************
+ *  ShaderUniformCache()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ShaderUniformCache::ShaderUniformCache()
+{
+	m_programID = 0;
+}
+
+/***********************************************************
+ *  Reset()
+ *
+ *  This method is used for forgetting every cached location
+ *  and value.
+ ***********************************************************/
+void ShaderUniformCache::Reset()
+{
+	m_programID = 0;
+	m_uniforms.clear();
+}
+
+/***********************************************************
+ *  FindUniform()
+ *
+ *  This method is used for getting the cached slot of a
+ *  uniform.  The locations belong to the program that was
+ *  current when the first uniform was set.
+ ***********************************************************/
+ShaderUniformCache::UNIFORM_SLOT& ShaderUniformCache::FindUniform(const char* name)
+{
+	if (m_programID == 0)
+	{
+		glGetIntegerv(GL_CURRENT_PROGRAM, &m_programID);
+	}
+
+	uint64_t nameHash = HashTag(name);
+	std::unordered_map<uint64_t, UNIFORM_SLOT>::iterator it = m_uniforms.find(nameHash);
+	if (it != m_uniforms.end())
+	{
+		return(it->second);
+	}
+
+	UNIFORM_SLOT uniform;
+	uniform.location = glGetUniformLocation(m_programID, name);
+	uniform.size = 0;
+	return(m_uniforms.insert(std::make_pair(nameHash, uniform)).first->second);
+}
+
+/***********************************************************
+ *  HasChanged()
+ *
+ *  This method is used for comparing a value with the last
+ *  value written to a uniform.  Uniforms that the program
+ *  does not have never change.
+ ***********************************************************/
+bool ShaderUniformCache::HasChanged(UNIFORM_SLOT& uniform, const void* value, int size)
+{
+	if (uniform.location < 0)
+	{
+		return(false);
+	}
+
+	if ((uniform.size == size) && (memcmp(uniform.value, value, size * sizeof(uint32_t)) == 0))
+	{
+		return(false);
+	}
+
+	uniform.size = size;
+	memcpy(uniform.value, value, size * sizeof(uint32_t));
+	return(true);
+}
+
+/***********************************************************
+ *  setBoolValue()
+ *
+ *  This method is used for setting a bool uniform.
+ ***********************************************************/
+void ShaderUniformCache::setBoolValue(const char* name, bool value)
+{
+	setIntValue(name, (int)value);
+}
+
+/***********************************************************
+ *  setIntValue()
+ *
+ *  This method is used for setting an int uniform.
+ ***********************************************************/
+void ShaderUniformCache::setIntValue(const char* name, int value)
+{
+	UNIFORM_SLOT& uniform = FindUniform(name);
+	if (HasChanged(uniform, &value, 1) == true)
+	{
+		glUniform1i(uniform.location, value);
+	}
+}
+
+/***********************************************************
+ *  setFloatValue()
+ *
+ *  This method is used for setting a float uniform.
+ ***********************************************************/
+void ShaderUniformCache::setFloatValue(const char* name, float value)
+{
+	UNIFORM_SLOT& uniform = FindUniform(name);
+	if (HasChanged(uniform, &value, 1) == true)
+	{
+		glUniform1f(uniform.location, value);
+	}
+}
+
+/***********************************************************
+ *  setVec2Value()
+ *
+ *  This method is used for setting a vec2 uniform.
+ ***********************************************************/
+void ShaderUniformCache::setVec2Value(const char* name, const glm::vec2& value)
+{
+	UNIFORM_SLOT& uniform = FindUniform(name);
+	if (HasChanged(uniform, glm::value_ptr(value), 2) == true)
+	{
+		glUniform2fv(uniform.location, 1, glm::value_ptr(value));
+	}
+}
+
+/***********************************************************
+ *  setVec3Value()
+ *
+ *  This method is used for setting a vec3 uniform.
+ ***********************************************************/
+void ShaderUniformCache::setVec3Value(const char* name, const glm::vec3& value)
+{
+	UNIFORM_SLOT& uniform = FindUniform(name);
+	if (HasChanged(uniform, glm::value_ptr(value), 3) == true)
+	{
+		glUniform3fv(uniform.location, 1, glm::value_ptr(value));
+	}
+}
+
+void ShaderUniformCache::setVec3Value(const char* name, float x, float y, float z)
+{
+	setVec3Value(name, glm::vec3(x, y, z));
+}
+
+/***********************************************************
+ *  setVec4Value()
+ *
+ *  This method is used for setting a vec4 uniform.
+ ***********************************************************/
+void ShaderUniformCache::setVec4Value(const char* name, const glm::vec4& value)
+{
+	UNIFORM_SLOT& uniform = FindUniform(name);
+	if (HasChanged(uniform, glm::value_ptr(value), 4) == true)
+	{
+		glUniform4fv(uniform.location, 1, glm::value_ptr(value));
+	}
+}
+
+/***********************************************************
+ *  setMat4Value()
+ *
+ *  This method is used for setting a mat4 uniform.
+ ***********************************************************/
+void ShaderUniformCache::setMat4Value(const char* name, const glm::mat4& value)
+{
+	UNIFORM_SLOT& uniform = FindUniform(name);
+	if (HasChanged(uniform, glm::value_ptr(value), 16) == true)
+	{
+		glUniformMatrix4fv(uniform.location, 1, GL_FALSE, glm::value_ptr(value));
+	}
+}
+
+/***********************************************************
+ *  setSampler2DValue()
+ *
+ *  This method is used for setting the texture unit of a
+ *  sampler uniform.
+ ***********************************************************/
+void ShaderUniformCache::setSampler2DValue(const char* name, int unit)
+{
+	setIntValue(name, unit);
+}
@@ -0,0 +1,67 @@
+///////////////////////////////////////////////////////////////////////////////
+// shaderuniformcache.h
+// ============
+// cache uniform locations and skip uploads of unchanged values
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <unordered_map>
+
+/***********************************************************
+ *  ShaderUniformCache
+ *
+ *  This class sets uniform values into the current shader
+ *  program with the same setters as the shader manager.  The
+ *  location of every uniform is looked up once, and the last
+ *  value written to each uniform is kept, so setting the
+ *  same value again does not reach OpenGL.  Only one cache
+ *  may write to a given uniform, since it cannot see values
+ *  that were written around it.
+ ***********************************************************/
+class ShaderUniformCache
+{
+public:
+	// constructor
+	ShaderUniformCache();
+
+	// forget the cached locations and values, after the shader
+	// program was changed or its uniforms were written elsewhere
+	void Reset();
+
+	void setBoolValue(const char* name, bool value);
+	void setIntValue(const char* name, int value);
+	void setFloatValue(const char* name, float value);
+	void setVec2Value(const char* name, const glm::vec2& value);
+	void setVec3Value(const char* name, const glm::vec3& value);
+	void setVec3Value(const char* name, float x, float y, float z);
+	void setVec4Value(const char* name, const glm::vec4& value);
+	void setMat4Value(const char* name, const glm::mat4& value);
+	void setSampler2DValue(const char* name, int unit);
+
+private:
+	struct UNIFORM_SLOT
+	{
+		GLint location;
+		// number of 32-bit words in the last value written
+		int size;
+		uint32_t value[16];
+	};
+
+	// find the cached slot of a uniform, looking up its location
+	// the first time that the uniform is set
+	UNIFORM_SLOT& FindUniform(const char* name);
+	// check whether a value differs from the last value written to
+	// a uniform, and keep it as the last value when it does
+	bool HasChanged(UNIFORM_SLOT& uniform, const void* value, int size);
+
+	// shader program that the locations belong to
+	GLint m_programID;
+	// cached uniforms by the hash of their names
+	std::unordered_map<uint64_t, UNIFORM_SLOT> m_uniforms;
+};
@@ -0,0 +1,189 @@
+///////////////////////////////////////////////////////////////////////////////
+// textureatlas.cpp
+// ============
+// pack small textures into shared atlas pages
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TextureAtlas.h"
+
+#include <algorithm>
+
+/***********************************************************
+ *  TextureAtlas()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TextureAtlas::TextureAtlas(int pageSize)
+{
+	m_pageSize = pageSize;
+}
+
+/***********************************************************
+ *  Pack()
+ *
+ *  This method is used for placing every rectangle on the
+ *  first page with room for it, tallest rectangles first.
+ ***********************************************************/
+int TextureAtlas::Pack(std::vector<ATLAS_RECT>& rects)
+{
+	std::vector<std::vector<SKYLINE_NODE> > pages;
+	std::vector<size_t> order(rects.size());
+
+	for (size_t i = 0; i < rects.size(); i++)
+	{
+		order[i] = i;
+		rects[i].page = -1;
+		rects[i].x = 0;
+		rects[i].y = 0;
+	}
+
+	// placing the tallest rectangles first keeps the skyline flat
+	std::stable_sort(order.begin(), order.end(),
+		[&rects](size_t a, size_t b)
+		{
+			if (rects[a].height != rects[b].height)
+				return(rects[a].height > rects[b].height);
+			return(rects[a].width > rects[b].width);
+		});
+
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		ATLAS_RECT& rect = rects[order[i]];
+
+		if ((rect.width > m_pageSize) || (rect.height > m_pageSize))
+		{
+			continue;
+		}
+
+		size_t page = 0;
+		int x = 0;
+		int y = 0;
+		int nodeIndex = 0;
+		while ((page < pages.size()) &&
+			(FindPosition(pages[page], rect.width, rect.height, x, y, nodeIndex) == false))
+		{
+			page++;
+		}
+
+		// start a new page with a flat skyline
+		if (page == pages.size())
+		{
+			SKYLINE_NODE node = { 0, 0, m_pageSize };
+			pages.push_back(std::vector<SKYLINE_NODE>(1, node));
+			FindPosition(pages[page], rect.width, rect.height, x, y, nodeIndex);
+		}
+
+		AddToSkyline(pages[page], nodeIndex, x, y, rect.width, rect.height);
+		rect.page = (int)page;
+		rect.x = x;
+		rect.y = y;
+	}
+
+	return((int)pages.size());
+}
+
+/***********************************************************
+ *  FindPosition()
+ *
+ *  This method is used for finding the lowest position, and
+ *  then the leftmost, where a rectangle rests on top of the
+ *  skyline of a page without leaving the page.
+ ***********************************************************/
+bool TextureAtlas::FindPosition(
+	const std::vector<SKYLINE_NODE>& skyline,
+	int width,
+	int height,
+	int& x,
+	int& y,
+	int& nodeIndex) const
+{
+	int bestY = m_pageSize;
+	bool bFound = false;
+
+	for (size_t i = 0; i < skyline.size(); i++)
+	{
+		int left = skyline[i].x;
+		if (left + width > m_pageSize)
+		{
+			break;
+		}
+
+		// the rectangle rests on the highest node that it spans
+		int top = 0;
+		int spanned = 0;
+		size_t j = i;
+		while (spanned < width)
+		{
+			top = std::max(top, skyline[j].y);
+			spanned += skyline[j].width;
+			j++;
+		}
+
+		if ((top + height <= m_pageSize) && (top < bestY))
+		{
+			bestY = top;
+			x = left;
+			y = top;
+			nodeIndex = (int)i;
+			bFound = true;
+		}
+	}
+
+	return(bFound);
+}
+
+/***********************************************************
+ *  AddToSkyline()
+ *
+ *  This method is used for raising the skyline of a page
+ *  over a placed rectangle, then merging neighbouring nodes
+ *  that end up at the same height.
+ ***********************************************************/
+void TextureAtlas::AddToSkyline(
+	std::vector<SKYLINE_NODE>& skyline,
+	int nodeIndex,
+	int x,
+	int y,
+	int width,
+	int height) const
+{
+	SKYLINE_NODE node = { x, y + height, width };
+	skyline.insert(skyline.begin() + nodeIndex, node);
+
+	// shrink or remove the nodes now covered by the rectangle
+	size_t i = (size_t)nodeIndex + 1;
+	while (i < skyline.size())
+	{
+		int right = skyline[i - 1].x + skyline[i - 1].width;
+		if (skyline[i].x >= right)
+		{
+			break;
+		}
+
+		int overlap = right - skyline[i].x;
+		if (overlap >= skyline[i].width)
+		{
+			skyline.erase(skyline.begin() + i);
+		}
+		else
+		{
+			skyline[i].x += overlap;
+			skyline[i].width -= overlap;
+			break;
+		}
+	}
+
+	for (size_t j = 0; j + 1 < skyline.size();)
+	{
+		if (skyline[j].y == skyline[j + 1].y)
+		{
+			skyline[j].width += skyline[j + 1].width;
+			skyline.erase(skyline.begin() + j + 1);
+		}
+		else
+		{
+			j++;
+		}
+	}
+}
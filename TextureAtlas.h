@@ -0,0 +1,56 @@
+///////////////////////////////////////////////////////////////////////////////
+// textureatlas.h
+// ============
+// pack small textures into shared atlas pages
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <vector>
+
+/***********************************************************
+ *  TextureAtlas
+ *
+ *  This class places rectangles onto square atlas pages with
+ *  skyline bottom-left packing.  The tallest rectangles are
+ *  placed first, and a new page is started whenever none of
+ *  the existing pages has room for a rectangle.
+ ***********************************************************/
+class TextureAtlas
+{
+public:
+	// constructor
+	TextureAtlas(int pageSize);
+
+	struct ATLAS_RECT
+	{
+		// size of the rectangle, including any padding
+		int width;
+		int height;
+		// placement on the pages, set by Pack() - the page is -1
+		// for rectangles that are larger than a page
+		int page;
+		int x;
+		int y;
+	};
+
+	// place the rectangles and return the number of pages used
+	int Pack(std::vector<ATLAS_RECT>& rects);
+
+private:
+	struct SKYLINE_NODE
+	{
+		int x;
+		int y;
+		int width;
+	};
+
+	// find the lowest position on a page skyline for a rectangle
+	bool FindPosition(const std::vector<SKYLINE_NODE>& skyline, int width, int height, int& x, int& y, int& nodeIndex) const;
+	// raise the skyline of a page over a placed rectangle
+	void AddToSkyline(std::vector<SKYLINE_NODE>& skyline, int nodeIndex, int x, int y, int width, int height) const;
+
+	// width and height of each page
+	int m_pageSize;
+};
@@ -0,0 +1,573 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturecache.cpp
+// ============
+// store decoded texture images with their full mip chain on disk
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TextureCache.h"
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <direct.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// declare the global variables
+namespace
+{
+	const char* g_CacheDirectory = "Debug/texcache";
+	const char* g_CacheExtension = ".tcache";
+
+	const uint32_t CACHE_MAGIC = 0x31435854; // "TXC1"
+	const uint32_t CACHE_VERSION = 1;
+	// the pixel data of every mip level starts on this alignment
+	const uint64_t LEVEL_ALIGNMENT = 16;
+
+	struct CACHE_HEADER
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint64_t sourceSize;
+		int64_t sourceTime;
+		uint64_t contentHash;
+		uint32_t width;
+		uint32_t height;
+		uint32_t colorChannels;
+		uint32_t mipCount;
+		uint32_t pathLength;
+		uint32_t reserved;
+	};
+
+	struct CACHE_LEVEL
+	{
+		uint32_t width;
+		uint32_t height;
+		uint64_t offset;
+		uint64_t size;
+	};
+
+	uint64_t AlignOffset(uint64_t offset)
+	{
+		return((offset + LEVEL_ALIGNMENT - 1) & ~(LEVEL_ALIGNMENT - 1));
+	}
+
+	// the source path is stored after the header, padded to 8 bytes
+	uint64_t GetLevelTableOffset(uint32_t pathLength)
+	{
+		return(sizeof(CACHE_HEADER) + ((pathLength + 7) & ~7u));
+	}
+
+	/***********************************************************
+	 *  DownsampleLevel()
+	 *
+	 *  Build the next mip level with a 2x2 box filter.  Odd
+	 *  sized levels clamp the second sample to the last row
+	 *  or column.
+	 ***********************************************************/
+	void DownsampleLevel(
+		const unsigned char* source, int sourceWidth, int sourceHeight,
+		unsigned char* target, int targetWidth, int targetHeight,
+		int colorChannels)
+	{
+		for (int y = 0; y < targetHeight; y++)
+		{
+			int y0 = y * 2;
+			int y1 = (y0 + 1 < sourceHeight) ? y0 + 1 : sourceHeight - 1;
+			const unsigned char* row0 = source + (size_t)y0 * sourceWidth * colorChannels;
+			const unsigned char* row1 = source + (size_t)y1 * sourceWidth * colorChannels;
+			unsigned char* out = target + (size_t)y * targetWidth * colorChannels;
+
+			for (int x = 0; x < targetWidth; x++)
+			{
+				int x0 = x * 2;
+				int x1 = (x0 + 1 < sourceWidth) ? x0 + 1 : sourceWidth - 1;
+				for (int c = 0; c < colorChannels; c++)
+				{
+					int sum =
+						row0[x0 * colorChannels + c] + row0[x1 * colorChannels + c] +
+						row1[x0 * colorChannels + c] + row1[x1 * colorChannels + c];
+					out[x * colorChannels + c] = (unsigned char)((sum + 2) >> 2);
+				}
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  Load()
+ *
+ *  This method is used for mapping the cache file of the
+ *  passed in source image.  The cache file is only used when
+ *  it was built from the same path, and either the size and
+ *  modification time of the source still match, or the
+ *  content hash of the source still matches.
+ ***********************************************************/
+bool TextureCache::Load(const std::string& sourceFile, CACHED_IMAGE& image)
+{
+	uint64_t sourceSize = 0;
+	int64_t sourceTime = 0;
+	std::string cacheFile = GetCachePath(sourceFile);
+
+	image.compressedFormat = 0;
+	image.mipLevels.clear();
+	image.mappedData = NULL;
+	image.mappedSize = 0;
+	image.fileHandle = NULL;
+	image.mappingHandle = NULL;
+
+	if ((GetFileStamp(sourceFile, sourceSize, sourceTime) == false) ||
+		(MapFile(cacheFile, image) == false))
+	{
+		return(false);
+	}
+
+	const unsigned char* data = (const unsigned char*)image.mappedData;
+	CACHE_HEADER header;
+	bool bValid = (image.mappedSize >= sizeof(CACHE_HEADER));
+
+	if (bValid == true)
+	{
+		memcpy(&header, data, sizeof(CACHE_HEADER));
+		bValid = (header.magic == CACHE_MAGIC) &&
+			(header.version == CACHE_VERSION) &&
+			(header.mipCount > 0) &&
+			(header.pathLength == sourceFile.size()) &&
+			(GetLevelTableOffset(header.pathLength) +
+				header.mipCount * sizeof(CACHE_LEVEL) <= image.mappedSize);
+	}
+	// the file names of the cache are hashed, so check that the
+	// cache file really belongs to this source image
+	if (bValid == true)
+	{
+		bValid = (memcmp(data + sizeof(CACHE_HEADER), sourceFile.c_str(), header.pathLength) == 0);
+	}
+	if (bValid == false)
+	{
+		Release(image);
+		return(false);
+	}
+
+	// a source file that was touched, copied or checked out again
+	// keeps using the cache as long as its content did not change
+	if ((header.sourceSize != sourceSize) || (header.sourceTime != sourceTime))
+	{
+		uint64_t contentHash = 0;
+		Release(image);
+
+		if ((header.sourceSize != sourceSize) ||
+			(HashFile(sourceFile, contentHash) == false) ||
+			(contentHash != header.contentHash))
+		{
+			return(false);
+		}
+
+		// remember the new time stamp so the hash is only checked once
+		UpdateStamp(cacheFile, sourceSize, sourceTime);
+		if (MapFile(cacheFile, image) == false)
+		{
+			return(false);
+		}
+		data = (const unsigned char*)image.mappedData;
+	}
+
+	const unsigned char* levelTable = data + GetLevelTableOffset(header.pathLength);
+	for (uint32_t i = 0; i < header.mipCount; i++)
+	{
+		CACHE_LEVEL level;
+		memcpy(&level, levelTable + i * sizeof(CACHE_LEVEL), sizeof(CACHE_LEVEL));
+
+		if (level.offset + level.size > image.mappedSize)
+		{
+			Release(image);
+			return(false);
+		}
+
+		MIP_LEVEL mipLevel;
+		mipLevel.width = level.width;
+		mipLevel.height = level.height;
+		mipLevel.size = (size_t)level.size;
+		mipLevel.pixels = data + level.offset;
+		image.mipLevels.push_back(mipLevel);
+	}
+
+	image.width = header.width;
+	image.height = header.height;
+	image.colorChannels = header.colorChannels;
+	image.compressedFormat = 0;
+
+	return(true);
+}
+
+/***********************************************************
+ *  Store()
+ *
+ *  This method is used for building the full mip chain of a
+ *  decoded image and writing it into the cache file of the
+ *  source image.  The file is written under a temporary name
+ *  first so that a partly written file is never mapped.
+ ***********************************************************/
+bool TextureCache::Store(
+	const std::string& sourceFile,
+	uint64_t contentHash,
+	int width,
+	int height,
+	int colorChannels,
+	const unsigned char* pixels)
+{
+	CACHE_HEADER header;
+	std::vector<CACHE_LEVEL> levels;
+	std::vector<std::vector<unsigned char> > mipPixels;
+	uint64_t offset = 0;
+
+	memset(&header, 0, sizeof(CACHE_HEADER));
+	header.magic = CACHE_MAGIC;
+	header.version = CACHE_VERSION;
+	header.contentHash = contentHash;
+	header.width = width;
+	header.height = height;
+	header.colorChannels = colorChannels;
+	header.pathLength = (uint32_t)sourceFile.size();
+
+	if ((pixels == NULL) ||
+		(GetFileStamp(sourceFile, header.sourceSize, header.sourceTime) == false))
+	{
+		return(false);
+	}
+
+	// calculate the size of every level down to 1x1
+	int levelWidth = width;
+	int levelHeight = height;
+	while (true)
+	{
+		CACHE_LEVEL level;
+		level.width = levelWidth;
+		level.height = levelHeight;
+		level.size = (uint64_t)levelWidth * levelHeight * colorChannels;
+		level.offset = 0;
+		levels.push_back(level);
+
+		if ((levelWidth == 1) && (levelHeight == 1))
+		{
+			break;
+		}
+		levelWidth = (levelWidth > 1) ? levelWidth / 2 : 1;
+		levelHeight = (levelHeight > 1) ? levelHeight / 2 : 1;
+	}
+	header.mipCount = (uint32_t)levels.size();
+
+	offset = GetLevelTableOffset(header.pathLength) + levels.size() * sizeof(CACHE_LEVEL);
+	for (size_t i = 0; i < levels.size(); i++)
+	{
+		offset = AlignOffset(offset);
+		levels[i].offset = offset;
+		offset += levels[i].size;
+	}
+
+	// build the smaller levels from the previous level
+	mipPixels.resize(levels.size());
+	for (size_t i = 1; i < levels.size(); i++)
+	{
+		const unsigned char* source = (i == 1) ? pixels : mipPixels[i - 1].data();
+		mipPixels[i].resize((size_t)levels[i].size);
+		DownsampleLevel(
+			source, levels[i - 1].width, levels[i - 1].height,
+			mipPixels[i].data(), levels[i].width, levels[i].height,
+			colorChannels);
+	}
+
+#ifdef _WIN32
+	_mkdir(g_CacheDirectory);
+#else
+	mkdir(g_CacheDirectory, 0755);
+#endif
+
+	std::string cacheFile = GetCachePath(sourceFile);
+	std::string tempFile = cacheFile + ".tmp";
+	FILE* file = fopen(tempFile.c_str(), "wb");
+	if (file == NULL)
+	{
+		return(false);
+	}
+
+	static const unsigned char padding[LEVEL_ALIGNMENT] = { 0 };
+	uint64_t written = 0;
+	bool bReturn = true;
+
+	bReturn &= (fwrite(&header, sizeof(CACHE_HEADER), 1, file) == 1);
+	bReturn &= (fwrite(sourceFile.c_str(), 1, header.pathLength, file) == header.pathLength);
+	written = sizeof(CACHE_HEADER) + header.pathLength;
+	bReturn &= (fwrite(padding, 1, (size_t)(GetLevelTableOffset(header.pathLength) - written), file) ==
+		(size_t)(GetLevelTableOffset(header.pathLength) - written));
+	bReturn &= (fwrite(levels.data(), sizeof(CACHE_LEVEL), levels.size(), file) == levels.size());
+	written = GetLevelTableOffset(header.pathLength) + levels.size() * sizeof(CACHE_LEVEL);
+
+	for (size_t i = 0; (i < levels.size()) && (bReturn == true); i++)
+	{
+		const unsigned char* levelPixels = (i == 0) ? pixels : mipPixels[i].data();
+
+		bReturn &= (fwrite(padding, 1, (size_t)(levels[i].offset - written), file) ==
+			(size_t)(levels[i].offset - written));
+		bReturn &= (fwrite(levelPixels, 1, (size_t)levels[i].size, file) == (size_t)levels[i].size);
+		written = levels[i].offset + levels[i].size;
+	}
+
+	fclose(file);
+
+	if (bReturn == true)
+	{
+		remove(cacheFile.c_str());
+		bReturn = (rename(tempFile.c_str(), cacheFile.c_str()) == 0);
+	}
+	if (bReturn == false)
+	{
+		remove(tempFile.c_str());
+	}
+
+	return(bReturn);
+}
+
+/***********************************************************
+ *  Release()
+ *
+ *  This method is used for unmapping a loaded cache file.
+ ***********************************************************/
+void TextureCache::Release(CACHED_IMAGE& image)
+{
+#ifdef _WIN32
+	if (image.mappedData != NULL)
+	{
+		UnmapViewOfFile(image.mappedData);
+	}
+	if (image.mappingHandle != NULL)
+	{
+		CloseHandle((HANDLE)image.mappingHandle);
+	}
+	if (image.fileHandle != NULL)
+	{
+		CloseHandle((HANDLE)image.fileHandle);
+	}
+#else
+	if (image.mappedData != NULL)
+	{
+		munmap(image.mappedData, image.mappedSize);
+	}
+#endif
+
+	image.mipLevels.clear();
+	image.mappedData = NULL;
+	image.mappedSize = 0;
+	image.fileHandle = NULL;
+	image.mappingHandle = NULL;
+}
+
+/***********************************************************
+ *  HashBytes()
+ *
+ *  This method is used for calculating the 64-bit FNV-1a
+ *  hash of a block of memory.
+ ***********************************************************/
+uint64_t TextureCache::HashBytes(const unsigned char* data, size_t size)
+{
+	uint64_t hash = 14695981039346656037ULL;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= data[i];
+		hash *= 1099511628211ULL;
+	}
+	return(hash);
+}
+
+/***********************************************************
+ *  GetCachePath()
+ *
+ *  This method is used for getting the path of the cache
+ *  file that belongs to the passed in source image.
+ ***********************************************************/
+std::string TextureCache::GetCachePath(const std::string& sourceFile)
+{
+	char name[17];
+	uint64_t hash = HashBytes((const unsigned char*)sourceFile.c_str(), sourceFile.size());
+
+	snprintf(name, sizeof(name), "%016llx", (unsigned long long)hash);
+
+	return(std::string(g_CacheDirectory) + "/" + name + g_CacheExtension);
+}
+
+/***********************************************************
+ *  GetFileStamp()
+ *
+ *  This method is used for getting the size and the last
+ *  modification time of a file.
+ ***********************************************************/
+bool TextureCache::GetFileStamp(const std::string& filename, uint64_t& size, int64_t& time)
+{
+#ifdef _WIN32
+	struct _stat64 fileInfo;
+	if (_stat64(filename.c_str(), &fileInfo) != 0)
+	{
+		return(false);
+	}
+#else
+	struct stat fileInfo;
+	if (stat(filename.c_str(), &fileInfo) != 0)
+	{
+		return(false);
+	}
+#endif
+
+	size = (uint64_t)fileInfo.st_size;
+	time = (int64_t)fileInfo.st_mtime;
+
+	return(true);
+}
+
+/***********************************************************
+ *  ReadFile()
+ *
+ *  This method is used for reading the whole contents of a
+ *  file into memory.
+ ***********************************************************/
+bool TextureCache::ReadFile(const std::string& filename, std::vector<unsigned char>& contents)
+{
+	FILE* file = fopen(filename.c_str(), "rb");
+	if (file == NULL)
+	{
+		return(false);
+	}
+
+	unsigned char buffer[65536];
+	size_t bytesRead = 0;
+
+	contents.clear();
+	while ((bytesRead = fread(buffer, 1, sizeof(buffer), file)) > 0)
+	{
+		contents.insert(contents.end(), buffer, buffer + bytesRead);
+	}
+	fclose(file);
+
+	return(true);
+}
+
+/***********************************************************
+ *  HashFile()
+ *
+ *  This method is used for calculating the content hash of
+ *  a whole file.
+ ***********************************************************/
+bool TextureCache::HashFile(const std::string& filename, uint64_t& hash)
+{
+	std::vector<unsigned char> contents;
+	if (ReadFile(filename, contents) == false)
+	{
+		return(false);
+	}
+
+	hash = HashBytes(contents.data(), contents.size());
+
+	return(true);
+}
+
+/***********************************************************
+ *  UpdateStamp()
+ *
+ *  This method is used for writing a new source size and
+ *  modification time into the header of a cache file.
+ ***********************************************************/
+bool TextureCache::UpdateStamp(const std::string& cacheFile, uint64_t size, int64_t time)
+{
+	FILE* file = fopen(cacheFile.c_str(), "r+b");
+	if (file == NULL)
+	{
+		return(false);
+	}
+
+	bool bReturn = (fseek(file, offsetof(CACHE_HEADER, sourceSize), SEEK_SET) == 0);
+	bReturn &= (fwrite(&size, sizeof(size), 1, file) == 1);
+	bReturn &= (fwrite(&time, sizeof(time), 1, file) == 1);
+	fclose(file);
+
+	return(bReturn);
+}
+
+/***********************************************************
+ *  MapFile()
+ *
+ *  This method is used for mapping a whole file read-only
+ *  into memory.
+ ***********************************************************/
+bool TextureCache::MapFile(const std::string& filename, CACHED_IMAGE& image)
+{
+#ifdef _WIN32
+	HANDLE file = CreateFileA(
+		filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return(false);
+	}
+
+	LARGE_INTEGER fileSize;
+	if ((GetFileSizeEx(file, &fileSize) == FALSE) || (fileSize.QuadPart == 0))
+	{
+		CloseHandle(file);
+		return(false);
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping == NULL)
+	{
+		CloseHandle(file);
+		return(false);
+	}
+
+	void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (data == NULL)
+	{
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return(false);
+	}
+
+	image.mappedData = data;
+	image.mappedSize = (size_t)fileSize.QuadPart;
+	image.fileHandle = file;
+	image.mappingHandle = mapping;
+#else
+	int file = open(filename.c_str(), O_RDONLY);
+	if (file < 0)
+	{
+		return(false);
+	}
+
+	struct stat fileInfo;
+	if ((fstat(file, &fileInfo) != 0) || (fileInfo.st_size == 0))
+	{
+		close(file);
+		return(false);
+	}
+
+	void* data = mmap(NULL, (size_t)fileInfo.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+	// the mapping stays valid after the descriptor is closed
+	close(file);
+	if (data == MAP_FAILED)
+	{
+		return(false);
+	}
+
+	image.mappedData = data;
+	image.mappedSize = (size_t)fileInfo.st_size;
+#endif
+
+	return(true);
+}
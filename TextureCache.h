@@ -0,0 +1,80 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturecache.h
+// ============
+// store decoded texture images with their full mip chain on disk
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  TextureCache
+ *
+ *  This class manages a directory of pre-decoded texture
+ *  files.  Each cache file holds the decoded pixels of one
+ *  source image plus its full mip chain, and is keyed by the
+ *  source path, modification time and content hash.  Cache
+ *  hits are memory mapped so that the texture upload reads
+ *  straight from the mapped pages.
+ ***********************************************************/
+class TextureCache
+{
+public:
+	struct MIP_LEVEL
+	{
+		int width;
+		int height;
+		size_t size;
+		const unsigned char* pixels;
+	};
+
+	struct CACHED_IMAGE
+	{
+		int width;
+		int height;
+		int colorChannels;
+		// OpenGL compressed format of the levels, or 0 for raw pixels
+		uint32_t compressedFormat;
+		// mip levels, pointing into the mapped cache file
+		std::vector<MIP_LEVEL> mipLevels;
+		// memory mapping of the cache file
+		void* mappedData;
+		size_t mappedSize;
+		void* fileHandle;
+		void* mappingHandle;
+	};
+
+	// try to map the cache file for the passed in source image
+	static bool Load(const std::string& sourceFile, CACHED_IMAGE& image);
+	// build the mip chain for decoded pixels and write the cache file
+	static bool Store(
+		const std::string& sourceFile,
+		uint64_t contentHash,
+		int width,
+		int height,
+		int colorChannels,
+		const unsigned char* pixels);
+	// unmap a previously loaded cache file
+	static void Release(CACHED_IMAGE& image);
+
+	// calculate the content hash of a block of memory
+	static uint64_t HashBytes(const unsigned char* data, size_t size);
+	// read the whole contents of a file into memory
+	static bool ReadFile(const std::string& filename, std::vector<unsigned char>& contents);
+	// get the size and modification time of a file
+	static bool GetFileStamp(const std::string& filename, uint64_t& size, int64_t& time);
+	// map a whole file read-only into memory
+	static bool MapFile(const std::string& filename, CACHED_IMAGE& image);
+
+private:
+	// get the path of the cache file for a source image
+	static std::string GetCachePath(const std::string& sourceFile);
+	// calculate the content hash of a whole file
+	static bool HashFile(const std::string& filename, uint64_t& hash);
+	// write a new size and modification time into a cache file
+	static bool UpdateStamp(const std::string& cacheFile, uint64_t size, int64_t time);
+};
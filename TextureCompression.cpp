@@ -0,0 +1,899 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturecompression.cpp
+// ============
+// build mip chains and encode them into block compressed textures
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TextureCompression.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define TEXTURE_COMPRESSION_SSE2
+#include <emmintrin.h>
+#endif
+
+// declare the global variables
+namespace
+{
+	const char* g_ContainerExtension = ".ctex";
+
+	const uint32_t CONTAINER_MAGIC = 0x31585443; // "CTX1"
+	const uint32_t CONTAINER_VERSION = 1;
+	const uint64_t LEVEL_ALIGNMENT = 16;
+
+	// taps on each side of the Kaiser filter, in source pixels
+	const int KAISER_HALF_TAPS = 4;
+	const float KAISER_ALPHA = 4.0f;
+
+	// BC7 interpolation weights for 4-bit indices
+	const int g_BC7Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	struct CONTAINER_HEADER
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t format;
+		uint32_t width;
+		uint32_t height;
+		uint32_t mipCount;
+		uint64_t sourceSize;
+		int64_t sourceTime;
+	};
+
+	struct CONTAINER_LEVEL
+	{
+		uint32_t width;
+		uint32_t height;
+		uint64_t offset;
+		uint64_t size;
+	};
+
+	/***********************************************************
+	 *  Gamma conversion helpers
+	 ***********************************************************/
+	float SRGBToLinear(float value)
+	{
+		return((value <= 0.04045f) ? value / 12.92f : powf((value + 0.055f) / 1.055f, 2.4f));
+	}
+
+	float LinearToSRGB(float value)
+	{
+		value = std::min(std::max(value, 0.0f), 1.0f);
+		return((value <= 0.0031308f) ? value * 12.92f : 1.055f * powf(value, 1.0f / 2.4f) - 0.055f);
+	}
+
+	unsigned char ToByte(float value)
+	{
+		return((unsigned char)(std::min(std::max(value, 0.0f), 1.0f) * 255.0f + 0.5f));
+	}
+
+	/***********************************************************
+	 *  BesselI0()
+	 *
+	 *  Zeroth order modified Bessel function of the first
+	 *  kind, used by the Kaiser window.
+	 ***********************************************************/
+	double BesselI0(double x)
+	{
+		double sum = 1.0;
+		double term = 1.0;
+		for (int k = 1; k < 32; k++)
+		{
+			term *= (x / (2.0 * k)) * (x / (2.0 * k));
+			sum += term;
+		}
+		return(sum);
+	}
+
+	struct FILTER_TAPS
+	{
+		int first;
+		float weights[2 * KAISER_HALF_TAPS];
+		int count;
+	};
+
+	/***********************************************************
+	 *  BuildKaiserTaps()
+	 *
+	 *  Build the Kaiser windowed sinc taps for halving one
+	 *  dimension.  Taps outside the image are folded onto the
+	 *  nearest edge pixel by the caller.
+	 ***********************************************************/
+	void BuildKaiserTaps(int sourceSize, int targetSize, std::vector<FILTER_TAPS>& taps)
+	{
+		taps.resize(targetSize);
+		for (int i = 0; i < targetSize; i++)
+		{
+			FILTER_TAPS& tap = taps[i];
+			if (sourceSize == targetSize)
+			{
+				tap.first = i;
+				tap.weights[0] = 1.0f;
+				tap.count = 1;
+				continue;
+			}
+
+			double center = 2.0 * i + 1.0;
+			double total = 0.0;
+			tap.first = 2 * i + 1 - KAISER_HALF_TAPS;
+			tap.count = 2 * KAISER_HALF_TAPS;
+			for (int t = 0; t < tap.count; t++)
+			{
+				// distance in target pixels from the output center
+				double x = ((tap.first + t) + 0.5 - center) * 0.5;
+				double window = x / (KAISER_HALF_TAPS * 0.5);
+				double sinc = (fabs(x) < 1e-6) ? 1.0 : sin(3.14159265358979 * x) / (3.14159265358979 * x);
+				double kaiser = (fabs(window) >= 1.0) ? 0.0 :
+					BesselI0(KAISER_ALPHA * sqrt(1.0 - window * window)) / BesselI0(KAISER_ALPHA);
+				tap.weights[t] = (float)(sinc * kaiser);
+				total += tap.weights[t];
+			}
+			for (int t = 0; t < tap.count; t++)
+			{
+				tap.weights[t] = (float)(tap.weights[t] / total);
+			}
+		}
+	}
+
+	/***********************************************************
+	 *  Accumulate()
+	 *
+	 *  Add a weighted linear RGBA pixel into an accumulator.
+	 ***********************************************************/
+	inline void Accumulate(float* target, const float* source, float weight)
+	{
+#ifdef TEXTURE_COMPRESSION_SSE2
+		_mm_storeu_ps(target, _mm_add_ps(_mm_loadu_ps(target), _mm_mul_ps(_mm_loadu_ps(source), _mm_set1_ps(weight))));
+#else
+		target[0] += source[0] * weight;
+		target[1] += source[1] * weight;
+		target[2] += source[2] * weight;
+		target[3] += source[3] * weight;
+#endif
+	}
+
+	/***********************************************************
+	 *  DownsampleBox()
+	 *
+	 *  Halve a linear RGBA level with a 2x2 box filter.  Each
+	 *  pixel is processed as one SSE vector when available.
+	 ***********************************************************/
+	void DownsampleBox(
+		const std::vector<float>& source, int sourceWidth, int sourceHeight,
+		std::vector<float>& target, int targetWidth, int targetHeight)
+	{
+		target.assign((size_t)targetWidth * targetHeight * 4, 0.0f);
+		for (int y = 0; y < targetHeight; y++)
+		{
+			int y0 = std::min(y * 2, sourceHeight - 1);
+			int y1 = std::min(y * 2 + 1, sourceHeight - 1);
+			for (int x = 0; x < targetWidth; x++)
+			{
+				int x0 = std::min(x * 2, sourceWidth - 1);
+				int x1 = std::min(x * 2 + 1, sourceWidth - 1);
+				const float* p00 = &source[((size_t)y0 * sourceWidth + x0) * 4];
+				const float* p01 = &source[((size_t)y0 * sourceWidth + x1) * 4];
+				const float* p10 = &source[((size_t)y1 * sourceWidth + x0) * 4];
+				const float* p11 = &source[((size_t)y1 * sourceWidth + x1) * 4];
+				float* out = &target[((size_t)y * targetWidth + x) * 4];
+#ifdef TEXTURE_COMPRESSION_SSE2
+				__m128 sum = _mm_add_ps(
+					_mm_add_ps(_mm_loadu_ps(p00), _mm_loadu_ps(p01)),
+					_mm_add_ps(_mm_loadu_ps(p10), _mm_loadu_ps(p11)));
+				_mm_storeu_ps(out, _mm_mul_ps(sum, _mm_set1_ps(0.25f)));
+#else
+				for (int c = 0; c < 4; c++)
+				{
+					out[c] = (p00[c] + p01[c] + p10[c] + p11[c]) * 0.25f;
+				}
+#endif
+			}
+		}
+	}
+
+	/***********************************************************
+	 *  DownsampleKaiser()
+	 *
+	 *  Halve a linear RGBA level with a separable Kaiser
+	 *  windowed sinc filter - horizontal pass, then vertical.
+	 ***********************************************************/
+	void DownsampleKaiser(
+		const std::vector<float>& source, int sourceWidth, int sourceHeight,
+		std::vector<float>& target, int targetWidth, int targetHeight)
+	{
+		std::vector<FILTER_TAPS> horizontalTaps;
+		std::vector<FILTER_TAPS> verticalTaps;
+		std::vector<float> temp((size_t)targetWidth * sourceHeight * 4, 0.0f);
+
+		BuildKaiserTaps(sourceWidth, targetWidth, horizontalTaps);
+		BuildKaiserTaps(sourceHeight, targetHeight, verticalTaps);
+
+		for (int y = 0; y < sourceHeight; y++)
+		{
+			for (int x = 0; x < targetWidth; x++)
+			{
+				const FILTER_TAPS& tap = horizontalTaps[x];
+				float* out = &temp[((size_t)y * targetWidth + x) * 4];
+				for (int t = 0; t < tap.count; t++)
+				{
+					int sx = std::min(std::max(tap.first + t, 0), sourceWidth - 1);
+					Accumulate(out, &source[((size_t)y * sourceWidth + sx) * 4], tap.weights[t]);
+				}
+			}
+		}
+
+		target.assign((size_t)targetWidth * targetHeight * 4, 0.0f);
+		for (int y = 0; y < targetHeight; y++)
+		{
+			const FILTER_TAPS& tap = verticalTaps[y];
+			for (int t = 0; t < tap.count; t++)
+			{
+				int sy = std::min(std::max(tap.first + t, 0), sourceHeight - 1);
+				for (int x = 0; x < targetWidth; x++)
+				{
+					Accumulate(
+						&target[((size_t)y * targetWidth + x) * 4],
+						&temp[((size_t)sy * targetWidth + x) * 4],
+						tap.weights[t]);
+				}
+			}
+		}
+	}
+
+	/***********************************************************
+	 *  FitEndpoints()
+	 *
+	 *  Find the two block endpoints along the principal axis
+	 *  of the block colors.  The axis is found with a few power
+	 *  iterations on the covariance matrix.
+	 ***********************************************************/
+	void FitEndpoints(const unsigned char* block, int channels, float endpoint0[4], float endpoint1[4])
+	{
+		float mean[4] = { 0, 0, 0, 0 };
+		float covariance[4][4] = { { 0 } };
+		float axis[4] = { 1, 1, 1, 1 };
+
+		for (int i = 0; i < 16; i++)
+			for (int c = 0; c < channels; c++)
+				mean[c] += block[i * 4 + c] / 16.0f;
+
+		for (int i = 0; i < 16; i++)
+			for (int a = 0; a < channels; a++)
+				for (int b = 0; b < channels; b++)
+					covariance[a][b] += (block[i * 4 + a] - mean[a]) * (block[i * 4 + b] - mean[b]);
+
+		for (int iteration = 0; iteration < 8; iteration++)
+		{
+			float next[4] = { 0, 0, 0, 0 };
+			float largest = 0.0f;
+			for (int a = 0; a < channels; a++)
+			{
+				for (int b = 0; b < channels; b++)
+					next[a] += covariance[a][b] * axis[b];
+				largest = std::max(largest, fabsf(next[a]));
+			}
+			if (largest < 1e-6f)
+				break;
+			for (int a = 0; a < channels; a++)
+				axis[a] = next[a] / largest;
+		}
+
+		float length = 0.0f;
+		for (int c = 0; c < channels; c++)
+			length += axis[c] * axis[c];
+		length = sqrtf(length);
+		for (int c = 0; c < channels; c++)
+			axis[c] /= length;
+
+		float minimum = 1e30f;
+		float maximum = -1e30f;
+		for (int i = 0; i < 16; i++)
+		{
+			float projection = 0.0f;
+			for (int c = 0; c < channels; c++)
+				projection += (block[i * 4 + c] - mean[c]) * axis[c];
+			minimum = std::min(minimum, projection);
+			maximum = std::max(maximum, projection);
+		}
+
+		for (int c = 0; c < 4; c++)
+		{
+			endpoint0[c] = (c < channels) ? std::min(std::max(mean[c] + axis[c] * maximum, 0.0f), 255.0f) : 255.0f;
+			endpoint1[c] = (c < channels) ? std::min(std::max(mean[c] + axis[c] * minimum, 0.0f), 255.0f) : 255.0f;
+		}
+	}
+
+	uint16_t Pack565(const float color[4])
+	{
+		int r = (int)(color[0] * 31.0f / 255.0f + 0.5f);
+		int g = (int)(color[1] * 63.0f / 255.0f + 0.5f);
+		int b = (int)(color[2] * 31.0f / 255.0f + 0.5f);
+		return((uint16_t)((r << 11) | (g << 5) | b));
+	}
+
+	void Unpack565(uint16_t packed, int color[3])
+	{
+		int r = (packed >> 11) & 31;
+		int g = (packed >> 5) & 63;
+		int b = packed & 31;
+		color[0] = (r << 3) | (r >> 2);
+		color[1] = (g << 2) | (g >> 4);
+		color[2] = (b << 3) | (b >> 2);
+	}
+
+	/***********************************************************
+	 *  EncodeColorBlock()
+	 *
+	 *  Encode the colors of a 4x4 RGBA block as a BC1 block in
+	 *  four color mode.
+	 ***********************************************************/
+	void EncodeColorBlock(const unsigned char* block, unsigned char* output)
+	{
+		float endpoint0[4];
+		float endpoint1[4];
+		FitEndpoints(block, 3, endpoint0, endpoint1);
+
+		uint16_t color0 = Pack565(endpoint0);
+		uint16_t color1 = Pack565(endpoint1);
+		if (color0 < color1)
+		{
+			std::swap(color0, color1);
+		}
+
+		uint32_t indices = 0;
+		if (color0 != color1)
+		{
+			int palette[4][3];
+			Unpack565(color0, palette[0]);
+			Unpack565(color1, palette[1]);
+			for (int c = 0; c < 3; c++)
+			{
+				palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+				palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+			}
+
+			for (int i = 0; i < 16; i++)
+			{
+				int bestIndex = 0;
+				int bestError = 0x7fffffff;
+				for (int p = 0; p < 4; p++)
+				{
+					int error = 0;
+					for (int c = 0; c < 3; c++)
+					{
+						int delta = block[i * 4 + c] - palette[p][c];
+						error += delta * delta;
+					}
+					if (error < bestError)
+					{
+						bestError = error;
+						bestIndex = p;
+					}
+				}
+				indices |= (uint32_t)bestIndex << (i * 2);
+			}
+		}
+
+		output[0] = (unsigned char)(color0 & 0xff);
+		output[1] = (unsigned char)(color0 >> 8);
+		output[2] = (unsigned char)(color1 & 0xff);
+		output[3] = (unsigned char)(color1 >> 8);
+		for (int i = 0; i < 4; i++)
+		{
+			output[4 + i] = (unsigned char)(indices >> (i * 8));
+		}
+	}
+
+	/***********************************************************
+	 *  EncodeAlphaBlock()
+	 *
+	 *  Encode the alpha values of a 4x4 RGBA block as a BC3
+	 *  alpha block in eight value mode.
+	 ***********************************************************/
+	void EncodeAlphaBlock(const unsigned char* block, unsigned char* output)
+	{
+		int alpha0 = 0;
+		int alpha1 = 255;
+		for (int i = 0; i < 16; i++)
+		{
+			alpha0 = std::max(alpha0, (int)block[i * 4 + 3]);
+			alpha1 = std::min(alpha1, (int)block[i * 4 + 3]);
+		}
+
+		uint64_t indices = 0;
+		if (alpha0 != alpha1)
+		{
+			int palette[8];
+			palette[0] = alpha0;
+			palette[1] = alpha1;
+			for (int k = 1; k < 7; k++)
+			{
+				palette[k + 1] = ((7 - k) * alpha0 + k * alpha1) / 7;
+			}
+
+			for (int i = 0; i < 16; i++)
+			{
+				int bestIndex = 0;
+				int bestError = 0x7fffffff;
+				for (int p = 0; p < 8; p++)
+				{
+					int error = abs(block[i * 4 + 3] - palette[p]);
+					if (error < bestError)
+					{
+						bestError = error;
+						bestIndex = p;
+					}
+				}
+				indices |= (uint64_t)bestIndex << (i * 3);
+			}
+		}
+
+		output[0] = (unsigned char)alpha0;
+		output[1] = (unsigned char)alpha1;
+		for (int i = 0; i < 6; i++)
+		{
+			output[2 + i] = (unsigned char)(indices >> (i * 8));
+		}
+	}
+
+	/***********************************************************
+	 *  QuantizeBC7Endpoint()
+	 *
+	 *  Quantize an endpoint to 7 bits per channel plus a shared
+	 *  p-bit, picking the p-bit with the smaller error.
+	 ***********************************************************/
+	void QuantizeBC7Endpoint(const float endpoint[4], int quantized[4], int& pBit)
+	{
+		float bestError = 1e30f;
+		for (int p = 0; p < 2; p++)
+		{
+			int candidate[4];
+			float error = 0.0f;
+			for (int c = 0; c < 4; c++)
+			{
+				candidate[c] = std::min(std::max((int)floorf((endpoint[c] - p) * 0.5f + 0.5f), 0), 127);
+				float delta = (float)((candidate[c] << 1) | p) - endpoint[c];
+				error += delta * delta;
+			}
+			if (error < bestError)
+			{
+				bestError = error;
+				pBit = p;
+				memcpy(quantized, candidate, sizeof(candidate));
+			}
+		}
+	}
+
+	struct BIT_WRITER
+	{
+		unsigned char* output;
+		int position;
+
+		void Write(uint32_t value, int bits)
+		{
+			for (int i = 0; i < bits; i++, position++)
+			{
+				if ((value >> i) & 1)
+				{
+					output[position >> 3] |= (unsigned char)(1 << (position & 7));
+				}
+			}
+		}
+	};
+
+	/***********************************************************
+	 *  EncodeBC7Block()
+	 *
+	 *  Encode a 4x4 RGBA block as a BC7 mode 6 block - one
+	 *  subset with RGBA 7.7.7.7 endpoints, a p-bit per endpoint
+	 *  and 4-bit indices.
+	 ***********************************************************/
+	void EncodeBC7Block(const unsigned char* block, unsigned char* output)
+	{
+		float endpoint0[4];
+		float endpoint1[4];
+		int quantized[2][4];
+		int pBits[2];
+		int endpoints[2][4];
+		int indices[16];
+
+		FitEndpoints(block, 4, endpoint0, endpoint1);
+		QuantizeBC7Endpoint(endpoint0, quantized[0], pBits[0]);
+		QuantizeBC7Endpoint(endpoint1, quantized[1], pBits[1]);
+
+		for (int e = 0; e < 2; e++)
+			for (int c = 0; c < 4; c++)
+				endpoints[e][c] = (quantized[e][c] << 1) | pBits[e];
+
+		for (int i = 0; i < 16; i++)
+		{
+			int bestIndex = 0;
+			int bestError = 0x7fffffff;
+			for (int k = 0; k < 16; k++)
+			{
+				int error = 0;
+				for (int c = 0; c < 4; c++)
+				{
+					int value = ((64 - g_BC7Weights4[k]) * endpoints[0][c] + g_BC7Weights4[k] * endpoints[1][c] + 32) >> 6;
+					int delta = block[i * 4 + c] - value;
+					error += delta * delta;
+				}
+				if (error < bestError)
+				{
+					bestError = error;
+					bestIndex = k;
+				}
+			}
+			indices[i] = bestIndex;
+		}
+
+		// the anchor index is stored without its top bit, so it has
+		// to be below 8 - otherwise the endpoints are swapped
+		if (indices[0] >= 8)
+		{
+			for (int c = 0; c < 4; c++)
+				std::swap(quantized[0][c], quantized[1][c]);
+			std::swap(pBits[0], pBits[1]);
+			for (int i = 0; i < 16; i++)
+				indices[i] = 15 - indices[i];
+		}
+
+		BIT_WRITER writer;
+		memset(output, 0, 16);
+		writer.output = output;
+		writer.position = 0;
+
+		writer.Write(1 << 6, 7);
+		for (int c = 0; c < 4; c++)
+		{
+			writer.Write(quantized[0][c], 7);
+			writer.Write(quantized[1][c], 7);
+		}
+		writer.Write(pBits[0], 1);
+		writer.Write(pBits[1], 1);
+		writer.Write(indices[0], 3);
+		for (int i = 1; i < 16; i++)
+		{
+			writer.Write(indices[i], 4);
+		}
+	}
+
+	/***********************************************************
+	 *  EncodeBlockRows()
+	 *
+	 *  Encode a range of block rows of a level.  Pixels past
+	 *  the right and bottom edges repeat the edge pixels.
+	 ***********************************************************/
+	void EncodeBlockRows(
+		const TextureCompression::IMAGE_LEVEL* level,
+		TextureCompression::BLOCK_FORMAT format,
+		int firstRow,
+		int lastRow,
+		TextureCompression::IMAGE_LEVEL* encoded)
+	{
+		int blockSize = TextureCompression::GetBlockSize(format);
+		int blocksWide = (level->width + 3) / 4;
+		unsigned char block[64];
+
+		for (int by = firstRow; by < lastRow; by++)
+		{
+			for (int bx = 0; bx < blocksWide; bx++)
+			{
+				for (int y = 0; y < 4; y++)
+				{
+					int sy = std::min(by * 4 + y, level->height - 1);
+					for (int x = 0; x < 4; x++)
+					{
+						int sx = std::min(bx * 4 + x, level->width - 1);
+						memcpy(&block[(y * 4 + x) * 4], &level->data[((size_t)sy * level->width + sx) * 4], 4);
+					}
+				}
+
+				unsigned char* output = &encoded->data[((size_t)by * blocksWide + bx) * blockSize];
+				if (format == TextureCompression::BLOCK_FORMAT_BC1)
+				{
+					EncodeColorBlock(block, output);
+				}
+				else if (format == TextureCompression::BLOCK_FORMAT_BC3)
+				{
+					EncodeAlphaBlock(block, output);
+					EncodeColorBlock(block, output + 8);
+				}
+				else
+				{
+					EncodeBC7Block(block, output);
+				}
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  BuildMipChain()
+ *
+ *  This method is used for building the full mip chain of a
+ *  decoded image.  The color channels are converted from
+ *  sRGB into linear light before filtering and back again
+ *  afterwards, so the smaller levels keep the brightness of
+ *  the full image.  Every level is returned as RGBA pixels.
+ ***********************************************************/
+void TextureCompression::BuildMipChain(
+	const unsigned char* pixels,
+	int width,
+	int height,
+	int colorChannels,
+	MIP_FILTER filter,
+	std::vector<IMAGE_LEVEL>& levels)
+{
+	float toLinear[256];
+	std::vector<float> current((size_t)width * height * 4);
+	std::vector<float> next;
+
+	for (int i = 0; i < 256; i++)
+	{
+		toLinear[i] = SRGBToLinear(i / 255.0f);
+	}
+
+	levels.clear();
+	levels.push_back(IMAGE_LEVEL());
+	levels[0].width = width;
+	levels[0].height = height;
+	levels[0].data.resize((size_t)width * height * 4);
+
+	// expand the base level to RGBA, in bytes and in linear light
+	for (size_t i = 0; i < (size_t)width * height; i++)
+	{
+		const unsigned char* source = pixels + i * colorChannels;
+		unsigned char rgba[4];
+		rgba[0] = source[0];
+		rgba[1] = (colorChannels >= 3) ? source[1] : source[0];
+		rgba[2] = (colorChannels >= 3) ? source[2] : source[0];
+		rgba[3] = (colorChannels == 4) ? source[3] : ((colorChannels == 2) ? source[1] : 255);
+
+		memcpy(&levels[0].data[i * 4], rgba, 4);
+		current[i * 4 + 0] = toLinear[rgba[0]];
+		current[i * 4 + 1] = toLinear[rgba[1]];
+		current[i * 4 + 2] = toLinear[rgba[2]];
+		current[i * 4 + 3] = rgba[3] / 255.0f;
+	}
+
+	int levelWidth = width;
+	int levelHeight = height;
+	while ((levelWidth > 1) || (levelHeight > 1))
+	{
+		int nextWidth = std::max(levelWidth / 2, 1);
+		int nextHeight = std::max(levelHeight / 2, 1);
+
+		if (filter == MIP_FILTER_KAISER)
+			DownsampleKaiser(current, levelWidth, levelHeight, next, nextWidth, nextHeight);
+		else
+			DownsampleBox(current, levelWidth, levelHeight, next, nextWidth, nextHeight);
+
+		IMAGE_LEVEL level;
+		level.width = nextWidth;
+		level.height = nextHeight;
+		level.data.resize((size_t)nextWidth * nextHeight * 4);
+		for (size_t i = 0; i < (size_t)nextWidth * nextHeight; i++)
+		{
+			level.data[i * 4 + 0] = ToByte(LinearToSRGB(next[i * 4 + 0]));
+			level.data[i * 4 + 1] = ToByte(LinearToSRGB(next[i * 4 + 1]));
+			level.data[i * 4 + 2] = ToByte(LinearToSRGB(next[i * 4 + 2]));
+			level.data[i * 4 + 3] = ToByte(next[i * 4 + 3]);
+		}
+		levels.push_back(level);
+
+		current.swap(next);
+		levelWidth = nextWidth;
+		levelHeight = nextHeight;
+	}
+}
+
+/***********************************************************
+ *  EncodeLevel()
+ *
+ *  This method is used for encoding an RGBA level into 4x4
+ *  compressed blocks.  The rows of blocks are split evenly
+ *  between the requested number of threads.
+ ***********************************************************/
+void TextureCompression::EncodeLevel(
+	const IMAGE_LEVEL& level,
+	BLOCK_FORMAT format,
+	int threadCount,
+	IMAGE_LEVEL& encoded)
+{
+	int blocksWide = (level.width + 3) / 4;
+	int blocksHigh = (level.height + 3) / 4;
+	std::vector<std::thread> workers;
+
+	encoded.width = level.width;
+	encoded.height = level.height;
+	encoded.data.assign((size_t)blocksWide * blocksHigh * GetBlockSize(format), 0);
+
+	threadCount = std::max(1, std::min(threadCount, blocksHigh));
+	for (int t = 0; t < threadCount; t++)
+	{
+		int firstRow = blocksHigh * t / threadCount;
+		int lastRow = blocksHigh * (t + 1) / threadCount;
+		workers.push_back(std::thread(EncodeBlockRows, &level, format, firstRow, lastRow, &encoded));
+	}
+	for (size_t t = 0; t < workers.size(); t++)
+	{
+		workers[t].join();
+	}
+}
+
+/***********************************************************
+ *  WriteContainer()
+ *
+ *  This method is used for writing encoded levels into a
+ *  baked texture container.  The size and modification time
+ *  of the source image are stored so that a stale container
+ *  is ignored after the source image changes.
+ ***********************************************************/
+bool TextureCompression::WriteContainer(
+	const std::string& filename,
+	const std::string& sourceFile,
+	BLOCK_FORMAT format,
+	const std::vector<IMAGE_LEVEL>& encodedLevels)
+{
+	CONTAINER_HEADER header;
+	std::vector<CONTAINER_LEVEL> levels(encodedLevels.size());
+	static const unsigned char padding[LEVEL_ALIGNMENT] = { 0 };
+
+	if (encodedLevels.size() == 0)
+	{
+		return(false);
+	}
+
+	memset(&header, 0, sizeof(CONTAINER_HEADER));
+	header.magic = CONTAINER_MAGIC;
+	header.version = CONTAINER_VERSION;
+	header.format = format;
+	header.width = encodedLevels[0].width;
+	header.height = encodedLevels[0].height;
+	header.mipCount = (uint32_t)encodedLevels.size();
+	TextureCache::GetFileStamp(sourceFile, header.sourceSize, header.sourceTime);
+
+	uint64_t offset = sizeof(CONTAINER_HEADER) + levels.size() * sizeof(CONTAINER_LEVEL);
+	for (size_t i = 0; i < levels.size(); i++)
+	{
+		offset = (offset + LEVEL_ALIGNMENT - 1) & ~(LEVEL_ALIGNMENT - 1);
+		levels[i].width = encodedLevels[i].width;
+		levels[i].height = encodedLevels[i].height;
+		levels[i].offset = offset;
+		levels[i].size = encodedLevels[i].data.size();
+		offset += levels[i].size;
+	}
+
+	FILE* file = fopen(filename.c_str(), "wb");
+	if (file == NULL)
+	{
+		return(false);
+	}
+
+	bool bReturn = (fwrite(&header, sizeof(CONTAINER_HEADER), 1, file) == 1);
+	bReturn &= (fwrite(levels.data(), sizeof(CONTAINER_LEVEL), levels.size(), file) == levels.size());
+	uint64_t written = sizeof(CONTAINER_HEADER) + levels.size() * sizeof(CONTAINER_LEVEL);
+	for (size_t i = 0; (i < levels.size()) && (bReturn == true); i++)
+	{
+		size_t paddingSize = (size_t)(levels[i].offset - written);
+		bReturn &= (fwrite(padding, 1, paddingSize, file) == paddingSize);
+		bReturn &= (fwrite(encodedLevels[i].data.data(), 1, encodedLevels[i].data.size(), file) == encodedLevels[i].data.size());
+		written = levels[i].offset + levels[i].size;
+	}
+	fclose(file);
+
+	if (bReturn == false)
+	{
+		remove(filename.c_str());
+	}
+
+	return(bReturn);
+}
+
+/***********************************************************
+ *  LoadContainer()
+ *
+ *  This method is used for mapping the baked container of a
+ *  source image.  The container is skipped when the source
+ *  image is present and has changed since it was baked.
+ ***********************************************************/
+bool TextureCompression::LoadContainer(const std::string& sourceFile, TextureCache::CACHED_IMAGE& image)
+{
+	CONTAINER_HEADER header;
+	uint64_t sourceSize = 0;
+	int64_t sourceTime = 0;
+
+	image.compressedFormat = 0;
+	image.mipLevels.clear();
+	image.mappedData = NULL;
+	image.mappedSize = 0;
+	image.fileHandle = NULL;
+	image.mappingHandle = NULL;
+
+	if (TextureCache::MapFile(GetContainerPath(sourceFile), image) == false)
+	{
+		return(false);
+	}
+
+	const unsigned char* data = (const unsigned char*)image.mappedData;
+	bool bValid = (image.mappedSize >= sizeof(CONTAINER_HEADER));
+	if (bValid == true)
+	{
+		memcpy(&header, data, sizeof(CONTAINER_HEADER));
+		bValid = (header.magic == CONTAINER_MAGIC) &&
+			(header.version == CONTAINER_VERSION) &&
+			(header.mipCount > 0) &&
+			(sizeof(CONTAINER_HEADER) + header.mipCount * sizeof(CONTAINER_LEVEL) <= image.mappedSize);
+	}
+	if ((bValid == true) &&
+		(TextureCache::GetFileStamp(sourceFile, sourceSize, sourceTime) == true))
+	{
+		bValid = (sourceSize == header.sourceSize) && (sourceTime == header.sourceTime);
+	}
+
+	for (uint32_t i = 0; (i < header.mipCount) && (bValid == true); i++)
+	{
+		CONTAINER_LEVEL level;
+		memcpy(&level, data + sizeof(CONTAINER_HEADER) + i * sizeof(CONTAINER_LEVEL), sizeof(CONTAINER_LEVEL));
+		bValid = (level.offset + level.size <= image.mappedSize);
+
+		TextureCache::MIP_LEVEL mipLevel;
+		mipLevel.width = level.width;
+		mipLevel.height = level.height;
+		mipLevel.size = (size_t)level.size;
+		mipLevel.pixels = data + level.offset;
+		image.mipLevels.push_back(mipLevel);
+	}
+
+	if (bValid == false)
+	{
+		TextureCache::Release(image);
+		return(false);
+	}
+
+	image.width = header.width;
+	image.height = header.height;
+	image.colorChannels = (header.format == BLOCK_FORMAT_BC1) ? 3 : 4;
+	image.compressedFormat = header.format;
+
+	return(true);
+}
+
+/***********************************************************
+ *  GetContainerPath()
+ *
+ *  This method is used for getting the path of the baked
+ *  container, which sits next to the source image with the
+ *  file extension replaced.
+ ***********************************************************/
+std::string TextureCompression::GetContainerPath(const std::string& sourceFile)
+{
+	size_t separator = sourceFile.find_last_of("/\\");
+	size_t extension = sourceFile.find_last_of('.');
+
+	if ((extension == std::string::npos) ||
+		((separator != std::string::npos) && (extension < separator)))
+	{
+		return(sourceFile + g_ContainerExtension);
+	}
+
+	return(sourceFile.substr(0, extension) + g_ContainerExtension);
+}
+
+/***********************************************************
+ *  GetBlockSize()
+ *
+ *  This method is used for getting the number of bytes in
+ *  one 4x4 block of a block compressed format.
+ ***********************************************************/
+int TextureCompression::GetBlockSize(BLOCK_FORMAT format)
+{
+	return((format == BLOCK_FORMAT_BC1) ? 8 : 16);
+}
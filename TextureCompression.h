@@ -0,0 +1,81 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturecompression.h
+// ============
+// build mip chains and encode them into block compressed textures
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "TextureCache.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  TextureCompression
+ *
+ *  This class contains the offline texture baking steps:
+ *  building gamma-correct mip chains, encoding the levels
+ *  into BC1, BC3 or BC7 blocks on several threads, and
+ *  reading and writing the baked texture container that is
+ *  uploaded with glCompressedTexImage2D.
+ ***********************************************************/
+class TextureCompression
+{
+public:
+	// block compressed formats, using the OpenGL format values
+	enum BLOCK_FORMAT
+	{
+		BLOCK_FORMAT_BC1 = 0x83F0, // GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+		BLOCK_FORMAT_BC3 = 0x83F3, // GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+		BLOCK_FORMAT_BC7 = 0x8E8C  // GL_COMPRESSED_RGBA_BPTC_UNORM
+	};
+
+	// filters used for building the mip chain
+	enum MIP_FILTER
+	{
+		MIP_FILTER_BOX,
+		MIP_FILTER_KAISER
+	};
+
+	struct IMAGE_LEVEL
+	{
+		int width;
+		int height;
+		// RGBA pixels for mip levels, or blocks for encoded levels
+		std::vector<unsigned char> data;
+	};
+
+	// build the full mip chain of an image as RGBA levels, filtering
+	// in linear light instead of in gamma space
+	static void BuildMipChain(
+		const unsigned char* pixels,
+		int width,
+		int height,
+		int colorChannels,
+		MIP_FILTER filter,
+		std::vector<IMAGE_LEVEL>& levels);
+	// encode an RGBA level into compressed blocks
+	static void EncodeLevel(
+		const IMAGE_LEVEL& level,
+		BLOCK_FORMAT format,
+		int threadCount,
+		IMAGE_LEVEL& encoded);
+
+	// write the encoded levels of a source image into a container
+	static bool WriteContainer(
+		const std::string& filename,
+		const std::string& sourceFile,
+		BLOCK_FORMAT format,
+		const std::vector<IMAGE_LEVEL>& encodedLevels);
+	// map the baked container of a source image when it is present
+	// and was baked from the current version of the source image
+	static bool LoadContainer(const std::string& sourceFile, TextureCache::CACHED_IMAGE& image);
+
+	// get the path of the baked container for a source image
+	static std::string GetContainerPath(const std::string& sourceFile);
+	// get the number of bytes in one 4x4 block of a format
+	static int GetBlockSize(BLOCK_FORMAT format);
+};
@@ -0,0 +1,345 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturedecoder.cpp
+// ============
+// decode texture image files on a pool of worker threads
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TextureDecoder.h"
+#include "TextureCompression.h"
+
+#include "stb_image.h"
+
+/***********************************************************
+ *  TextureDecoder()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TextureDecoder::TextureDecoder()
+{
+	m_nextRequest = 0;
+	m_remaining = 0;
+}
+
+/***********************************************************
+ *  ~TextureDecoder()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+TextureDecoder::~TextureDecoder()
+{
+	JoinWorkers();
+
+	// free any decoded images that were never handed back
+	while (m_finished.empty() == false)
+	{
+		FreeImage(m_finished.front());
+		m_finished.pop_front();
+	}
+}
+
+/***********************************************************
+ *  Start()
+ *
+ *  This method is used for starting the worker threads that
+ *  decode the requested image files.  One worker is started
+ *  per hardware thread, up to the number of requested files.
+ ***********************************************************/
+void TextureDecoder::Start(const std::vector<TEXTURE_REQUEST>& requests)
+{
+	// finish any previous batch before starting a new one, and
+	// free the images of it that were never handed back
+	JoinWorkers();
+	while (m_finished.empty() == false)
+	{
+		FreeImage(m_finished.front());
+		m_finished.pop_front();
+	}
+
+	m_requests = requests;
+	m_nextRequest = 0;
+	m_remaining = m_requests.size();
+
+	if (m_requests.size() == 0)
+	{
+		return;
+	}
+
+	// the flip setting is global in stb_image, so it is set once
+	// here before any of the workers start reading image files
+	stbi_set_flip_vertically_on_load(true);
+
+	size_t workerCount = std::thread::hardware_concurrency();
+	if (workerCount == 0)
+	{
+		workerCount = 1;
+	}
+	if (workerCount > m_requests.size())
+	{
+		workerCount = m_requests.size();
+	}
+
+	for (size_t i = 0; i < workerCount; i++)
+	{
+		m_workers.push_back(std::thread(&TextureDecoder::WorkerLoop, this));
+	}
+}
+
+/***********************************************************
+ *  WaitForNext()
+ *
+ *  This method is used for getting the next decoded image,
+ *  blocking until one of the workers has finished a file.
+ *  The image is returned even when the decoding failed, in
+ *  which case its pixel data is NULL.
+ ***********************************************************/
+bool TextureDecoder::WaitForNext(DECODED_IMAGE& image)
+{
+	if (m_remaining == 0)
+	{
+		JoinWorkers();
+		return(false);
+	}
+
+	std::unique_lock<std::mutex> lock(m_finishedMutex);
+	m_finishedSignal.wait(lock, [this] { return(m_finished.empty() == false); });
+
+	image = m_finished.front();
+	m_finished.pop_front();
+	m_remaining--;
+
+	return(true);
+}
+
+/***********************************************************
+ *  PollNext()
+ *
+ *  This method is used for getting the next decoded image
+ *  when a worker has already finished one, so that images
+ *  can be picked up between frames without blocking.
+ ***********************************************************/
+bool TextureDecoder::PollNext(DECODED_IMAGE& image)
+{
+	if (m_remaining == 0)
+	{
+		JoinWorkers();
+		return(false);
+	}
+
+	std::lock_guard<std::mutex> lock(m_finishedMutex);
+	if (m_finished.empty() == true)
+	{
+		return(false);
+	}
+
+	image = m_finished.front();
+	m_finished.pop_front();
+	m_remaining--;
+
+	return(true);
+}
+
+/***********************************************************
+ *  IsFinished()
+ *
+ *  This method is used for checking whether every requested
+ *  image has been handed back, so a new batch can be started.
+ ***********************************************************/
+bool TextureDecoder::IsFinished() const
+{
+	return(m_remaining == 0);
+}
+
+/***********************************************************
+ *  DecodeFile()
+ *
+ *  This method is used for getting the pixel data of a
+ *  single image file.  A baked block compressed container or
+ *  a valid texture cache file is mapped straight into memory;
+ *  otherwise the image file is decoded and a new cache file
+ *  is written for the next start.
+ ***********************************************************/
+bool TextureDecoder::DecodeFile(const TEXTURE_REQUEST& request, DECODED_IMAGE& image)
+{
+	std::vector<unsigned char> contents;
+
+	if (MapCachedFile(request, image) == true)
+	{
+		return(true);
+	}
+
+	// the file is read once so the same bytes are hashed and decoded
+	if ((TextureCache::ReadFile(request.filename, contents) == false) ||
+		(contents.size() == 0))
+	{
+		return(false);
+	}
+
+	// 16-bit and HDR images are decoded at their own precision -
+	// the cache only holds 8-bit images, so these are not cached
+	if ((request.bHighPrecision == true) &&
+		(stbi_is_hdr_from_memory(contents.data(), (int)contents.size()) != 0))
+	{
+		image.pixelType = PIXEL_TYPE_FLOAT;
+		image.pixels = (unsigned char*)stbi_loadf_from_memory(
+			contents.data(),
+			(int)contents.size(),
+			&image.width,
+			&image.height,
+			&image.colorChannels,
+			0);
+		return(image.pixels != NULL);
+	}
+	if ((request.bHighPrecision == true) &&
+		(stbi_is_16_bit_from_memory(contents.data(), (int)contents.size()) != 0))
+	{
+		image.pixelType = PIXEL_TYPE_UINT16;
+		image.pixels = (unsigned char*)stbi_load_16_from_memory(
+			contents.data(),
+			(int)contents.size(),
+			&image.width,
+			&image.height,
+			&image.colorChannels,
+			0);
+		return(image.pixels != NULL);
+	}
+
+	// try to parse the image data from the read image file
+	image.pixels = stbi_load_from_memory(
+		contents.data(),
+		(int)contents.size(),
+		&image.width,
+		&image.height,
+		&image.colorChannels,
+		0);
+
+	if (image.pixels == NULL)
+	{
+		return(false);
+	}
+
+	// write the cache file and switch over to the mapped copy, so
+	// the decoded pixels can be freed before the upload
+	if ((TextureCache::Store(
+			request.filename,
+			TextureCache::HashBytes(contents.data(), contents.size()),
+			image.width,
+			image.height,
+			image.colorChannels,
+			image.pixels) == true) &&
+		(TextureCache::Load(request.filename, image.cache) == true))
+	{
+		stbi_image_free(image.pixels);
+		image.pixels = NULL;
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  MapCachedFile()
+ *
+ *  This method is used for mapping the small levels of an
+ *  image without decoding it.  A baked block compressed
+ *  container is used first, then a valid texture cache
+ *  file.  Nothing is read from the image file itself.
+ ***********************************************************/
+bool TextureDecoder::MapCachedFile(const TEXTURE_REQUEST& request, DECODED_IMAGE& image)
+{
+	image.filename = request.filename;
+	image.tag = request.tag;
+	image.width = 0;
+	image.height = 0;
+	image.colorChannels = 0;
+	image.pixelType = PIXEL_TYPE_UINT8;
+	image.pixels = NULL;
+	// the cache values are only set by a successful load, so
+	// every other path leaves raw pixels and nothing mapped
+	image.cache.width = 0;
+	image.cache.height = 0;
+	image.cache.colorChannels = 0;
+	image.cache.compressedFormat = 0;
+	image.cache.mipLevels.clear();
+	image.cache.mappedData = NULL;
+	image.cache.mappedSize = 0;
+	image.cache.fileHandle = NULL;
+	image.cache.mappingHandle = NULL;
+
+	// images baked offline are used as they are
+	if (TextureCompression::LoadContainer(request.filename, image.cache) == true)
+	{
+		image.width = image.cache.width;
+		image.height = image.cache.height;
+		image.colorChannels = image.cache.colorChannels;
+		return(true);
+	}
+
+	// warm starts map the decoded pixels and mip chain from the cache
+	if (TextureCache::Load(request.filename, image.cache) == true)
+	{
+		image.width = image.cache.width;
+		image.height = image.cache.height;
+		image.colorChannels = image.cache.colorChannels;
+		return(true);
+	}
+
+	return(false);
+}
+
+/***********************************************************
+ *  FreeImage()
+ *
+ *  This method is used for freeing the decoded pixel data
+ *  and unmapping the cache file of an image.
+ ***********************************************************/
+void TextureDecoder::FreeImage(DECODED_IMAGE& image)
+{
+	if (image.pixels != NULL)
+	{
+		stbi_image_free(image.pixels);
+		image.pixels = NULL;
+	}
+	TextureCache::Release(image.cache);
+}
+
+/***********************************************************
+ *  WorkerLoop()
+ *
+ *  This method is run by every worker thread.  It keeps on
+ *  picking up the next undecoded request until none are left.
+ ***********************************************************/
+void TextureDecoder::WorkerLoop()
+{
+	size_t index = m_nextRequest++;
+	while (index < m_requests.size())
+	{
+		DECODED_IMAGE image;
+		DecodeFile(m_requests[index], image);
+
+		{
+			std::lock_guard<std::mutex> lock(m_finishedMutex);
+			m_finished.push_back(image);
+		}
+		m_finishedSignal.notify_one();
+
+		index = m_nextRequest++;
+	}
+}
+
+/***********************************************************
+ *  JoinWorkers()
+ *
+ *  This method is used for waiting on the worker threads to
+ *  finish and releasing them.
+ ***********************************************************/
+void TextureDecoder::JoinWorkers()
+{
+	for (size_t i = 0; i < m_workers.size(); i++)
+	{
+		if (m_workers[i].joinable())
+		{
+			m_workers[i].join();
+		}
+	}
+	m_workers.clear();
+}
@@ -0,0 +1,108 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturedecoder.h
+// ============
+// decode texture image files on a pool of worker threads
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "TextureCache.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/***********************************************************
+ *  TextureDecoder
+ *
+ *  This class runs the image file decoding for a list of
+ *  textures on worker threads, so that the decoding of all
+ *  the files happens at the same time.  The decoded images
+ *  are handed back to the calling (OpenGL) thread in the
+ *  order that they finish, for uploading into OpenGL.
+ *  Images that are already in the texture cache are mapped
+ *  from the cache instead of being decoded again.
+ ***********************************************************/
+class TextureDecoder
+{
+public:
+	// constructor
+	TextureDecoder();
+	// destructor
+	~TextureDecoder();
+
+	// the type of each channel of the decoded pixels
+	enum PIXEL_TYPE
+	{
+		PIXEL_TYPE_UINT8,
+		PIXEL_TYPE_UINT16,
+		PIXEL_TYPE_FLOAT
+	};
+
+	struct TEXTURE_REQUEST
+	{
+		std::string filename;
+		std::string tag;
+		// keep 16-bit and HDR images at their full precision
+		// instead of reducing them to 8 bits per channel
+		bool bHighPrecision;
+	};
+
+	struct DECODED_IMAGE
+	{
+		std::string filename;
+		std::string tag;
+		int width;
+		int height;
+		int colorChannels;
+		PIXEL_TYPE pixelType;
+		// decoded pixels of the base level, when not served from the cache
+		unsigned char* pixels;
+		// mapped base level and mip chain, when served from the cache
+		TextureCache::CACHED_IMAGE cache;
+	};
+
+	// start decoding the requested image files on the worker threads
+	void Start(const std::vector<TEXTURE_REQUEST>& requests);
+	// wait for the next decoded image - returns false when every
+	// requested image has already been handed back
+	bool WaitForNext(DECODED_IMAGE& image);
+	// get the next decoded image without waiting - returns false
+	// when no image has finished since the last call
+	bool PollNext(DECODED_IMAGE& image);
+	// check whether every requested image has been handed back
+	bool IsFinished() const;
+
+	// decode a single image file on the calling thread, or map
+	// its cached copy when the cache is still valid
+	static bool DecodeFile(const TEXTURE_REQUEST& request, DECODED_IMAGE& image);
+	// map the baked container or the valid cache file of an image,
+	// without decoding the image file when neither is there
+	static bool MapCachedFile(const TEXTURE_REQUEST& request, DECODED_IMAGE& image);
+	// free the decoded pixel data or cache mapping of an image
+	static void FreeImage(DECODED_IMAGE& image);
+
+private:
+	// the loop run by each of the worker threads
+	void WorkerLoop();
+	// wait for the worker threads to exit
+	void JoinWorkers();
+
+	// requested image files
+	std::vector<TEXTURE_REQUEST> m_requests;
+	// index of the next request to be picked up by a worker
+	std::atomic<size_t> m_nextRequest;
+	// number of images not yet handed back to the caller
+	size_t m_remaining;
+	// decoded images waiting to be handed back to the caller
+	std::deque<DECODED_IMAGE> m_finished;
+	std::mutex m_finishedMutex;
+	std::condition_variable m_finishedSignal;
+	// worker threads
+	std::vector<std::thread> m_workers;
+};
@@ -0,0 +1,155 @@
+///////////////////////////////////////////////////////////////////////////////
+// textureresidency.cpp
+// ============
+// keep track of the texture memory used against a byte budget
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TextureResidency.h"
+
+// declare the global variables
+namespace
+{
+	// default budget for the scene textures
+	const size_t DEFAULT_BUDGET_BYTES = 256 * 1024 * 1024;
+	// number of frames that a slot has to go undrawn before it can
+	// give its memory back, so textures used every frame or two are
+	// not reloaded over and over
+	const uint64_t COLD_FRAMES = 2;
+}
+
+/***********************************************************
+ *  TextureResidency()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TextureResidency::TextureResidency()
+{
+	m_budgetBytes = DEFAULT_BUDGET_BYTES;
+	m_residentBytes = 0;
+	m_frame = 0;
+}
+
+/***********************************************************
+ *  SetBudget()
+ *
+ *  This method is used for setting the number of bytes that
+ *  the textures may use together.
+ ***********************************************************/
+void TextureResidency::SetBudget(size_t budgetBytes)
+{
+	m_budgetBytes = budgetBytes;
+}
+
+/***********************************************************
+ *  GetBudget()
+ *
+ *  This method is used for getting the texture budget.
+ ***********************************************************/
+size_t TextureResidency::GetBudget() const
+{
+	return(m_budgetBytes);
+}
+
+/***********************************************************
+ *  GetResidentBytes()
+ *
+ *  This method is used for getting the number of bytes that
+ *  the textures use together.
+ ***********************************************************/
+size_t TextureResidency::GetResidentBytes() const
+{
+	return(m_residentBytes);
+}
+
+/***********************************************************
+ *  IsOverBudget()
+ *
+ *  This method is used for checking whether the textures use
+ *  more memory than the budget.
+ ***********************************************************/
+bool TextureResidency::IsOverBudget() const
+{
+	return(m_residentBytes > m_budgetBytes);
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is called once per frame before any texture
+ *  is drawn.
+ ***********************************************************/
+void TextureResidency::BeginFrame()
+{
+	m_frame++;
+}
+
+/***********************************************************
+ *  Track()
+ *
+ *  This method is used for updating the number of bytes
+ *  that a slot holds after it was loaded, reduced or
+ *  evicted.  A newly tracked slot counts as just drawn.
+ ***********************************************************/
+void TextureResidency::Track(int slot, size_t bytes, bool bReduced)
+{
+	if (slot < 0)
+	{
+		return;
+	}
+
+	if ((size_t)slot >= m_textures.size())
+	{
+		RESIDENT_TEXTURE texture = { 0, false, m_frame };
+		m_textures.resize(slot + 1, texture);
+	}
+
+	m_residentBytes -= m_textures[slot].bytes;
+	m_residentBytes += bytes;
+	m_textures[slot].bytes = bytes;
+	m_textures[slot].bReduced = bReduced;
+}
+
+/***********************************************************
+ *  Touch()
+ *
+ *  This method is used for recording that a slot is drawn
+ *  in the current frame.
+ ***********************************************************/
+void TextureResidency::Touch(int slot)
+{
+	if ((slot >= 0) && ((size_t)slot < m_textures.size()))
+	{
+		m_textures[slot].lastUsedFrame = m_frame;
+	}
+}
+
+/***********************************************************
+ *  FindColdest()
+ *
+ *  This method is used for finding the least recently used
+ *  slot that can give memory back, or -1 when there is none.
+ ***********************************************************/
+int TextureResidency::FindColdest(bool bFullOnly) const
+{
+	int coldest = -1;
+
+	for (size_t slot = 0; slot < m_textures.size(); slot++)
+	{
+		const RESIDENT_TEXTURE& texture = m_textures[slot];
+
+		if ((texture.bytes == 0) ||
+			((bFullOnly == true) && (texture.bReduced == true)) ||
+			(texture.lastUsedFrame + COLD_FRAMES > m_frame))
+		{
+			continue;
+		}
+
+		if ((coldest < 0) || (texture.lastUsedFrame < m_textures[coldest].lastUsedFrame))
+		{
+			coldest = (int)slot;
+		}
+	}
+
+	return(coldest);
+}
@@ -0,0 +1,62 @@
+///////////////////////////////////////////////////////////////////////////////
+// textureresidency.h
+// ============
+// keep track of the texture memory used against a byte budget
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  TextureResidency
+ *
+ *  This class keeps the number of bytes that each texture
+ *  slot holds in video memory and the last frame that the
+ *  slot was drawn with, and picks the least recently used
+ *  slots to give memory back when the total is over budget.
+ *  It does not touch OpenGL - the owner of the textures
+ *  reduces or evicts the slots that it picks.
+ ***********************************************************/
+class TextureResidency
+{
+public:
+	// constructor
+	TextureResidency();
+
+	// set the number of bytes that the textures may use together
+	void SetBudget(size_t budgetBytes);
+	size_t GetBudget() const;
+	// get the number of bytes that the textures use together
+	size_t GetResidentBytes() const;
+	bool IsOverBudget() const;
+
+	// start counting usage for the next frame
+	void BeginFrame();
+	// set the number of bytes that a slot holds, and whether the
+	// slot is reduced to its smaller mip levels
+	void Track(int slot, size_t bytes, bool bReduced);
+	// record that a slot is drawn in the current frame
+	void Touch(int slot);
+	// find the least recently used slot that has not been drawn for
+	// a few frames and still holds memory - only slots holding all
+	// of their levels are considered when bFullOnly is true
+	int FindColdest(bool bFullOnly) const;
+
+private:
+	struct RESIDENT_TEXTURE
+	{
+		size_t bytes;
+		bool bReduced;
+		uint64_t lastUsedFrame;
+	};
+
+	// memory and usage of every texture slot
+	std::vector<RESIDENT_TEXTURE> m_textures;
+	size_t m_budgetBytes;
+	size_t m_residentBytes;
+	uint64_t m_frame;
+};
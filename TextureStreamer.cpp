@@ -0,0 +1,293 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturestreamer.cpp
+// ============
+// stream texture mip levels into OpenGL over several frames
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TextureStreamer.h"
+
+#include <algorithm>
+#include <cstring>
+
+// declare the global variables
+namespace
+{
+	// number of pixel buffer objects in the upload ring
+	const size_t PIXEL_BUFFER_COUNT = 3;
+	// number of bytes uploaded per frame - a level larger than the
+	// budget is still uploaded, but on its own
+	const size_t STREAM_BYTES_PER_FRAME = 4 * 1024 * 1024;
+	// levels up to this many pixels are uploaded right away
+	const int IMMEDIATE_LEVEL_PIXELS = 64 * 64;
+}
+
+/***********************************************************
+ *  TextureStreamer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TextureStreamer::TextureStreamer()
+{
+	m_nextJob = 0;
+	m_nextBuffer = 0;
+}
+
+/***********************************************************
+ *  ~TextureStreamer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+TextureStreamer::~TextureStreamer()
+{
+	// unmap the images of any textures that did not finish
+	for (size_t i = 0; i < m_textures.size(); i++)
+	{
+		TextureDecoder::FreeImage(m_textures[i].image);
+	}
+	m_textures.clear();
+
+	for (size_t i = 0; i < m_fences.size(); i++)
+	{
+		if (m_fences[i] != 0)
+		{
+			glDeleteSync(m_fences[i]);
+		}
+	}
+	if (m_pixelBuffers.size() > 0)
+	{
+		glDeleteBuffers((GLsizei)m_pixelBuffers.size(), m_pixelBuffers.data());
+	}
+}
+
+/***********************************************************
+ *  Add()
+ *
+ *  This method is used for queueing the mip chain of a
+ *  cached image for streaming.  The texture must already
+ *  have storage for every level.  The smallest levels are
+ *  uploaded straight away and the texture base level is set
+ *  to the finest of them, so the texture is complete and can
+ *  be drawn before the rest of the levels have arrived.
+ ***********************************************************/
+void TextureStreamer::Add(GLuint textureID, GLenum pixelFormat, TextureDecoder::DECODED_IMAGE& image)
+{
+	STREAM_TEXTURE texture;
+	GLint previousTexture = 0;
+	int levelCount = (int)image.cache.mipLevels.size();
+	int baseLevel = levelCount - 1;
+
+	if (levelCount == 0)
+	{
+		return;
+	}
+
+	texture.textureID = textureID;
+	texture.pixelFormat = pixelFormat;
+	texture.image = image;
+	texture.pendingLevels = 0;
+
+	// the streamer now owns the cache mapping of the image
+	image.cache.mipLevels.clear();
+	image.cache.mappedData = NULL;
+	image.cache.mappedSize = 0;
+	image.cache.fileHandle = NULL;
+	image.cache.mappingHandle = NULL;
+
+	glGetIntegerv(GL_TEXTURE_BINDING_2D, &previousTexture);
+	glBindTexture(GL_TEXTURE_2D, textureID);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	for (int level = levelCount - 1; level >= 0; level--)
+	{
+		const TextureCache::MIP_LEVEL& mipLevel = texture.image.cache.mipLevels[level];
+		if (mipLevel.width * mipLevel.height > IMMEDIATE_LEVEL_PIXELS)
+		{
+			break;
+		}
+
+		glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, mipLevel.width, mipLevel.height, pixelFormat, GL_UNSIGNED_BYTE, mipLevel.pixels);
+		baseLevel = level;
+	}
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, baseLevel);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glBindTexture(GL_TEXTURE_2D, previousTexture);
+
+	// queue the remaining levels from coarse to fine
+	for (int level = baseLevel - 1; level >= 0; level--)
+	{
+		const TextureCache::MIP_LEVEL& mipLevel = texture.image.cache.mipLevels[level];
+		STREAM_JOB job;
+		job.texture = (int)m_textures.size();
+		job.level = level;
+		job.size = (size_t)mipLevel.width * mipLevel.height * texture.image.colorChannels;
+		m_jobs.push_back(job);
+		texture.pendingLevels++;
+	}
+
+	if (texture.pendingLevels == 0)
+	{
+		TextureDecoder::FreeImage(texture.image);
+		return;
+	}
+	m_textures.push_back(texture);
+
+	// the small levels of every texture go out before the large
+	// levels of any texture - the sort is stable, so the levels of
+	// one texture stay in coarse to fine order
+	std::stable_sort(
+		m_jobs.begin() + m_nextJob,
+		m_jobs.end(),
+		[](const STREAM_JOB& a, const STREAM_JOB& b) { return(a.size < b.size); });
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is called once per frame for uploading the
+ *  next pending levels, until the byte budget of the frame
+ *  is used up or the next pixel buffer is still busy.
+ ***********************************************************/
+void TextureStreamer::Update()
+{
+	size_t uploadedBytes = 0;
+
+	while ((m_nextJob < m_jobs.size()) && (uploadedBytes < STREAM_BYTES_PER_FRAME))
+	{
+		if (UploadLevel(m_jobs[m_nextJob], false) == false)
+		{
+			break;
+		}
+		uploadedBytes += m_jobs[m_nextJob].size;
+		FinishLevel(m_jobs[m_nextJob]);
+		m_nextJob++;
+	}
+
+	if (m_nextJob == m_jobs.size())
+	{
+		m_jobs.clear();
+		m_textures.clear();
+		m_nextJob = 0;
+	}
+}
+
+/***********************************************************
+ *  Flush()
+ *
+ *  This method is used for uploading every pending level,
+ *  waiting on the pixel buffers as needed.
+ ***********************************************************/
+void TextureStreamer::Flush()
+{
+	while (m_nextJob < m_jobs.size())
+	{
+		UploadLevel(m_jobs[m_nextJob], true);
+		FinishLevel(m_jobs[m_nextJob]);
+		m_nextJob++;
+	}
+
+	m_jobs.clear();
+	m_textures.clear();
+	m_nextJob = 0;
+}
+
+/***********************************************************
+ *  IsIdle()
+ *
+ *  This method is used for checking whether every queued
+ *  level has been uploaded.
+ ***********************************************************/
+bool TextureStreamer::IsIdle() const
+{
+	return(m_nextJob == m_jobs.size());
+}
+
+/***********************************************************
+ *  UploadLevel()
+ *
+ *  This method is used for copying one mip level into the
+ *  next pixel buffer of the ring and starting the transfer
+ *  into the texture.  The copy from the buffer runs on the
+ *  GPU, and the buffer is fenced so that it is not written
+ *  again before the transfer is done.
+ ***********************************************************/
+bool TextureStreamer::UploadLevel(const STREAM_JOB& job, bool bWait)
+{
+	STREAM_TEXTURE& texture = m_textures[job.texture];
+	const TextureCache::MIP_LEVEL& mipLevel = texture.image.cache.mipLevels[job.level];
+	GLint previousTexture = 0;
+
+	// the pixel buffers are created with the first upload
+	if (m_pixelBuffers.size() == 0)
+	{
+		m_pixelBuffers.resize(PIXEL_BUFFER_COUNT);
+		m_fences.resize(PIXEL_BUFFER_COUNT, 0);
+		glGenBuffers((GLsizei)PIXEL_BUFFER_COUNT, m_pixelBuffers.data());
+	}
+
+	if (m_fences[m_nextBuffer] != 0)
+	{
+		GLenum result = glClientWaitSync(
+			m_fences[m_nextBuffer],
+			bWait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0,
+			bWait ? GL_TIMEOUT_IGNORED : 0);
+		if (result == GL_TIMEOUT_EXPIRED)
+		{
+			return(false);
+		}
+		glDeleteSync(m_fences[m_nextBuffer]);
+		m_fences[m_nextBuffer] = 0;
+	}
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_pixelBuffers[m_nextBuffer]);
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)job.size, NULL, GL_STREAM_DRAW);
+	void* target = glMapBufferRange(
+		GL_PIXEL_UNPACK_BUFFER, 0, (GLsizeiptr)job.size,
+		GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	if (target == NULL)
+	{
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		return(false);
+	}
+	memcpy(target, mipLevel.pixels, job.size);
+	glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+	// the scene textures stay bound on their units while streaming
+	glGetIntegerv(GL_TEXTURE_BINDING_2D, &previousTexture);
+	glBindTexture(GL_TEXTURE_2D, texture.textureID);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	// with a pixel unpack buffer bound the data pointer is an offset
+	glTexSubImage2D(GL_TEXTURE_2D, job.level, 0, 0, mipLevel.width, mipLevel.height, texture.pixelFormat, GL_UNSIGNED_BYTE, (const void*)0);
+	// sample from the new, sharper level from now on
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, job.level);
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glBindTexture(GL_TEXTURE_2D, previousTexture);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	m_fences[m_nextBuffer] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	m_nextBuffer = (m_nextBuffer + 1) % m_pixelBuffers.size();
+
+	return(true);
+}
+
+/***********************************************************
+ *  FinishLevel()
+ *
+ *  This method is used for releasing the image mapping of a
+ *  texture once its last pending level has been uploaded.
+ ***********************************************************/
+void TextureStreamer::FinishLevel(const STREAM_JOB& job)
+{
+	STREAM_TEXTURE& texture = m_textures[job.texture];
+
+	texture.pendingLevels--;
+	if (texture.pendingLevels == 0)
+	{
+		TextureDecoder::FreeImage(texture.image);
+	}
+}
@@ -0,0 +1,77 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturestreamer.h
+// ============
+// stream texture mip levels into OpenGL over several frames
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "TextureDecoder.h"
+
+#include <GL/glew.h>
+
+#include <vector>
+
+/***********************************************************
+ *  TextureStreamer
+ *
+ *  This class uploads the mip chains of textures through a
+ *  ring of pixel buffer objects, from the coarsest level to
+ *  the finest.  The smallest levels are uploaded right away
+ *  so the textures can be drawn immediately, and the base
+ *  level of each texture is lowered as every finer level
+ *  arrives, which sharpens the texture over the next frames.
+ ***********************************************************/
+class TextureStreamer
+{
+public:
+	// constructor
+	TextureStreamer();
+	// destructor
+	~TextureStreamer();
+
+	// queue the mip chain of a cached image for streaming into the
+	// passed in texture - the streamer takes over the image mapping
+	void Add(GLuint textureID, GLenum pixelFormat, TextureDecoder::DECODED_IMAGE& image);
+	// upload the next pending levels within the per-frame budget
+	void Update();
+	// upload every pending level before returning
+	void Flush();
+	// check whether there are no more levels waiting to be uploaded
+	bool IsIdle() const;
+
+private:
+	struct STREAM_TEXTURE
+	{
+		GLuint textureID;
+		GLenum pixelFormat;
+		TextureDecoder::DECODED_IMAGE image;
+		// number of levels still waiting to be uploaded
+		int pendingLevels;
+	};
+
+	struct STREAM_JOB
+	{
+		int texture;
+		int level;
+		size_t size;
+	};
+
+	// upload one level through the next pixel buffer of the ring -
+	// returns false when that buffer is still in use by the GPU
+	bool UploadLevel(const STREAM_JOB& job, bool bWait);
+	// record that a level of a texture has been uploaded
+	void FinishLevel(const STREAM_JOB& job);
+
+	// textures with levels waiting to be uploaded
+	std::vector<STREAM_TEXTURE> m_textures;
+	// levels waiting to be uploaded, smallest first
+	std::vector<STREAM_JOB> m_jobs;
+	size_t m_nextJob;
+
+	// ring of pixel buffer objects and their upload fences
+	std::vector<GLuint> m_pixelBuffers;
+	std::vector<GLsync> m_fences;
+	size_t m_nextBuffer;
+};
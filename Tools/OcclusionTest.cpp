@@ -0,0 +1,172 @@
+///////////////////////////////////////////////////////////////////////////////
+// occlusiontest.cpp
+// ============
+// command line tool for testing the CPU occlusion buffer against a
+// known occluder
+//
+//  The tool is built as its own program from this file together
+//  with OcclusionBuffer.cpp, BoundingVolumeTree.cpp and
+//  MeshGeometry.cpp, and is run without any arguments:
+//
+//    OcclusionTest
+//
+//  A wall is rasterized in front of the camera, first on its own
+//  and then with a sphere next to it, which has enough triangles
+//  to be rasterized on the worker threads.  Boxes in front of the
+//  wall, behind it and across its edge have to be tested as
+//  expected in every frame.  The frames are run with one thread
+//  per hardware thread, and again with two and four threads, so
+//  the workers are tested on a machine with a single core too.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "../OcclusionBuffer.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cstdlib>
+#include <iostream>
+
+// declarations for the global variables and defines
+namespace
+{
+	// frames rasterized with each set of occluders, so that the
+	// worker threads are woken more than once
+	const int FRAME_COUNT = 4;
+	// thread counts that the frames are run with, where 0 is one
+	// thread per hardware thread
+	const int g_ThreadCounts[] = { 0, 2, 4 };
+	const int g_ThreadCountCount = sizeof(g_ThreadCounts) / sizeof(g_ThreadCounts[0]);
+
+	struct VISIBILITY_CASE
+	{
+		const char* name;
+		glm::vec3 center;
+		glm::vec3 extent;
+		bool bVisible;
+	};
+
+	// the wall is 8 wide and 6 high and stands at z = 0, and the
+	// camera looks at it from z = 10
+	const VISIBILITY_CASE g_WallCases[] =
+	{
+		{ "in front of the wall", glm::vec3(0.0f, 0.0f, 3.0f), glm::vec3(1.0f), true },
+		{ "behind the wall", glm::vec3(0.0f, 0.0f, -5.0f), glm::vec3(1.0f), false },
+		{ "small box behind the wall", glm::vec3(2.0f, 1.0f, -20.0f), glm::vec3(0.1f), false },
+		{ "across the side edge", glm::vec3(4.0f, 0.0f, -3.0f), glm::vec3(1.0f), true },
+		{ "across the top edge", glm::vec3(0.0f, 3.0f, -3.0f), glm::vec3(1.0f), true },
+		{ "beside the wall", glm::vec3(12.0f, 0.0f, -5.0f), glm::vec3(1.0f), true },
+		{ "across the near plane", glm::vec3(0.0f, 0.0f, 10.0f), glm::vec3(1.0f), true }
+	};
+	const int g_WallCaseCount = sizeof(g_WallCases) / sizeof(g_WallCases[0]);
+
+	// the sphere has a radius of 2 and sits left of the wall, and
+	// the boxes lie on the line from the camera through its center
+	const glm::vec3 SPHERE_CENTER = glm::vec3(-6.5f, 0.0f, 0.0f);
+	const float SPHERE_RADIUS = 2.0f;
+	const VISIBILITY_CASE g_SphereCases[] =
+	{
+		{ "behind the sphere", glm::vec3(-9.75f, 0.0f, -5.0f), glm::vec3(0.5f), false },
+		{ "in front of the sphere", glm::vec3(-3.25f, 0.0f, 5.0f), glm::vec3(0.5f), true }
+	};
+	const int g_SphereCaseCount = sizeof(g_SphereCases) / sizeof(g_SphereCases[0]);
+
+	/***********************************************************
+	 *  CheckCases()
+	 *
+	 *  This function is used for testing a list of boxes, and
+	 *  returns the number of boxes with the wrong result.
+	 ***********************************************************/
+	int CheckCases(const OcclusionBuffer& buffer, const VISIBILITY_CASE* cases, int caseCount, int threadCount, int frame)
+	{
+		int failures = 0;
+
+		for (int i = 0; i < caseCount; i++)
+		{
+			BoundingVolumeTree::BOUNDS bounds;
+			bounds.center = cases[i].center;
+			bounds.extent = cases[i].extent;
+
+			bool bVisible = buffer.IsVisible(bounds);
+			if (bVisible != cases[i].bVisible)
+			{
+				std::cout << "Threads " << threadCount << ", frame " << frame << ", " << cases[i].name << ": expected "
+					<< (cases[i].bVisible ? "visible" : "hidden") << std::endl;
+				failures++;
+			}
+		}
+
+		return(failures);
+	}
+
+	/***********************************************************
+	 *  RunFrames()
+	 *
+	 *  This function is used for rasterizing the frames with
+	 *  the passed in thread count, and returns the number of
+	 *  boxes with the wrong result.
+	 ***********************************************************/
+	int RunFrames(int threadCount)
+	{
+		glm::mat4 projection = glm::perspective(glm::radians(45.0f), 2.0f, 0.1f, 100.0f);
+		glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, 10.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+		glm::mat4 viewProjection = projection * view;
+
+		MeshGeometry::MESH_DATA box;
+		MeshGeometry::MESH_DATA sphere;
+		MeshGeometry::BuildBox(box);
+		MeshGeometry::BuildSphere(sphere);
+
+		glm::mat4 wall = glm::scale(glm::vec3(8.0f, 6.0f, 0.2f));
+		glm::mat4 ball = glm::translate(SPHERE_CENTER) * glm::scale(glm::vec3(SPHERE_RADIUS));
+
+		OcclusionBuffer buffer(threadCount);
+		int failures = 0;
+
+		// the wall alone is rasterized on the calling thread
+		for (int frame = 0; frame < FRAME_COUNT; frame++)
+		{
+			buffer.Begin(viewProjection);
+			buffer.AddOccluder(box, wall);
+			buffer.Rasterize();
+			failures += CheckCases(buffer, g_WallCases, g_WallCaseCount, threadCount, frame);
+		}
+
+		// the sphere brings in enough triangles for the workers
+		for (int frame = 0; frame < FRAME_COUNT; frame++)
+		{
+			buffer.Begin(viewProjection);
+			buffer.AddOccluder(box, wall);
+			buffer.AddOccluder(sphere, ball);
+			buffer.Rasterize();
+			failures += CheckCases(buffer, g_WallCases, g_WallCaseCount, threadCount, FRAME_COUNT + frame);
+			failures += CheckCases(buffer, g_SphereCases, g_SphereCaseCount, threadCount, FRAME_COUNT + frame);
+		}
+
+		return(failures);
+	}
+}
+
+/***********************************************************
+ *  main()
+ *
+ *  This function gets called after the tool has been
+ *  launched.
+ ***********************************************************/
+int main()
+{
+	int failures = 0;
+
+	for (int i = 0; i < g_ThreadCountCount; i++)
+	{
+		failures += RunFrames(g_ThreadCounts[i]);
+	}
+
+	if (failures > 0)
+	{
+		std::cout << failures << " occlusion tests failed" << std::endl;
+		return(EXIT_FAILURE);
+	}
+
+	std::cout << "Every occlusion test passed with up to " << g_ThreadCounts[g_ThreadCountCount - 1] << " threads" << std::endl;
+	return(EXIT_SUCCESS);
+}
@@ -0,0 +1,85 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenecompiler.cpp
+// ============
+// command line tool for compiling scene text files into the binary
+// scene files that the scene manager loads
+//
+//  The tool is built as its own program from this file together
+//  with SceneFile.cpp and TextureCache.cpp, and is run from the
+//  project directory:
+//
+//    SceneCompiler [scene files...]
+//
+//  Without scene files, the desk scene is compiled.  The binary
+//  file is written next to each text file.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "../SceneFile.h"
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  CompileScene()
+ *
+ *  This function is used for compiling one scene text file
+ *  into its binary file.
+ ***********************************************************/
+bool CompileScene(const std::string& filename)
+{
+	SceneFile scene;
+
+	if (scene.LoadText(filename) == false)
+	{
+		return(false);
+	}
+
+	std::string binaryFile = SceneFile::GetBinaryPath(filename);
+	if (scene.WriteBinary(filename) == false)
+	{
+		std::cout << "Could not write scene:" << binaryFile << std::endl;
+		return(false);
+	}
+
+	std::cout << "Compiled " << filename << " -> " << binaryFile
+		<< ", textures:" << scene.GetTextures().size()
+		<< ", materials:" << scene.GetMaterials().size()
+		<< ", objects:" << scene.GetObjects().size()
+		<< ", parts:" << scene.GetParts().size() << std::endl;
+
+	return(true);
+}
+
+/***********************************************************
+ *  main(int, char*)
+ *
+ *  This function gets called after the tool has been
+ *  launched.
+ ***********************************************************/
+int main(int argc, char* argv[])
+{
+	std::vector<std::string> files;
+
+	for (int i = 1; i < argc; i++)
+	{
+		files.push_back(argv[i]);
+	}
+
+	if (files.size() == 0)
+	{
+		files.push_back("Scenes/desk.scene");
+	}
+
+	int failures = 0;
+	for (size_t i = 0; i < files.size(); i++)
+	{
+		if (CompileScene(files[i]) == false)
+		{
+			failures++;
+		}
+	}
+
+	return((failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE);
+}
@@ -0,0 +1,180 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturebaker.cpp
+// ============
+// command line tool for baking the scene textures into block
+// compressed containers
+//
+//  The tool is built as its own program from this file together
+//  with TextureCompression.cpp, TextureCache.cpp and SceneFile.cpp,
+//  and is run from the project directory so that the texture paths
+//  resolve:
+//
+//    TextureBaker [-format bc1|bc3|bc7] [-filter box|kaiser]
+//                 [-threads count] [-scene file] [image files...]
+//
+//  Without image files, every texture of the scene file is baked.
+//  Without a format, BC1 is used for opaque images and BC3 for
+//  images with an alpha channel.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "../SceneFile.h"
+#include "../TextureCompression.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+/***********************************************************
+ *  BakeTexture()
+ *
+ *  This function is used for baking one image file into a
+ *  block compressed container next to the image file.
+ ***********************************************************/
+bool BakeTexture(
+	const std::string& filename,
+	int format,
+	TextureCompression::MIP_FILTER filter,
+	int threadCount)
+{
+	int width = 0;
+	int height = 0;
+	int colorChannels = 0;
+	std::vector<TextureCompression::IMAGE_LEVEL> levels;
+	std::vector<TextureCompression::IMAGE_LEVEL> encodedLevels;
+	size_t rawSize = 0;
+	size_t encodedSize = 0;
+
+	// the baked levels have to match the orientation that the
+	// scene manager uploads
+	stbi_set_flip_vertically_on_load(true);
+
+	unsigned char* image = stbi_load(filename.c_str(), &width, &height, &colorChannels, 0);
+	if (image == NULL)
+	{
+		std::cout << "Could not load image:" << filename << std::endl;
+		return(false);
+	}
+
+	TextureCompression::BLOCK_FORMAT blockFormat = (TextureCompression::BLOCK_FORMAT)format;
+	if (format == 0)
+	{
+		bool bHasAlpha = (colorChannels == 2) || (colorChannels == 4);
+		blockFormat = bHasAlpha ? TextureCompression::BLOCK_FORMAT_BC3 : TextureCompression::BLOCK_FORMAT_BC1;
+	}
+
+	TextureCompression::BuildMipChain(image, width, height, colorChannels, filter, levels);
+	stbi_image_free(image);
+
+	encodedLevels.resize(levels.size());
+	for (size_t i = 0; i < levels.size(); i++)
+	{
+		TextureCompression::EncodeLevel(levels[i], blockFormat, threadCount, encodedLevels[i]);
+		rawSize += (size_t)levels[i].width * levels[i].height * ((colorChannels == 4) ? 4 : 3);
+		encodedSize += encodedLevels[i].data.size();
+	}
+
+	std::string containerFile = TextureCompression::GetContainerPath(filename);
+	if (TextureCompression::WriteContainer(containerFile, filename, blockFormat, encodedLevels) == false)
+	{
+		std::cout << "Could not write container:" << containerFile << std::endl;
+		return(false);
+	}
+
+	std::cout << "Baked " << filename << " -> " << containerFile
+		<< ", width:" << width << ", height:" << height
+		<< ", levels:" << encodedLevels.size()
+		<< ", bytes:" << rawSize << " -> " << encodedSize << std::endl;
+
+	return(true);
+}
+
+/***********************************************************
+ *  main(int, char*)
+ *
+ *  This function gets called after the tool has been
+ *  launched.
+ ***********************************************************/
+int main(int argc, char* argv[])
+{
+	int format = 0;
+	TextureCompression::MIP_FILTER filter = TextureCompression::MIP_FILTER_KAISER;
+	int threadCount = (int)std::thread::hardware_concurrency();
+	std::string sceneFile = "Scenes/desk.scene";
+	std::vector<std::string> files;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if ((strcmp(argv[i], "-format") == 0) && (i + 1 < argc))
+		{
+			i++;
+			if (strcmp(argv[i], "bc1") == 0)
+				format = TextureCompression::BLOCK_FORMAT_BC1;
+			else if (strcmp(argv[i], "bc3") == 0)
+				format = TextureCompression::BLOCK_FORMAT_BC3;
+			else if (strcmp(argv[i], "bc7") == 0)
+				format = TextureCompression::BLOCK_FORMAT_BC7;
+			else
+			{
+				std::cerr << "Unknown format:" << argv[i] << std::endl;
+				return(EXIT_FAILURE);
+			}
+		}
+		else if ((strcmp(argv[i], "-filter") == 0) && (i + 1 < argc))
+		{
+			i++;
+			filter = (strcmp(argv[i], "box") == 0) ?
+				TextureCompression::MIP_FILTER_BOX : TextureCompression::MIP_FILTER_KAISER;
+		}
+		else if ((strcmp(argv[i], "-threads") == 0) && (i + 1 < argc))
+		{
+			i++;
+			threadCount = atoi(argv[i]);
+		}
+		else if ((strcmp(argv[i], "-scene") == 0) && (i + 1 < argc))
+		{
+			i++;
+			sceneFile = argv[i];
+		}
+		else
+		{
+			files.push_back(argv[i]);
+		}
+	}
+
+	if (threadCount < 1)
+	{
+		threadCount = 1;
+	}
+
+	// bake the textures of the scene when no files are given
+	if (files.size() == 0)
+	{
+		SceneFile scene;
+		if (scene.Load(sceneFile) == false)
+		{
+			std::cerr << "Could not load scene:" << sceneFile << std::endl;
+			return(EXIT_FAILURE);
+		}
+		for (size_t i = 0; i < scene.GetTextures().size(); i++)
+		{
+			files.push_back(scene.GetTextures()[i].filename);
+		}
+	}
+
+	int failures = 0;
+	for (size_t i = 0; i < files.size(); i++)
+	{
+		if (BakeTexture(files[i], format, filter, threadCount) == false)
+		{
+			failures++;
+		}
+	}
+
+	return((failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE);
+}
@@ -0,0 +1,228 @@
+///////////////////////////////////////////////////////////////////////////////
+// transformbenchmark.cpp
+// ============
+// command line tool for checking and timing the model matrices of
+// the transform store against the product of the five separate
+// matrices
+//
+//  The tool is built as its own program from this file together
+//  with TransformStore.cpp, and is run as:
+//
+//    TransformBenchmark [matrix count] [repeat count]
+//
+//  Every matrix of the store has to match the product within a
+//  small epsilon, or the tool fails before timing.  The store is
+//  timed the way the scene graph uses it, with every transform
+//  moved or rotated before each update.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "../TransformStore.h"
+
+#include <glm/gtx/transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// declarations for the global variables and defines
+namespace
+{
+	// largest difference allowed between the two matrices
+	const float MATCH_EPSILON = 1e-4f;
+	// part of the inputs that have no rotation, like most of the
+	// objects of the scene
+	const float UNROTATED_SHARE = 0.5f;
+
+	struct TRANSFORM_INPUT
+	{
+		glm::vec3 scale;
+		float rotationX;
+		float rotationY;
+		float rotationZ;
+		glm::vec3 position;
+	};
+
+	/***********************************************************
+	 *  ComposeProduct()
+	 *
+	 *  This function is used for building a model matrix the
+	 *  way that it was built before the closed form, as the
+	 *  product of the five separate matrices.
+	 ***********************************************************/
+	glm::mat4 ComposeProduct(const TRANSFORM_INPUT& input)
+	{
+		glm::mat4 scale = glm::scale(input.scale);
+		glm::mat4 rotationX = glm::rotate(glm::radians(input.rotationX), glm::vec3(1.0f, 0.0f, 0.0f));
+		glm::mat4 rotationY = glm::rotate(glm::radians(input.rotationY), glm::vec3(0.0f, 1.0f, 0.0f));
+		glm::mat4 rotationZ = glm::rotate(glm::radians(input.rotationZ), glm::vec3(0.0f, 0.0f, 1.0f));
+		glm::mat4 translation = glm::translate(input.position);
+
+		return(translation * rotationX * rotationY * rotationZ * scale);
+	}
+
+	/***********************************************************
+	 *  TimeProduct()
+	 *
+	 *  This function is used for timing the product of the
+	 *  five matrices, in nanoseconds per matrix.  The sum of
+	 *  the matrices is kept so the work cannot be left out.
+	 ***********************************************************/
+	double TimeProduct(
+		const std::vector<TRANSFORM_INPUT>& inputs,
+		int repeatCount,
+		float& checksum)
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		for (int repeat = 0; repeat < repeatCount; repeat++)
+		{
+			for (size_t i = 0; i < inputs.size(); i++)
+			{
+				glm::mat4 model = ComposeProduct(inputs[i]);
+				checksum += model[0][0] + model[1][1] + model[2][2] + model[3][0];
+			}
+		}
+
+		std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+		return(elapsed.count() / ((double)inputs.size() * repeatCount));
+	}
+
+	/***********************************************************
+	 *  TimeStore()
+	 *
+	 *  This function is used for timing the transform store,
+	 *  in nanoseconds per matrix.  Every transform is moved,
+	 *  or rotated when asked, so that every group is computed
+	 *  again by the update, and the matrices are then read
+	 *  back the way the scene graph reads them.
+	 ***********************************************************/
+	double TimeStore(
+		TransformStore& store,
+		const std::vector<TRANSFORM_INPUT>& inputs,
+		bool bRotate,
+		int repeatCount,
+		float& checksum)
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		for (int repeat = 0; repeat < repeatCount; repeat++)
+		{
+			for (size_t i = 0; i < inputs.size(); i++)
+			{
+				const TRANSFORM_INPUT& input = inputs[i];
+				if (bRotate == true)
+				{
+					store.SetRotation((int)i, input.rotationX, input.rotationY, input.rotationZ);
+				}
+				else
+				{
+					store.SetPosition((int)i, input.position);
+				}
+			}
+
+			store.Update();
+
+			for (size_t i = 0; i < inputs.size(); i++)
+			{
+				const glm::mat4& model = store.GetMatrix((int)i);
+				checksum += model[0][0] + model[1][1] + model[2][2] + model[3][0];
+			}
+		}
+
+		std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+		return(elapsed.count() / ((double)inputs.size() * repeatCount));
+	}
+}
+
+/***********************************************************
+ *  main(int, char*)
+ *
+ *  This function gets called after the tool has been
+ *  launched.
+ ***********************************************************/
+int main(int argc, char* argv[])
+{
+	size_t matrixCount = 100000;
+	int repeatCount = 20;
+
+	if (argc > 1)
+	{
+		matrixCount = (size_t)std::max(atoi(argv[1]), 1);
+	}
+	if (argc > 2)
+	{
+		repeatCount = std::max(atoi(argv[2]), 1);
+	}
+
+	// the same inputs on every run, so runs can be compared
+	std::mt19937 random(330);
+	std::uniform_real_distribution<float> scales(0.1f, 10.0f);
+	std::uniform_real_distribution<float> angles(-180.0f, 180.0f);
+	std::uniform_real_distribution<float> positions(-20.0f, 20.0f);
+	std::uniform_real_distribution<float> shares(0.0f, 1.0f);
+
+	std::vector<TRANSFORM_INPUT> inputs(matrixCount);
+	for (size_t i = 0; i < matrixCount; i++)
+	{
+		TRANSFORM_INPUT& input = inputs[i];
+		bool bRotated = (shares(random) >= UNROTATED_SHARE);
+
+		input.scale = glm::vec3(scales(random), scales(random), scales(random));
+		input.rotationX = bRotated ? angles(random) : 0.0f;
+		input.rotationY = bRotated ? angles(random) : 0.0f;
+		input.rotationZ = bRotated ? angles(random) : 0.0f;
+		input.position = glm::vec3(positions(random), positions(random), positions(random));
+	}
+
+	TransformStore store;
+	for (size_t i = 0; i < matrixCount; i++)
+	{
+		const TRANSFORM_INPUT& input = inputs[i];
+		store.Add(input.scale, input.rotationX, input.rotationY, input.rotationZ, input.position);
+	}
+	store.Update();
+
+	// the difference is measured relative to the size of the
+	// values, since the scale reaches 10
+	float largestDifference = 0.0f;
+	for (size_t i = 0; i < matrixCount; i++)
+	{
+		glm::mat4 product = ComposeProduct(inputs[i]);
+		const glm::mat4& stored = store.GetMatrix((int)i);
+
+		for (int column = 0; column < 4; column++)
+		{
+			for (int row = 0; row < 4; row++)
+			{
+				float difference = std::fabs(product[column][row] - stored[column][row]) /
+					std::max(std::fabs(product[column][row]), 1.0f);
+				largestDifference = std::max(largestDifference, difference);
+			}
+		}
+	}
+
+	std::cout << "Largest difference of " << matrixCount << " matrices: " << largestDifference << std::endl;
+	if (largestDifference > MATCH_EPSILON)
+	{
+		std::cout << "The transform store does not match the product of the matrices" << std::endl;
+		return(EXIT_FAILURE);
+	}
+
+	float checksum = 0.0f;
+	double productTime = TimeProduct(inputs, repeatCount, checksum);
+	double movedTime = TimeStore(store, inputs, false, repeatCount, checksum);
+	double rotatedTime = TimeStore(store, inputs, true, repeatCount, checksum);
+
+	std::cout << "Product of five matrices: " << productTime << " ns per matrix" << std::endl;
+	std::cout << "Store, every one moved:   " << movedTime << " ns per matrix, "
+		<< productTime / movedTime << "x" << std::endl;
+	std::cout << "Store, every one rotated: " << rotatedTime << " ns per matrix, "
+		<< productTime / rotatedTime << "x" << std::endl;
+	std::cout << "(checksum " << checksum << ")" << std::endl;
+
+	return(EXIT_SUCCESS);
+}
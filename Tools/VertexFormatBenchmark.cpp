@@ -0,0 +1,328 @@
+///////////////////////////////////////////////////////////////////////////////
+// vertexformatbenchmark.cpp
+// ============
+// command line tool for comparing the memory and draw speed of the
+// float and packed vertex layouts of the shared mesh buffers
+//
+//  The tool is built as its own program from this file together
+//  with MeshBuffer.cpp, MeshGeometry.cpp and MeshOptimizer.cpp,
+//  linked with GLFW and GLEW, and is run as:
+//
+//    VertexFormatBenchmark [instance count] [frame count]
+//
+//  The basic meshes are uploaded once in each layout, and every
+//  mesh is drawn as a grid of instances into an offscreen target
+//  for the given number of frames.  The time of each frame is
+//  taken once the GPU has finished it.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "../MeshBuffer.h"
+#include "../MeshOptimizer.h"
+
+#include <GL/glew.h>
+#include "GLFW/glfw3.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+// declarations for the global variables and defines
+namespace
+{
+	// size of the offscreen target drawn into
+	const int TARGET_WIDTH = 1280;
+	const int TARGET_HEIGHT = 720;
+	// frames drawn before the timing starts
+	const int WARMUP_FRAMES = 5;
+
+	// the vertex shader unpacks the packed vertices the same way
+	// as the scene shader, and spreads the instances over a grid
+	const char* g_VertexShader =
+		"#version 460 core\n"
+		"layout(location = 0) in vec3 inPosition;\n"
+		"layout(location = 1) in vec3 inNormal;\n"
+		"layout(location = 2) in vec2 inUV;\n"
+		"uniform bool bPackedVertices;\n"
+		"uniform vec3 packedPositionOffset;\n"
+		"uniform vec3 packedPositionScale;\n"
+		"uniform int gridSide;\n"
+		"out vec3 fragNormal;\n"
+		"out vec2 fragUV;\n"
+		"vec3 DecodeNormal(vec2 e)\n"
+		"{\n"
+		"	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));\n"
+		"	float t = max(-n.z, 0.0);\n"
+		"	n.xy += mix(vec2(t), vec2(-t), greaterThanEqual(n.xy, vec2(0.0)));\n"
+		"	return(normalize(n));\n"
+		"}\n"
+		"void main()\n"
+		"{\n"
+		"	vec3 position = inPosition;\n"
+		"	vec3 normal = inNormal;\n"
+		"	if (bPackedVertices)\n"
+		"	{\n"
+		"		position = packedPositionOffset + position * packedPositionScale;\n"
+		"		normal = DecodeNormal(inNormal.xy);\n"
+		"	}\n"
+		"	float cell = 2.0 / float(gridSide);\n"
+		"	vec2 corner = vec2(gl_InstanceID % gridSide, gl_InstanceID / gridSide) * cell - 1.0;\n"
+		"	gl_Position = vec4(corner + (position.xy * 0.4 + 0.5) * cell, position.z * 0.1, 1.0);\n"
+		"	fragNormal = normal;\n"
+		"	fragUV = inUV;\n"
+		"}\n";
+
+	const char* g_FragmentShader =
+		"#version 460 core\n"
+		"in vec3 fragNormal;\n"
+		"in vec2 fragUV;\n"
+		"out vec4 fragmentColor;\n"
+		"void main()\n"
+		"{\n"
+		"	fragmentColor = vec4(normalize(fragNormal) * 0.5 + 0.5, 1.0) * vec4(fract(fragUV), 1.0, 1.0);\n"
+		"}\n";
+
+	/***********************************************************
+	 *  CompileShader()
+	 *
+	 *  This function is used for compiling one shader stage,
+	 *  and returns 0 when the source does not compile.
+	 ***********************************************************/
+	GLuint CompileShader(GLenum type, const char* source)
+	{
+		GLuint shader = glCreateShader(type);
+		glShaderSource(shader, 1, &source, NULL);
+		glCompileShader(shader);
+
+		GLint success = 0;
+		glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+		if (success == 0)
+		{
+			char infoLog[512];
+			glGetShaderInfoLog(shader, sizeof(infoLog), NULL, infoLog);
+			std::cout << "Could not compile shader: " << infoLog << std::endl;
+			glDeleteShader(shader);
+			return(0);
+		}
+
+		return(shader);
+	}
+
+	/***********************************************************
+	 *  CreateProgram()
+	 *
+	 *  This function is used for building the shader program
+	 *  of the benchmark.
+	 ***********************************************************/
+	GLuint CreateProgram()
+	{
+		GLuint vertexShader = CompileShader(GL_VERTEX_SHADER, g_VertexShader);
+		GLuint fragmentShader = CompileShader(GL_FRAGMENT_SHADER, g_FragmentShader);
+		if ((vertexShader == 0) || (fragmentShader == 0))
+		{
+			return(0);
+		}
+
+		GLuint program = glCreateProgram();
+		glAttachShader(program, vertexShader);
+		glAttachShader(program, fragmentShader);
+		glLinkProgram(program);
+		glDeleteShader(vertexShader);
+		glDeleteShader(fragmentShader);
+
+		GLint success = 0;
+		glGetProgramiv(program, GL_LINK_STATUS, &success);
+		if (success == 0)
+		{
+			std::cout << "Could not link the shader program" << std::endl;
+			glDeleteProgram(program);
+			return(0);
+		}
+
+		return(program);
+	}
+
+	/***********************************************************
+	 *  BuildMeshes()
+	 *
+	 *  This function is used for building the basic meshes at
+	 *  their finest level of detail, reordered the same way as
+	 *  for the scene.
+	 ***********************************************************/
+	void BuildMeshes(std::vector<MeshGeometry::MESH_DATA>& meshes)
+	{
+		meshes.resize(9);
+		MeshGeometry::BuildBox(meshes[0]);
+		MeshGeometry::BuildPlane(meshes[1]);
+		MeshGeometry::BuildCylinder(meshes[2]);
+		MeshGeometry::BuildCone(meshes[3]);
+		MeshGeometry::BuildPrism(meshes[4]);
+		MeshGeometry::BuildPyramid4(meshes[5]);
+		MeshGeometry::BuildSphere(meshes[6]);
+		MeshGeometry::BuildTaperedCylinder(meshes[7]);
+		MeshGeometry::BuildTorus(meshes[8]);
+
+		for (size_t i = 0; i < meshes.size(); i++)
+		{
+			MeshOptimizer::Optimize(meshes[i]);
+		}
+	}
+
+	/***********************************************************
+	 *  TimeFormat()
+	 *
+	 *  This function is used for uploading the meshes in one
+	 *  vertex layout and timing the frames that draw them, in
+	 *  milliseconds per frame.
+	 ***********************************************************/
+	double TimeFormat(
+		GLuint program,
+		const std::vector<MeshGeometry::MESH_DATA>& meshes,
+		MeshBuffer::VERTEX_FORMAT format,
+		int instanceCount,
+		int frameCount)
+	{
+		MeshBuffer buffer;
+		for (size_t i = 0; i < meshes.size(); i++)
+		{
+			buffer.AddMesh(meshes[i]);
+		}
+		buffer.Upload(format);
+
+		int gridSide = 1;
+		while (gridSide * gridSide < instanceCount)
+		{
+			gridSide++;
+		}
+
+		glUseProgram(program);
+		glUniform1i(glGetUniformLocation(program, "bPackedVertices"), (format == MeshBuffer::VERTEX_FORMAT_PACKED) ? 1 : 0);
+		glUniform3fv(glGetUniformLocation(program, "packedPositionOffset"), 1, &buffer.GetPositionOffset()[0]);
+		glUniform3fv(glGetUniformLocation(program, "packedPositionScale"), 1, &buffer.GetPositionScale()[0]);
+		glUniform1i(glGetUniformLocation(program, "gridSide"), gridSide);
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (int frame = 0; frame < WARMUP_FRAMES + frameCount; frame++)
+		{
+			if (frame == WARMUP_FRAMES)
+			{
+				glFinish();
+				start = std::chrono::steady_clock::now();
+			}
+
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			buffer.Bind();
+			for (int mesh = 0; mesh < buffer.GetMeshCount(); mesh++)
+			{
+				buffer.DrawInstanced(mesh, true, true, true, instanceCount, 0);
+			}
+			buffer.Unbind();
+		}
+		glFinish();
+
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+		return(elapsed.count() / frameCount);
+	}
+}
+
+/***********************************************************
+ *  main(int, char*)
+ *
+ *  This function gets called after the tool has been
+ *  launched.
+ ***********************************************************/
+int main(int argc, char* argv[])
+{
+	int instanceCount = 4096;
+	int frameCount = 100;
+
+	if (argc > 1)
+	{
+		instanceCount = std::max(atoi(argv[1]), 1);
+	}
+	if (argc > 2)
+	{
+		frameCount = std::max(atoi(argv[2]), 1);
+	}
+
+	// the window is only needed for its OpenGL context
+	glfwInit();
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+	GLFWwindow* window = glfwCreateWindow(TARGET_WIDTH, TARGET_HEIGHT, "VertexFormatBenchmark", NULL, NULL);
+	if (window == NULL)
+	{
+		std::cout << "Could not create an OpenGL 4.6 context" << std::endl;
+		glfwTerminate();
+		return(EXIT_FAILURE);
+	}
+	glfwMakeContextCurrent(window);
+	glfwSwapInterval(0);
+
+	if (glewInit() != GLEW_OK)
+	{
+		std::cout << "Could not initialize GLEW" << std::endl;
+		glfwTerminate();
+		return(EXIT_FAILURE);
+	}
+
+	GLuint program = CreateProgram();
+	if (program == 0)
+	{
+		glfwTerminate();
+		return(EXIT_FAILURE);
+	}
+
+	// the frames are drawn into an offscreen target, since the
+	// window is never shown
+	GLuint framebuffer = 0;
+	GLuint renderbuffers[2] = { 0, 0 };
+	glGenFramebuffers(1, &framebuffer);
+	glGenRenderbuffers(2, renderbuffers);
+	glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[0]);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, TARGET_WIDTH, TARGET_HEIGHT);
+	glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[1]);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, TARGET_WIDTH, TARGET_HEIGHT);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffers[0]);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, renderbuffers[1]);
+	glViewport(0, 0, TARGET_WIDTH, TARGET_HEIGHT);
+	glEnable(GL_DEPTH_TEST);
+
+	std::vector<MeshGeometry::MESH_DATA> meshes;
+	BuildMeshes(meshes);
+
+	size_t vertexCount = 0;
+	size_t triangleCount = 0;
+	for (size_t i = 0; i < meshes.size(); i++)
+	{
+		vertexCount += meshes[i].vertices.size();
+		triangleCount += meshes[i].indices.size() / 3;
+	}
+
+	double floatTime = TimeFormat(program, meshes, MeshBuffer::VERTEX_FORMAT_FLOAT, instanceCount, frameCount);
+	double packedTime = TimeFormat(program, meshes, MeshBuffer::VERTEX_FORMAT_PACKED, instanceCount, frameCount);
+	double trianglesPerFrame = (double)triangleCount * instanceCount;
+
+	std::cout << vertexCount << " vertices and " << triangleCount << " triangles, drawn "
+		<< instanceCount << " times for " << frameCount << " frames" << std::endl;
+	std::cout << "Float layout:  " << vertexCount * sizeof(MeshGeometry::VERTEX) << " bytes, "
+		<< floatTime << " ms per frame, "
+		<< trianglesPerFrame / (floatTime * 1000.0) << " million triangles per second" << std::endl;
+	std::cout << "Packed layout: " << vertexCount * sizeof(MeshBuffer::PACKED_VERTEX) << " bytes, "
+		<< packedTime << " ms per frame, "
+		<< trianglesPerFrame / (packedTime * 1000.0) << " million triangles per second" << std::endl;
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glDeleteFramebuffers(1, &framebuffer);
+	glDeleteRenderbuffers(2, renderbuffers);
+	glDeleteProgram(program);
+	glfwDestroyWindow(window);
+	glfwTerminate();
+
+	return(EXIT_SUCCESS);
+}
@@ -0,0 +1,300 @@
+///////////////////////////////////////////////////////////////////////////////
+// transformstore.cpp
+// ============
+// keep the transforms of the scene objects as structure of arrays
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TransformStore.h"
+
+#include <cmath>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 1))
+#define TRANSFORM_STORE_SSE
+#include <xmmintrin.h>
+#endif
+
+// declare the global variables
+namespace
+{
+	const float DEGREES_TO_RADIANS = 3.14159265358979f / 180.0f;
+}
+
+/***********************************************************
+ *  TransformStore()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TransformStore::TransformStore()
+{
+	m_count = 0;
+	m_bDirty = false;
+}
+
+/***********************************************************
+ *  Reserve()
+ *
+ *  This method is used for growing every array to hold the
+ *  passed in number of transforms.  The arrays always hold
+ *  whole groups of four, so the update never needs a scalar
+ *  loop for the last few transforms.
+ ***********************************************************/
+void TransformStore::Reserve(int count)
+{
+	size_t size = ((size_t)count + 3) & ~(size_t)3;
+
+	if (size <= m_matrices.size())
+	{
+		return;
+	}
+
+	// unused transforms in the last group have no rotation and
+	// no scale
+	m_scaleX.resize(size, 0.0f);
+	m_scaleY.resize(size, 0.0f);
+	m_scaleZ.resize(size, 0.0f);
+	m_sinX.resize(size, 0.0f);
+	m_cosX.resize(size, 1.0f);
+	m_sinY.resize(size, 0.0f);
+	m_cosY.resize(size, 1.0f);
+	m_sinZ.resize(size, 0.0f);
+	m_cosZ.resize(size, 1.0f);
+	m_positionX.resize(size, 0.0f);
+	m_positionY.resize(size, 0.0f);
+	m_positionZ.resize(size, 0.0f);
+	m_matrices.resize(size, glm::mat4(1.0f));
+	m_dirtyGroups.resize(size / 4, 0);
+}
+
+/***********************************************************
+ *  Add()
+ *
+ *  This method is used for adding a transform to the store.
+ ***********************************************************/
+int TransformStore::Add(
+	const glm::vec3& scaleXYZ,
+	float XrotationDegrees,
+	float YrotationDegrees,
+	float ZrotationDegrees,
+	const glm::vec3& positionXYZ)
+{
+	int index = m_count;
+
+	Reserve(m_count + 1);
+	m_count++;
+
+	SetScale(index, scaleXYZ);
+	SetRotation(index, XrotationDegrees, YrotationDegrees, ZrotationDegrees);
+	SetPosition(index, positionXYZ);
+
+	return(index);
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for removing every transform.
+ ***********************************************************/
+void TransformStore::Clear()
+{
+	m_count = 0;
+	m_scaleX.clear();
+	m_scaleY.clear();
+	m_scaleZ.clear();
+	m_sinX.clear();
+	m_cosX.clear();
+	m_sinY.clear();
+	m_cosY.clear();
+	m_sinZ.clear();
+	m_cosZ.clear();
+	m_positionX.clear();
+	m_positionY.clear();
+	m_positionZ.clear();
+	m_matrices.clear();
+	m_dirtyGroups.clear();
+	m_bDirty = false;
+}
+
+/***********************************************************
+ *  SetScale()
+ *
+ *  This method is used for changing the scale of a transform.
+ ***********************************************************/
+void TransformStore::SetScale(int index, const glm::vec3& scaleXYZ)
+{
+	m_scaleX[index] = scaleXYZ.x;
+	m_scaleY[index] = scaleXYZ.y;
+	m_scaleZ[index] = scaleXYZ.z;
+	MarkDirty(index);
+}
+
+/***********************************************************
+ *  SetRotation()
+ *
+ *  This method is used for changing the rotation of a
+ *  transform.  The sines and cosines are worked out here,
+ *  once, instead of every time the matrix is computed.
+ ***********************************************************/
+void TransformStore::SetRotation(
+	int index,
+	float XrotationDegrees,
+	float YrotationDegrees,
+	float ZrotationDegrees)
+{
+	m_sinX[index] = std::sin(XrotationDegrees * DEGREES_TO_RADIANS);
+	m_cosX[index] = std::cos(XrotationDegrees * DEGREES_TO_RADIANS);
+	m_sinY[index] = std::sin(YrotationDegrees * DEGREES_TO_RADIANS);
+	m_cosY[index] = std::cos(YrotationDegrees * DEGREES_TO_RADIANS);
+	m_sinZ[index] = std::sin(ZrotationDegrees * DEGREES_TO_RADIANS);
+	m_cosZ[index] = std::cos(ZrotationDegrees * DEGREES_TO_RADIANS);
+	MarkDirty(index);
+}
+
+/***********************************************************
+ *  SetPosition()
+ *
+ *  This method is used for changing the position of a
+ *  transform.
+ ***********************************************************/
+void TransformStore::SetPosition(int index, const glm::vec3& positionXYZ)
+{
+	m_positionX[index] = positionXYZ.x;
+	m_positionY[index] = positionXYZ.y;
+	m_positionZ[index] = positionXYZ.z;
+	MarkDirty(index);
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for computing the model matrices of
+ *  the groups of transforms that changed since the last
+ *  update.
+ ***********************************************************/
+bool TransformStore::Update()
+{
+	if (m_bDirty == false)
+	{
+		return(false);
+	}
+
+	for (int group = 0; group < (int)m_dirtyGroups.size(); group++)
+	{
+		if (m_dirtyGroups[group] != 0)
+		{
+			UpdateGroup(group * 4);
+			m_dirtyGroups[group] = 0;
+		}
+	}
+	m_bDirty = false;
+
+	return(true);
+}
+
+/***********************************************************
+ *  UpdateGroup()
+ *
+ *  This method is used for computing the model matrix
+ *    translation * rotationX * rotationY * rotationZ * scale
+ *  of four transforms in closed form, from the three axis
+ *  rotations multiplied out by hand.  With SSE each row of
+ *  the rotation is worked out for the four transforms at
+ *  once, then transposed into the columns of the four
+ *  matrices.
+ ***********************************************************/
+void TransformStore::UpdateGroup(int first)
+{
+#ifdef TRANSFORM_STORE_SSE
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	int i = first;
+
+	__m128 sx = _mm_loadu_ps(&m_sinX[i]);
+	__m128 cx = _mm_loadu_ps(&m_cosX[i]);
+	__m128 sy = _mm_loadu_ps(&m_sinY[i]);
+	__m128 cy = _mm_loadu_ps(&m_cosY[i]);
+	__m128 sz = _mm_loadu_ps(&m_sinZ[i]);
+	__m128 cz = _mm_loadu_ps(&m_cosZ[i]);
+	__m128 scaleX = _mm_loadu_ps(&m_scaleX[i]);
+	__m128 scaleY = _mm_loadu_ps(&m_scaleY[i]);
+	__m128 scaleZ = _mm_loadu_ps(&m_scaleZ[i]);
+	__m128 sxsy = _mm_mul_ps(sx, sy);
+	__m128 cxsy = _mm_mul_ps(cx, sy);
+
+	__m128 columns[4][4];
+	columns[0][0] = _mm_mul_ps(_mm_mul_ps(cy, cz), scaleX);
+	columns[0][1] = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(cx, sz), _mm_mul_ps(sxsy, cz)), scaleX);
+	columns[0][2] = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(sx, sz), _mm_mul_ps(cxsy, cz)), scaleX);
+	columns[0][3] = zero;
+	columns[1][0] = _mm_sub_ps(zero, _mm_mul_ps(_mm_mul_ps(cy, sz), scaleY));
+	columns[1][1] = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(cx, cz), _mm_mul_ps(sxsy, sz)), scaleY);
+	columns[1][2] = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(sx, cz), _mm_mul_ps(cxsy, sz)), scaleY);
+	columns[1][3] = zero;
+	columns[2][0] = _mm_mul_ps(sy, scaleZ);
+	columns[2][1] = _mm_sub_ps(zero, _mm_mul_ps(_mm_mul_ps(sx, cy), scaleZ));
+	columns[2][2] = _mm_mul_ps(_mm_mul_ps(cx, cy), scaleZ);
+	columns[2][3] = zero;
+	columns[3][0] = _mm_loadu_ps(&m_positionX[i]);
+	columns[3][1] = _mm_loadu_ps(&m_positionY[i]);
+	columns[3][2] = _mm_loadu_ps(&m_positionZ[i]);
+	columns[3][3] = one;
+
+	for (int column = 0; column < 4; column++)
+	{
+		_MM_TRANSPOSE4_PS(columns[column][0], columns[column][1], columns[column][2], columns[column][3]);
+		for (int j = 0; j < 4; j++)
+		{
+			_mm_storeu_ps(&m_matrices[i + j][column][0], columns[column][j]);
+		}
+	}
+#else
+	for (int i = first; i < first + 4; i++)
+	{
+		float sx = m_sinX[i];
+		float cx = m_cosX[i];
+		float sy = m_sinY[i];
+		float cy = m_cosY[i];
+		float sz = m_sinZ[i];
+		float cz = m_cosZ[i];
+		glm::mat4& model = m_matrices[i];
+
+		model[0] = glm::vec4(cy * cz, cx * sz + sx * sy * cz, sx * sz - cx * sy * cz, 0.0f) * m_scaleX[i];
+		model[1] = glm::vec4(-cy * sz, cx * cz - sx * sy * sz, sx * cz + cx * sy * sz, 0.0f) * m_scaleY[i];
+		model[2] = glm::vec4(sy, -sx * cy, cx * cy, 0.0f) * m_scaleZ[i];
+		model[3] = glm::vec4(m_positionX[i], m_positionY[i], m_positionZ[i], 1.0f);
+	}
+#endif
+}
+
+/***********************************************************
+ *  MarkDirty()
+ *
+ *  This method is used for marking the group of a transform
+ *  to be computed again by the next update.
+ ***********************************************************/
+void TransformStore::MarkDirty(int index)
+{
+	m_dirtyGroups[index / 4] = 1;
+	m_bDirty = true;
+}
+
+/***********************************************************
+ *  GetMatrix()
+ *
+ *  This method is used for getting the model matrix of a
+ *  transform, as computed by the last update.
+ ***********************************************************/
+const glm::mat4& TransformStore::GetMatrix(int index) const
+{
+	return(m_matrices[index]);
+}
+
+/***********************************************************
+ *  GetCount()
+ *
+ *  This method is used for getting the number of transforms.
+ ***********************************************************/
+int TransformStore::GetCount() const
+{
+	return(m_count);
+}
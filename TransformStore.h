@@ -0,0 +1,85 @@
+///////////////////////////////////////////////////////////////////////////////
+// transformstore.h
+// ============
+// keep the transforms of the scene objects as structure of arrays
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  TransformStore
+ *
+ *  This class holds the scale, rotation and position of
+ *  every object of the scene in separate arrays, one array
+ *  per component, and computes all of the model matrices in
+ *  one pass.  The sines and cosines of the rotations are
+ *  kept instead of the angles, since rotations change far
+ *  less often than matrices are computed, and the pass then
+ *  handles four transforms at a time with SSE.  Each group of
+ *  four transforms has a dirty flag, so only the groups with
+ *  a changed transform are computed again, and a scene that
+ *  does not move costs nothing to update.
+ ***********************************************************/
+class TransformStore
+{
+public:
+	// constructor
+	TransformStore();
+
+	// add a transform and return its index
+	int Add(
+		const glm::vec3& scaleXYZ,
+		float XrotationDegrees,
+		float YrotationDegrees,
+		float ZrotationDegrees,
+		const glm::vec3& positionXYZ);
+	// remove every transform
+	void Clear();
+
+	// change the components of a transform
+	void SetScale(int index, const glm::vec3& scaleXYZ);
+	void SetRotation(int index, float XrotationDegrees, float YrotationDegrees, float ZrotationDegrees);
+	void SetPosition(int index, const glm::vec3& positionXYZ);
+
+	// compute the model matrices of the changed transforms, and
+	// return whether any matrix changed
+	bool Update();
+	// get the model matrix computed for a transform
+	const glm::mat4& GetMatrix(int index) const;
+	// get the number of transforms
+	int GetCount() const;
+
+private:
+	// make room in every array for the transforms, rounded up to
+	// a whole group of four
+	void Reserve(int count);
+	// compute the model matrices of one group of four transforms
+	void UpdateGroup(int first);
+	// mark the group of a transform as changed
+	void MarkDirty(int index);
+
+	int m_count;
+	std::vector<float> m_scaleX;
+	std::vector<float> m_scaleY;
+	std::vector<float> m_scaleZ;
+	std::vector<float> m_sinX;
+	std::vector<float> m_cosX;
+	std::vector<float> m_sinY;
+	std::vector<float> m_cosY;
+	std::vector<float> m_sinZ;
+	std::vector<float> m_cosZ;
+	std::vector<float> m_positionX;
+	std::vector<float> m_positionY;
+	std::vector<float> m_positionZ;
+	// model matrices from the last update
+	std::vector<glm::mat4> m_matrices;
+	// whether each group of four transforms changed since the last
+	// update, and whether any group did
+	std::vector<unsigned char> m_dirtyGroups;
+	bool m_bDirty;
+};
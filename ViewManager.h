@@ -10,6 +10,7 @@
 #pragma once
 
 #include "ShaderManager.h"
+#include "ShaderUniformCache.h"
 #include "camera.h"
 
 // GLFW library
@@ -34,8 +35,13 @@ public:
 private:
 	// pointer to shader manager object
 	ShaderManager* m_pShaderManager;
+	// uniform locations and last written values of the shader
+	ShaderUniformCache m_uniforms;
 	// active OpenGL display window
 	GLFWwindow* m_pWindow;
+	// view and projection matrices set for the current frame
+	glm::mat4 m_viewMatrix;
+	glm::mat4 m_projectionMatrix;
 
 	// process keyboard events for interaction with the 3D scene
 	void ProcessKeyboardEvents();
@@ -46,4 +52,8 @@ public:
 	
 	// prepare the conversion from 3D object display to 2D scene display
 	void PrepareSceneView();
+
+	// get the view and projection matrices of the current frame
+	const glm::mat4& GetViewMatrix() const;
+	const glm::mat4& GetProjectionMatrix() const;
 };
\ No newline at end of file